@@ -0,0 +1,682 @@
+// Parser benchmarks
+//
+// Each benchmark prints the time per command-line token and the number of
+// heap allocations per parse, e.g.,
+//
+//   ./structopt_benchmarks
+//   ./structopt_benchmarks --filter argv_length --min-time 1
+//
+// Build with -DSTRUCTOPT_BENCHMARKS=ON -DCMAKE_BUILD_TYPE=Release
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <new>
+#include <set>
+#include <sstream>
+#include <string>
+#include <structopt/app.hpp>
+#include <thread>
+#include <vector>
+
+// Every allocation is counted, including those for the parsed struct, on
+// every thread
+static std::atomic<std::size_t> allocation_count{0};
+
+void *operator new(std::size_t size) {
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  if (void *result = std::malloc(size ? size : 1)) {
+    return result;
+  }
+  throw std::bad_alloc();
+}
+
+void operator delete(void *pointer) noexcept { std::free(pointer); }
+
+void operator delete(void *pointer, std::size_t) noexcept { std::free(pointer); }
+
+#ifdef STRUCTOPT_HAS_MEMORY_RESOURCE
+// The default resource of std::pmr containers allocates with the aligned
+// operator new, which is not counted; this one allocates with the counted one
+class counted_resource : public std::pmr::memory_resource {
+  void *do_allocate(std::size_t bytes, std::size_t) override {
+    return ::operator new(bytes);
+  }
+
+  void do_deallocate(void *pointer, std::size_t, std::size_t) override {
+    ::operator delete(pointer);
+  }
+
+  bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+    return this == &other;
+  }
+};
+
+static counted_resource default_resource;
+#endif
+
+struct Options {
+  std::optional<std::string> filter; // only run benchmarks whose name contains this
+  std::optional<double> min_time;    // seconds per measurement, 0.1 by default
+};
+STRUCTOPT(Options, filter, min_time);
+
+static Options options;
+
+// keeps the parsed structs alive as far as the optimizer is concerned
+static volatile std::size_t sink = 0;
+
+static bool is_selected(const std::string &benchmark) {
+  return !options.filter || benchmark.find(options.filter.value()) != std::string::npos;
+}
+
+// Call `run` until the minimum time has passed, then report the time per
+// token and the allocations per parse. A call to `run` processes `tokens`
+// tokens in `parses` parses.
+template <typename F>
+void measure(const std::string &benchmark, const std::string &parameter,
+             std::size_t tokens, std::size_t parses, F &&run) {
+  using clock = std::chrono::steady_clock;
+  const auto min_time = std::chrono::duration<double>(options.min_time.value_or(0.1));
+
+  std::size_t iterations = 0;
+  std::size_t allocations = 0;
+  const auto start = clock::now();
+  auto elapsed = clock::duration{};
+  do {
+    const auto before = allocation_count.load();
+    run();
+    allocations += allocation_count - before;
+    iterations += 1;
+    elapsed = clock::now() - start;
+  } while (elapsed < min_time);
+
+  const auto ns = std::chrono::duration<double, std::nano>(elapsed).count();
+  const auto total_tokens = static_cast<double>(iterations * tokens);
+  const auto total_parses = static_cast<double>(iterations * parses);
+  std::printf("%-20s %-28s %12.1f %18.1f\n", benchmark.c_str(), parameter.c_str(),
+              ns / total_tokens, static_cast<double>(allocations) / total_parses);
+}
+
+// field count: structs with 1 to 69 (the VISITABLE_STRUCT limit) optional fields
+struct Fields1 {
+  std::optional<int> f0;
+};
+STRUCTOPT(Fields1, f0);
+
+struct Fields8 {
+  std::optional<int> f0;
+  std::optional<int> f1;
+  std::optional<int> f2;
+  std::optional<int> f3;
+  std::optional<int> f4;
+  std::optional<int> f5;
+  std::optional<int> f6;
+  std::optional<int> f7;
+};
+STRUCTOPT(Fields8, f0, f1, f2, f3, f4, f5, f6, f7);
+
+struct Fields32 {
+  std::optional<int> f0;
+  std::optional<int> f1;
+  std::optional<int> f2;
+  std::optional<int> f3;
+  std::optional<int> f4;
+  std::optional<int> f5;
+  std::optional<int> f6;
+  std::optional<int> f7;
+  std::optional<int> f8;
+  std::optional<int> f9;
+  std::optional<int> f10;
+  std::optional<int> f11;
+  std::optional<int> f12;
+  std::optional<int> f13;
+  std::optional<int> f14;
+  std::optional<int> f15;
+  std::optional<int> f16;
+  std::optional<int> f17;
+  std::optional<int> f18;
+  std::optional<int> f19;
+  std::optional<int> f20;
+  std::optional<int> f21;
+  std::optional<int> f22;
+  std::optional<int> f23;
+  std::optional<int> f24;
+  std::optional<int> f25;
+  std::optional<int> f26;
+  std::optional<int> f27;
+  std::optional<int> f28;
+  std::optional<int> f29;
+  std::optional<int> f30;
+  std::optional<int> f31;
+};
+STRUCTOPT(Fields32, f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14,
+          f15, f16, f17, f18, f19, f20, f21, f22, f23, f24, f25, f26, f27, f28, f29,
+          f30, f31);
+
+struct Fields69 {
+  std::optional<int> f0;
+  std::optional<int> f1;
+  std::optional<int> f2;
+  std::optional<int> f3;
+  std::optional<int> f4;
+  std::optional<int> f5;
+  std::optional<int> f6;
+  std::optional<int> f7;
+  std::optional<int> f8;
+  std::optional<int> f9;
+  std::optional<int> f10;
+  std::optional<int> f11;
+  std::optional<int> f12;
+  std::optional<int> f13;
+  std::optional<int> f14;
+  std::optional<int> f15;
+  std::optional<int> f16;
+  std::optional<int> f17;
+  std::optional<int> f18;
+  std::optional<int> f19;
+  std::optional<int> f20;
+  std::optional<int> f21;
+  std::optional<int> f22;
+  std::optional<int> f23;
+  std::optional<int> f24;
+  std::optional<int> f25;
+  std::optional<int> f26;
+  std::optional<int> f27;
+  std::optional<int> f28;
+  std::optional<int> f29;
+  std::optional<int> f30;
+  std::optional<int> f31;
+  std::optional<int> f32;
+  std::optional<int> f33;
+  std::optional<int> f34;
+  std::optional<int> f35;
+  std::optional<int> f36;
+  std::optional<int> f37;
+  std::optional<int> f38;
+  std::optional<int> f39;
+  std::optional<int> f40;
+  std::optional<int> f41;
+  std::optional<int> f42;
+  std::optional<int> f43;
+  std::optional<int> f44;
+  std::optional<int> f45;
+  std::optional<int> f46;
+  std::optional<int> f47;
+  std::optional<int> f48;
+  std::optional<int> f49;
+  std::optional<int> f50;
+  std::optional<int> f51;
+  std::optional<int> f52;
+  std::optional<int> f53;
+  std::optional<int> f54;
+  std::optional<int> f55;
+  std::optional<int> f56;
+  std::optional<int> f57;
+  std::optional<int> f58;
+  std::optional<int> f59;
+  std::optional<int> f60;
+  std::optional<int> f61;
+  std::optional<int> f62;
+  std::optional<int> f63;
+  std::optional<int> f64;
+  std::optional<int> f65;
+  std::optional<int> f66;
+  std::optional<int> f67;
+  std::optional<int> f68;
+};
+STRUCTOPT(Fields69, f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14,
+          f15, f16, f17, f18, f19, f20, f21, f22, f23, f24, f25, f26, f27, f28, f29,
+          f30, f31, f32, f33, f34, f35, f36, f37, f38, f39, f40, f41, f42, f43, f44,
+          f45, f46, f47, f48, f49, f50, f51, f52, f53, f54, f55, f56, f57, f58, f59,
+          f60, f61, f62, f63, f64, f65, f66, f67, f68);
+
+// argv length: a flag and a growing list of files
+struct Files {
+  std::optional<bool> verbose = false;
+  std::vector<std::string> files;
+};
+STRUCTOPT(Files, verbose, files);
+
+static void argv_length() {
+  for (std::size_t size = 10; size <= 1000000; size *= 10) {
+    std::vector<std::string> arguments{"./main", "-v"};
+    for (std::size_t i = 2; i < size; i++) {
+      arguments.push_back("file" + std::to_string(i) + ".txt");
+    }
+    measure("argv_length", std::to_string(size), size, 1, [&] {
+      sink = sink + structopt::app("bench").parse<Files>(arguments).files.size();
+    });
+  }
+}
+
+// field count: every field of the struct is given once, e.g., --f3 3
+template <typename T> static void field_count(std::size_t fields) {
+  std::vector<std::string> arguments{"./main"};
+  for (std::size_t i = 0; i < fields; i++) {
+    arguments.push_back("--f" + std::to_string(i));
+    arguments.push_back(std::to_string(i));
+  }
+  measure("field_count", std::to_string(fields), arguments.size(), 1, [&] {
+    sink = sink + structopt::app("bench").parse<T>(arguments).f0.value_or(0);
+  });
+}
+
+// sub-command depth: "next" names the sub-command of the level below
+struct Level4 : structopt::sub_command {
+  std::vector<int> values;
+};
+struct Level3 : structopt::sub_command {
+  Level4 next;
+  std::vector<int> values;
+};
+struct Level2 : structopt::sub_command {
+  Level3 next;
+  std::vector<int> values;
+};
+struct Level1 : structopt::sub_command {
+  Level2 next;
+  std::vector<int> values;
+};
+struct Level0 {
+  Level1 next;
+  std::vector<int> values;
+};
+STRUCTOPT(Level4, values);
+STRUCTOPT(Level3, next, values);
+STRUCTOPT(Level2, next, values);
+STRUCTOPT(Level1, next, values);
+STRUCTOPT(Level0, next, values);
+
+static void sub_command_depth(std::size_t depth) {
+  std::vector<std::string> arguments{"./main"};
+  for (std::size_t i = 0; i < depth; i++) {
+    arguments.push_back("next");
+  }
+  for (std::size_t i = 0; i < 1000; i++) {
+    arguments.push_back(std::to_string(i));
+  }
+  measure("sub_command_depth", std::to_string(depth), arguments.size(), 1, [&] {
+    sink = sink + structopt::app("bench").parse<Level0>(arguments).values.size();
+  });
+}
+
+// container element types: 100k values of the same kind
+struct StringVector {
+  std::vector<std::string> values;
+};
+struct IntVector {
+  std::vector<int> values;
+};
+struct DoubleVector {
+  std::vector<double> values;
+};
+struct Uint64Deque {
+  std::deque<std::uint64_t> values;
+};
+struct IntSet {
+  std::set<int> values;
+};
+STRUCTOPT(StringVector, values);
+STRUCTOPT(IntVector, values);
+STRUCTOPT(DoubleVector, values);
+STRUCTOPT(Uint64Deque, values);
+STRUCTOPT(IntSet, values);
+
+template <typename T> static void container_type(const std::string &name, bool real) {
+  std::vector<std::string> arguments{"./main"};
+  for (std::size_t i = 0; i < 100000; i++) {
+    arguments.push_back(real ? std::to_string(i) + ".25" : std::to_string(i));
+  }
+  measure("container_type", name, arguments.size(), 1, [&] {
+    sink = sink + structopt::app("bench").parse<T>(arguments).values.size();
+  });
+}
+
+// error rate: many short command lines, some of which are rejected
+struct Job {
+  std::optional<int> jobs;
+  std::vector<int> values;
+};
+STRUCTOPT(Job, jobs, values);
+
+static void error_rate(std::size_t percent) {
+  std::vector<std::vector<std::string>> command_lines;
+  std::size_t tokens = 0;
+  for (std::size_t i = 0; i < 1000; i++) {
+    std::vector<std::string> arguments{"./main", "--jobs", "4"};
+    for (std::size_t j = 0; j < 7; j++) {
+      arguments.push_back(std::to_string(j));
+    }
+    if (i % 100 < percent) {
+      arguments.back() = "seven";
+    }
+    tokens += arguments.size();
+    command_lines.push_back(std::move(arguments));
+  }
+  measure("error_rate", std::to_string(percent) + "%", tokens, command_lines.size(), [&] {
+    for (const auto &arguments : command_lines) {
+      try {
+        sink = sink + structopt::app("bench").parse<Job>(arguments).values.size();
+      } catch (structopt::exception &e) {
+        sink = sink + static_cast<std::size_t>(e.code());
+      }
+    }
+  });
+  measure("error_rate", std::to_string(percent) + "%, try_parse", tokens,
+          command_lines.size(), [&] {
+            for (const auto &arguments : command_lines) {
+              const auto result = structopt::app("bench").try_parse<Job>(arguments);
+              sink = sink + (result ? result->values.size()
+                                    : static_cast<std::size_t>(result.code()));
+            }
+          });
+}
+
+// repeated parses: short command lines parsed with a new app each, and
+// with one structopt::parser_for
+static void repeated_parse() {
+  std::vector<std::string> arguments{"./main", "--jobs", "4", "1", "2", "3"};
+  const std::size_t parses = 1000;
+  measure("repeated_parse", "app", arguments.size() * parses, parses, [&] {
+    for (std::size_t i = 0; i < parses; i++) {
+      sink = sink + structopt::app("bench").parse<Job>(arguments).values.size();
+    }
+  });
+  structopt::parser_for<Job> parser("bench");
+  measure("repeated_parse", "parser_for", arguments.size() * parses, parses, [&] {
+    for (std::size_t i = 0; i < parses; i++) {
+      sink = sink + parser.parse(arguments).values.size();
+    }
+  });
+}
+
+#ifdef STRUCTOPT_HAS_MEMORY_RESOURCE
+// memory resource: a batch of short command lines parsed into std::pmr
+// fields, from the global heap and from an arena that is reset per parse
+struct PmrJob {
+  std::optional<int> jobs;
+  std::pmr::vector<std::pmr::string> files;
+};
+STRUCTOPT(PmrJob, jobs, files);
+
+static void memory_resource() {
+  std::vector<std::string> arguments{"./main", "--jobs", "4", "main.cpp", "parser.cpp",
+                                     "a_file_name_too_long_for_small_strings.cpp"};
+  const std::size_t parses = 1000;
+  const structopt::app heap_app("bench");
+  measure("memory_resource", "global heap", arguments.size() * parses, parses, [&] {
+    for (std::size_t i = 0; i < parses; i++) {
+      sink = sink + heap_app.parse<PmrJob>(arguments).files.size();
+    }
+  });
+  std::vector<std::byte> buffer(64 * 1024);
+  std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size());
+  structopt::app arena_app("bench");
+  arena_app.memory_resource(&arena);
+  measure("memory_resource", "arena", arguments.size() * parses, parses, [&] {
+    for (std::size_t i = 0; i < parses; i++) {
+      sink = sink + arena_app.parse<PmrJob>(arguments).files.size();
+      arena.release();
+    }
+  });
+}
+#endif
+
+// environment fallback: 32 optional fields, each set by an environment
+// variable among 256 others, read through app::environment and with a
+// std::getenv call per field after the parse; one token per field
+static void environment() {
+  static std::vector<std::string> variables;
+  for (std::size_t i = 0; i < 256; i++) {
+    variables.push_back("BENCH_OTHER_VARIABLE_" + std::to_string(i) + "=value");
+  }
+  for (std::size_t i = 0; i < 32; i++) {
+    variables.push_back("BENCH_F" + std::to_string(i) + "=" + std::to_string(i));
+  }
+  for (auto &variable : variables) {
+#ifdef _WIN32
+    _putenv(variable.c_str());
+#else
+    putenv(variable.data());
+#endif
+  }
+
+  std::vector<std::string> arguments{"./main"};
+  const std::size_t parses = 100;
+  auto indexed_app = structopt::app("bench");
+  indexed_app.environment("bench");
+  measure("environment", "indexed", 32 * parses, parses, [&] {
+    for (std::size_t i = 0; i < parses; i++) {
+      sink = sink + static_cast<std::size_t>(*indexed_app.parse<Fields32>(arguments).f31);
+    }
+  });
+  const structopt::app getenv_app("bench");
+  measure("environment", "getenv", 32 * parses, parses, [&] {
+    for (std::size_t i = 0; i < parses; i++) {
+      auto result = getenv_app.parse<Fields32>(arguments);
+      visit_struct::for_each(result, [](const char *name, std::optional<int> &value) {
+        auto variable = "BENCH_" + std::string{name};
+        for (auto &c : variable) {
+          c = structopt::details::to_environment_char(c);
+        }
+        if (const char *text = std::getenv(variable.c_str())) {
+          value = std::atoi(text);
+        }
+      });
+      sink = sink + static_cast<std::size_t>(*result.f31);
+    }
+  });
+}
+
+// config files: a file of 10k key=value lines loaded with app::config_file,
+// one token per line, and the 69 fields of a struct that fall back to it
+static void config_file() {
+  const std::string path = "structopt_benchmark.ini";
+  {
+    std::ofstream file(path, std::ios::binary);
+    for (std::size_t i = 0; i < 10000; i++) {
+      file << (i % 100 == 0 ? "# comment\n" : "") << "f" << i << " = " << i << "\n";
+    }
+  }
+  measure("config_file", "load 10k lines", 10000, 1, [&] {
+    auto app = structopt::app("bench");
+    app.config_file(path);
+    sink = sink + 1;
+  });
+  auto app = structopt::app("bench");
+  app.config_file(path);
+  std::vector<std::string> arguments{"./main"};
+  measure("config_file", "69 fields", 69, 1, [&] {
+    sink = sink + static_cast<std::size_t>(*app.parse<Fields69>(arguments).f68);
+  });
+  std::remove(path.c_str());
+}
+
+// dynamic completion: `__complete` of `--f68` after `words` words of options
+// of the 69 fields, against a parse of the same words
+static void complete(std::size_t words) {
+  std::vector<std::string> arguments;
+  for (std::size_t i = 0; arguments.size() < words; i++) {
+    arguments.push_back("--f" + std::to_string(i % 69));
+    arguments.push_back(std::to_string(i));
+  }
+  arguments.resize(words);
+  arguments.push_back("--f68");
+  const std::vector<std::string_view> views(arguments.begin(), arguments.end());
+  const structopt::app app("bench");
+  measure("complete", std::to_string(words) + " words", views.size(), 1, [&] {
+    sink = sink + app.complete<Fields69>(views).size();
+  });
+  arguments.pop_back();
+  arguments.insert(arguments.begin(), "./main");
+  measure("complete", std::to_string(words) + " words, parse", arguments.size(), 1, [&] {
+    sink = sink + static_cast<std::size_t>(app.parse<Fields69>(arguments).f0.has_value());
+  });
+}
+
+// help: the help of a struct with 69 options, as app::help returns it and
+// as it is written to a stream
+static void help() {
+  auto app = structopt::app("bench");
+  app.parse<Fields69>(std::vector<std::string>{"./main"});
+  measure("help", "app::help, 69 options", 69, 1,
+          [&] { sink = sink + app.help().size(); });
+  std::ostringstream os;
+  measure("help", "print_help, 69 options", 69, 1, [&] {
+    os.str("");
+    structopt::details::visitor visitor("bench", "");
+    visitor.schema = &structopt::details::schema_of<Fields69>();
+    visitor.print_help(os);
+    sink = sink + static_cast<std::size_t>(os.tellp());
+  });
+}
+
+// concurrent parses: threads that share one app, each parsing its own
+// command lines; the time per token is for all threads together
+static void concurrent_parse(std::size_t thread_count) {
+  std::vector<std::string> arguments{"./main", "--jobs", "4", "1", "2", "3"};
+  const std::size_t parses = 1000; // per thread
+  const structopt::app app("bench");
+  measure("concurrent_parse", std::to_string(thread_count) + " threads",
+          arguments.size() * parses * thread_count, parses * thread_count, [&] {
+            std::vector<std::size_t> values(thread_count);
+            std::vector<std::thread> threads;
+            for (std::size_t t = 0; t < thread_count; t++) {
+              threads.emplace_back([&, t] {
+                for (std::size_t i = 0; i < parses; i++) {
+                  values[t] += app.parse<Job>(arguments).values.size();
+                }
+              });
+            }
+            for (std::size_t t = 0; t < thread_count; t++) {
+              threads[t].join();
+              sink = sink + values[t];
+            }
+          });
+}
+
+// number conversion: details::parse_number against the std::istringstream
+// conversion it replaced, one token per value
+template <typename T> static void number_conversion(const std::string &name, bool real) {
+  std::vector<std::string> values;
+  for (std::size_t i = 0; i < 100000; i++) {
+    values.push_back(real ? std::to_string(i) + ".25" : std::to_string(i));
+  }
+  measure("number_conversion", name + " from_chars", values.size(), values.size(), [&] {
+    for (const auto &value : values) {
+      T result{};
+      structopt::details::parse_number(value, result);
+      sink = sink + static_cast<std::size_t>(result);
+    }
+  });
+  measure("number_conversion", name + " istringstream", values.size(), values.size(),
+          [&] {
+            for (const auto &value : values) {
+              std::istringstream ss(value);
+              T result{};
+              ss >> result;
+              sink = sink + static_cast<std::size_t>(result);
+            }
+          });
+}
+
+// parallel conversion: a numeric std::vector converted on one thread, and
+// with app::parallel_conversion
+static void parallel_conversion(std::size_t count) {
+  std::vector<std::string> arguments{"./main"};
+  for (std::size_t i = 0; i < count; i++) {
+    arguments.push_back(std::to_string(i) + ".25");
+  }
+  const auto parameter = std::to_string(count) + " values";
+  measure("parallel_conversion", parameter + ", serial", arguments.size(), 1, [&] {
+    sink = sink + structopt::app("bench").parse<DoubleVector>(arguments).values.size();
+  });
+  measure("parallel_conversion", parameter + ", parallel", arguments.size(), 1, [&] {
+    sink = sink + structopt::app("bench")
+                      .parallel_conversion(1)
+                      .parse<DoubleVector>(arguments)
+                      .values.size();
+  });
+}
+
+int main(int argc, char *argv[]) {
+#ifdef STRUCTOPT_HAS_MEMORY_RESOURCE
+  std::pmr::set_default_resource(&default_resource);
+#endif
+  try {
+    options = structopt::app("structopt_benchmarks").parse<Options>(argc, argv);
+  } catch (structopt::exception &e) {
+    std::cout << e.what() << "\n";
+    std::cout << e.help();
+    return EXIT_FAILURE;
+  }
+
+  std::printf("%-20s %-28s %12s %18s\n", "benchmark", "parameter", "ns/token",
+              "allocations/parse");
+
+  if (is_selected("argv_length")) {
+    argv_length();
+  }
+  if (is_selected("field_count")) {
+    field_count<Fields1>(1);
+    field_count<Fields8>(8);
+    field_count<Fields32>(32);
+    field_count<Fields69>(69);
+  }
+  if (is_selected("sub_command_depth")) {
+    for (std::size_t depth = 0; depth <= 4; depth++) {
+      sub_command_depth(depth);
+    }
+  }
+  if (is_selected("container_type")) {
+    container_type<StringVector>("std::vector<std::string>", false);
+    container_type<IntVector>("std::vector<int>", false);
+    container_type<DoubleVector>("std::vector<double>", true);
+    container_type<Uint64Deque>("std::deque<std::uint64_t>", false);
+    container_type<IntSet>("std::set<int>", false);
+  }
+  if (is_selected("error_rate")) {
+    for (auto percent : {0, 1, 10, 50, 100}) {
+      error_rate(static_cast<std::size_t>(percent));
+    }
+  }
+  if (is_selected("repeated_parse")) {
+    repeated_parse();
+  }
+#ifdef STRUCTOPT_HAS_MEMORY_RESOURCE
+  if (is_selected("memory_resource")) {
+    memory_resource();
+  }
+#endif
+  if (is_selected("environment")) {
+    environment();
+  }
+  if (is_selected("config_file")) {
+    config_file();
+  }
+  if (is_selected("complete")) {
+    for (std::size_t words : {2, 20, 200}) {
+      complete(words);
+    }
+  }
+  if (is_selected("help")) {
+    help();
+  }
+  if (is_selected("concurrent_parse")) {
+    for (std::size_t thread_count : {1, 2, 4, 8}) {
+      concurrent_parse(thread_count);
+    }
+  }
+  if (is_selected("number_conversion")) {
+    number_conversion<int>("int", false);
+    number_conversion<double>("double", true);
+  }
+  if (is_selected("parallel_conversion")) {
+    for (std::size_t count : {1000, 10000, 100000, 1000000}) {
+      parallel_conversion(count);
+    }
+  }
+}
@@ -0,0 +1,77 @@
+# structopt_add_completion(<target> [SHELLS bash|zsh|fish ...] [DESTINATION <dir>])
+#
+# Writes static completion scripts for a program that parses its arguments
+# with structopt::app once the program is built. The program is run with
+# `--structopt-completion <shell> <program>` and prints the script for its
+# arguments, so completing an argument in the shell does not run the program.
+#
+# Only parse(argc, argv) prints the script by itself. A program that uses
+# try_parse(argc, argv) has to print the message of a result whose status is
+# structopt::parse_status::completion_requested.
+#
+# <program> is the name of the executable, e.g., my_app for my_app.exe. The
+# scripts complete the arguments of that name, and are named after it:
+# <program>.bash, _<program> (zsh) and <program>.fish, in DESTINATION, which
+# defaults to ${CMAKE_CURRENT_BINARY_DIR}/completions. Each is generated
+# again whenever the program is.
+
+if(CMAKE_SCRIPT_MODE_FILE)
+  # cmake -DTOOL=<executable> -DSUFFIX=<.exe or empty> -DSHELL=<shell>
+  #       -DDESTINATION=<dir> -P structoptCompletion.cmake
+  get_filename_component(_structopt_program "${TOOL}" NAME)
+  string(LENGTH "${SUFFIX}" _structopt_suffix_length)
+  if(_structopt_suffix_length GREATER 0)
+    string(LENGTH "${_structopt_program}" _structopt_length)
+    math(EXPR _structopt_length "${_structopt_length} - ${_structopt_suffix_length}")
+    string(SUBSTRING "${_structopt_program}" 0 ${_structopt_length} _structopt_program)
+  endif()
+
+  if(SHELL STREQUAL "bash")
+    set(_structopt_output "${DESTINATION}/${_structopt_program}.bash")
+  elseif(SHELL STREQUAL "zsh")
+    set(_structopt_output "${DESTINATION}/_${_structopt_program}")
+  else()
+    set(_structopt_output "${DESTINATION}/${_structopt_program}.${SHELL}")
+  endif()
+
+  file(MAKE_DIRECTORY "${DESTINATION}")
+  execute_process(COMMAND "${TOOL}" --structopt-completion "${SHELL}"
+                          "${_structopt_program}"
+                  OUTPUT_FILE "${_structopt_output}"
+                  RESULT_VARIABLE _structopt_result)
+  if(NOT _structopt_result EQUAL 0)
+    message(FATAL_ERROR "${TOOL} did not print a ${SHELL} completion script")
+  endif()
+  return()
+endif()
+
+set(_STRUCTOPT_COMPLETION_SCRIPT "${CMAKE_CURRENT_LIST_FILE}")
+
+function(structopt_add_completion target)
+  cmake_parse_arguments(ARG "" "DESTINATION" "SHELLS" ${ARGN})
+  if(NOT ARG_SHELLS)
+    set(ARG_SHELLS bash zsh fish)
+  endif()
+  if(NOT ARG_DESTINATION)
+    set(ARG_DESTINATION "${CMAKE_CURRENT_BINARY_DIR}/completions")
+  endif()
+
+  if(CMAKE_CROSSCOMPILING)
+    message(WARNING "structopt_add_completion: ${target} cannot run on this host; "
+                    "its completion scripts are not generated")
+    return()
+  endif()
+
+  foreach(shell ${ARG_SHELLS})
+    if(NOT shell MATCHES "^(bash|zsh|fish)$")
+      message(FATAL_ERROR "structopt_add_completion: unknown shell `${shell}`")
+    endif()
+
+    add_custom_command(TARGET ${target} POST_BUILD
+      COMMAND ${CMAKE_COMMAND} "-DTOOL=$<TARGET_FILE:${target}>"
+              "-DSUFFIX=${CMAKE_EXECUTABLE_SUFFIX}" -DSHELL=${shell}
+              "-DDESTINATION=${ARG_DESTINATION}" -P "${_STRUCTOPT_COMPLETION_SCRIPT}"
+      COMMENT "Generating the ${shell} completion script for ${target}"
+      VERBATIM)
+  endforeach()
+endfunction()
@@ -1,94 +1,443 @@
 
 #pragma once
+#include <atomic>
 #include <cstdlib>
 #include <iostream>
 #include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <structopt/completion.hpp>
 #include <structopt/is_stl_container.hpp>
 #include <structopt/parser.hpp>
 #include <structopt/third_party/visit_struct/visit_struct.hpp>
 #include <type_traits>
+#include <unordered_map>
 #include <vector>
 
 #define STRUCTOPT VISITABLE_STRUCT
 
 namespace structopt {
 
+template <typename T> class parser_for;
+
+// An app can be shared by threads that parse at the same time; each parse
+// has its own parser and argument list. The app only remembers the struct
+// parsed last, for help(), and is written to when that struct changes.
 class app {
-  details::visitor visitor;
+  details::visitor visitor; // the name and the version
+  std::size_t parallel_threshold{0};
+  std::size_t parallel_threads{0};
+  bool expands_response_files{false};
+  details::memory_resource *resource{details::default_memory_resource()};
+
+  // see environment() and config_file(); shared by the copies of this app
+  std::shared_ptr<const details::environment_index> fallback_environment;
+  std::vector<std::shared_ptr<const details::config_file>> config_files;
+
+  // see completer(); by the path of a field, e.g., `build.target`
+  std::unordered_map<std::string, structopt::completer> completers;
+
+  // the schema of the struct parsed last, for help(); see make_parser
+  mutable std::atomic<const details::schema *> schema{nullptr};
+
+  template <typename T> friend class parser_for;
 
 public:
   explicit app(const std::string &name, const std::string &version = "")
       : visitor(name, version) {}
 
-  template <typename T> T parse(const std::vector<std::string> &arguments) {
-    T argument_struct = T();
+  app(const app &other)
+      : visitor(other.visitor), parallel_threshold(other.parallel_threshold),
+        parallel_threads(other.parallel_threads),
+        expands_response_files(other.expands_response_files),
+        resource(other.resource), fallback_environment(other.fallback_environment),
+        config_files(other.config_files), completers(other.completers),
+        schema(other.schema.load()) {}
 
-    // Visit the struct and save flag, optional and positional field names
-    visit_struct::for_each(argument_struct, visitor);
+  app &operator=(const app &other) {
+    visitor = other.visitor;
+    parallel_threshold = other.parallel_threshold;
+    parallel_threads = other.parallel_threads;
+    expands_response_files = other.expands_response_files;
+    resource = other.resource;
+    fallback_environment = other.fallback_environment;
+    config_files = other.config_files;
+    completers = other.completers;
+    schema.store(other.schema.load());
+    return *this;
+  }
+
+  // Convert the values of numeric std::vector and std::deque fields on
+  // several threads once a field has at least `threshold` values
+  //
+  // At most `threads` threads are used, or one per core if `threads` is 0.
+  app &parallel_conversion(std::size_t threshold = 100000, std::size_t threads = 0) {
+    parallel_threshold = threshold;
+    parallel_threads = threads;
+    return *this;
+  }
 
-    // add `help` and `version` optional arguments
-    visitor.optional_field_names.push_back("help");
-    visitor.optional_field_names.push_back("version");
+  // Replace an argument of the form `@path` with the arguments in the file at
+  // `path`, e.g., for argument lists too long for the command line
+  //
+  // Off by default: with it, any `@` argument names a file that is read, so
+  // only turn it on for arguments that come from the user of the program,
+  // not, e.g., for command lines received from elsewhere.
+  app &response_files(bool enabled = true) {
+    expands_response_files = enabled;
+    return *this;
+  }
 
-    // Construct the argument parser
-    structopt::details::parser parser;
-    parser.visitor = visitor;
-    parser.arguments = arguments;
+  // Optional and flag fields that are not named on the command line take
+  // their value from the environment variable with the name of the field,
+  // in upper case and after `prefix`, e.g., APP_LOG_LEVEL for log_level.
+  // The fields of a sub-command use its name too, e.g., APP_BUILD_JOBS.
+  //
+  // The environment is read once, here, and not at every parse.
+  app &environment(const std::string &prefix) {
+    fallback_environment = std::make_shared<const details::environment_index>(prefix);
+    return *this;
+  }
 
-    for (std::size_t i = 1; i < parser.arguments.size(); i++) {
-      parser.current_index = i;
-      visit_struct::for_each(argument_struct, parser);
+  // Optional and flag fields that are neither named on the command line nor
+  // set in the environment take their value from a configuration file, an
+  // INI file or a list of key=value lines, e.g., `log-level = debug`. A file
+  // added later takes precedence over the ones before it.
+  //
+  // The file is read once, here. A file that does not exist is skipped, so
+  // that optional files, e.g., ~/.apprc, can be added unconditionally.
+  app &config_file(const std::string &path) {
+    if (auto file = details::config_file::open(path)) {
+      config_files.push_back(
+          std::make_shared<const details::config_file>(std::move(*file)));
     }
+    return *this;
+  }
+
+  // Offer the values `complete` returns for a field when the program is run
+  // as `<program> __complete <words...>`, e.g., by a completion script that
+  // asks for the values of `build.target`, the field target of the
+  // sub-command build. Enum fields are offered their names without one.
+  app &completer(const std::string &field, structopt::completer complete) {
+    auto path = field;
+    for (auto &c : path) {
+      c = c == '-' ? '_' : c;
+    }
+    completers[path] = std::move(complete);
+    return *this;
+  }
+
+#ifdef STRUCTOPT_HAS_MEMORY_RESOURCE
+  // Take the memory of a parse from `memory_resource`, e.g., an arena:
+  // the arguments, their tokens, and every std::pmr container or string in
+  // the parsed struct. The resource has to outlive the parsed struct.
+  app &memory_resource(std::pmr::memory_resource *memory_resource) {
+    resource = memory_resource;
+    return *this;
+  }
+#endif
+
+  // The parser works on views over the arguments; they are not copied
+  template <typename T> T parse(const std::vector<std::string> &arguments) const {
+    details::argument_list list(arguments.begin(), arguments.end(), resource);
+    return parse<T>(list);
+  }
+
+  template <typename T> T parse(const std::vector<std::string_view> &arguments) const {
+    details::argument_list list(arguments.begin(), arguments.end(), resource);
+    return parse<T>(list);
+  }
+
+  // Also prints the candidates or the script and exits when the program is
+  // run as `<program> __complete <words...>`, see complete(), or with
+  // `--structopt-completion <shell> [<program>]`, see completion_script()
+  template <typename T> T parse(int argc, char *argv[]) const {
+    details::argument_list list(argv, argv + argc, resource);
+    return parse_command_line<T>(list);
+  }
 
-    // directly call the parser to check for `help` and `version` flags
-    std::optional<bool> help = false, version = false;
-    for (std::size_t i = 1; i < parser.arguments.size(); i++) {
-      parser.operator()("help", help);
-      parser.operator()("version", version);
-
-      if (help == true) {
-        // if help is requested, print help and exit
-        visitor.print_help(std::cout);
-        exit(EXIT_SUCCESS);
-      } else if (version == true) {
-        // if version is requested, print version and exit
-        std::cout << visitor.version << "\n";
-        exit(EXIT_SUCCESS);
+  // Parse arguments as they are read, e.g., from std::istream_iterator<std::string>
+  // Like argv, the first argument is the name of the program. Container
+  // fields take their values as they are read; the arguments they are done
+  // with are released, so the input is never held in memory as a whole.
+  template <typename T, typename InputIterator>
+  T parse(InputIterator first, InputIterator last) const {
+    details::argument_list list(resource);
+    list.source = [first, last](std::string &next) mutable {
+      if (first == last) {
+        return false;
       }
+      next = std::string{std::string_view{*first}};
+      ++first;
+      return true;
+    };
+    return parse<T>(list);
+  }
+
+  // Parse arguments as they are returned by `next_argument`, a function
+  // that returns a std::optional of a string, or std::nullopt at the end
+  template <typename T, typename Generator,
+            typename = std::enable_if_t<std::is_invocable<Generator &>::value>>
+  T parse(Generator &&next_argument) const {
+    details::argument_list list(resource);
+    list.source = [&next_argument](std::string &next) {
+      auto result = next_argument();
+      if (!result.has_value()) {
+        return false;
+      }
+      if constexpr (std::is_same<std::decay_t<decltype(*result)>, std::string>::value) {
+        next = std::move(*result);
+      } else {
+        next = std::string{std::string_view{*result}};
+      }
+      return true;
+    };
+    return parse<T>(list);
+  }
+
+  // Like parse, but errors are returned instead of thrown, and a request for
+  // the help or the version is returned instead of printed before exiting
+  template <typename T>
+  parse_result<T> try_parse(const std::vector<std::string> &arguments) const {
+    details::argument_list list(arguments.begin(), arguments.end(), resource);
+    return try_parse<T>(list);
+  }
+
+  template <typename T>
+  parse_result<T> try_parse(const std::vector<std::string_view> &arguments) const {
+    details::argument_list list(arguments.begin(), arguments.end(), resource);
+    return try_parse<T>(list);
+  }
+
+  // A completion, like the help, is returned instead of printed; see
+  // parse_status::completion_requested
+  template <typename T> parse_result<T> try_parse(int argc, char *argv[]) const {
+    details::argument_list list(argv, argv + argc, resource);
+    return try_parse_command_line<T>(list);
+  }
+
+  std::string help() const {
+    auto help_visitor = visitor;
+    help_visitor.schema = schema.load(std::memory_order_acquire);
+    return help_visitor.help();
+  }
+
+  // A static completion script for the arguments of `T`, for bash, zsh or
+  // fish; completing an argument does not run the program.
+  //
+  // The script completes the arguments of `program`, the name the program is
+  // run by, e.g., the name of its executable; by default, the name of the app.
+  //
+  // Running the program with `--structopt-completion <shell> [<program>]` as
+  // its only arguments prints the script, for the name it was run by if
+  // `program` is not given, if it parses argc and argv; see
+  // structopt_add_completion in CMake.
+  template <typename T>
+  std::string completion_script(completion_shell shell,
+                                const std::string &program = "") const {
+    return details::completion_script<T>(shell, program.empty() ? visitor.name : program);
+  }
+
+  // The candidates for the last of `words`, the word at the cursor, after
+  // the words before it; the words do not include the name of the program
+  //
+  // Only the words before the cursor are looked at, and their values are not
+  // converted. Running the program as `<program> __complete <words...>`
+  // prints the candidates, one per line, if it parses argc and argv.
+  template <typename T>
+  std::vector<std::string> complete(const std::vector<std::string_view> &words) const {
+    if (words.empty()) {
+      return complete<T>(std::vector<std::string_view>{""});
     }
+    details::completion_request request{words, &completers, "", {}};
+    details::complete_words<T>(request, 0);
+    return std::move(request.candidates);
+  }
 
-    // if all positional arguments were provided
-    // this list would be empty
-    if (!parser.visitor.positional_field_names.empty()) {
-      for (auto &field_name : parser.visitor.positional_field_names) {
-        if (std::find(parser.visitor.vector_like_positional_field_names.begin(),
-                      parser.visitor.vector_like_positional_field_names.end(),
-                      field_name) ==
-            parser.visitor.vector_like_positional_field_names.end()) {
-          // this positional argument is not a vector-like argument
-          // it expects value(s)
-          throw structopt::exception("Error: expected value for positional argument `" +
-                                         field_name + "`.",
-                                     parser.visitor);
-        }
+private:
+  // What to print for `<program> __complete <words...>` or
+  // `--structopt-completion <shell> [<program>]`, or std::nullopt for any
+  // other arguments
+  template <typename T>
+  std::optional<std::string> completion_output(details::argument_list &arguments) const {
+    if (arguments.has(1) && arguments[1] == "__complete") {
+      std::vector<std::string_view> words;
+      for (std::size_t i = 2; arguments.has(i); i++) {
+        words.push_back(arguments[i]);
+      }
+      std::string result;
+      for (const auto &candidate : complete<T>(words)) {
+        result += candidate;
+        result += '\n';
       }
+      return result;
+    }
+    if (arguments.has(2) && !arguments.has(4) &&
+        arguments[1] == "--structopt-completion") {
+      if (auto shell = details::completion_shell_named(arguments[2])) {
+        const auto program = arguments.has(3)
+                                 ? std::string(arguments[3])
+                                 : details::completion_program_name(arguments[0]);
+        return completion_script<T>(*shell, program);
+      }
+    }
+    return std::nullopt;
+  }
+
+  // Only the command line of the program, its argc and argv, can ask for a
+  // completion, which is printed before the program exits. Other argument
+  // lists, e.g., command lines received from elsewhere, are always parsed.
+  template <typename T> T parse_command_line(details::argument_list &arguments) const {
+    if (auto output = completion_output<T>(arguments)) {
+      std::cout << *output;
+      exit(EXIT_SUCCESS);
+    }
+    return parse<T>(arguments);
+  }
+
+  template <typename T>
+  parse_result<T> try_parse_command_line(details::argument_list &arguments) const {
+    if (auto output = completion_output<T>(arguments)) {
+      return parse_result<T>(details::parse_stop{parse_status::completion_requested,
+                                                 error_code::invalid_value,
+                                                 exception::npos, std::move(*output)});
     }
+    return try_parse<T>(arguments);
+  }
 
+  template <typename T> T parse(details::argument_list &arguments) const {
+    T argument_struct = T();
+    auto parser = make_parser<T>(arguments);
+    parser.parse_fields(argument_struct);
     return argument_struct;
   }
 
-  template <typename T> T parse(int argc, char *argv[]) {
-    std::vector<std::string> arguments;
-    std::copy(argv, argv + argc, std::back_inserter(arguments));
-    return parse<T>(arguments);
+  template <typename T>
+  parse_result<T> try_parse(details::argument_list &arguments) const {
+    T argument_struct = T();
+    auto parser = make_parser<T>(arguments);
+    parser.throws = false;
+    parser.parse_fields(argument_struct);
+    if (parser.stop) {
+      return parse_result<T>(std::move(*parser.stop));
+    }
+    return parse_result<T>(std::move(argument_struct));
   }
 
-  std::string help() const {
-    std::stringstream os;
-    visitor.print_help(os);
-    return os.str();
+  template <typename T>
+  details::parser make_parser(details::argument_list &arguments) const {
+    // `@path` stands for the arguments in the file at `path`
+    if (expands_response_files) {
+      arguments.expand_response_files();
+    }
+
+    // The fields of the struct are described at compile time
+    // Only the first parse of a struct writes, so that threads that share
+    // the app do not take turns at the cache line of `schema`
+    const auto &struct_schema = details::schema_of<T>();
+    if (schema.load(std::memory_order_relaxed) != &struct_schema) {
+      schema.store(&struct_schema, std::memory_order_release);
+    }
+
+    // Construct the argument parser, with its own copy of the visitor
+    structopt::details::parser parser(visitor, arguments);
+    parser.visitor.schema = &struct_schema;
+    parser.schema = &struct_schema;
+    parser.parallel_threshold = parallel_threshold;
+    parser.parallel_threads = parallel_threads;
+    parser.resource = resource;
+    parser.environment = fallback_environment.get();
+    parser.config_files = &config_files;
+    return parser;
+  }
+};
+
+// A parser for one STRUCTOPT struct, built once for programs that parse
+// many command lines, e.g., a job dispatcher
+//
+// Unlike an app, a parser_for is not shared by threads; each thread that
+// parses at the same time needs its own.
+//
+// The schema of `T` is looked up when the parser is constructed, and the
+// memory for the arguments and their tokens is kept from one parse to the
+// next, so a parse only allocates for the fields it fills.
+template <typename T> class parser_for {
+  app app_;
+  details::argument_list arguments_;
+
+public:
+  explicit parser_for(const std::string &name, const std::string &version = "")
+      : app_(name, version) {
+    app_.schema.store(&details::schema_of<T>(), std::memory_order_release);
+  }
+
+  // see app::parallel_conversion
+  parser_for &parallel_conversion(std::size_t threshold = 100000,
+                                  std::size_t threads = 0) {
+    app_.parallel_conversion(threshold, threads);
+    return *this;
   }
+
+  // see app::response_files
+  parser_for &response_files(bool enabled = true) {
+    app_.response_files(enabled);
+    return *this;
+  }
+
+  // see app::environment
+  parser_for &environment(const std::string &prefix) {
+    app_.environment(prefix);
+    return *this;
+  }
+
+  // see app::config_file
+  parser_for &config_file(const std::string &path) {
+    app_.config_file(path);
+    return *this;
+  }
+
+  // see app::completer
+  parser_for &completer(const std::string &field, structopt::completer complete) {
+    app_.completer(field, std::move(complete));
+    return *this;
+  }
+
+  T parse(const std::vector<std::string> &arguments) {
+    arguments_.assign(arguments.begin(), arguments.end());
+    return app_.parse<T>(arguments_);
+  }
+
+  T parse(const std::vector<std::string_view> &arguments) {
+    arguments_.assign(arguments.begin(), arguments.end());
+    return app_.parse<T>(arguments_);
+  }
+
+  T parse(int argc, char *argv[]) {
+    arguments_.assign(argv, argv + argc);
+    return app_.parse_command_line<T>(arguments_);
+  }
+
+  parse_result<T> try_parse(const std::vector<std::string> &arguments) {
+    arguments_.assign(arguments.begin(), arguments.end());
+    return app_.try_parse<T>(arguments_);
+  }
+
+  parse_result<T> try_parse(const std::vector<std::string_view> &arguments) {
+    arguments_.assign(arguments.begin(), arguments.end());
+    return app_.try_parse<T>(arguments_);
+  }
+
+  parse_result<T> try_parse(int argc, char *argv[]) {
+    arguments_.assign(argv, argv + argc);
+    return app_.try_parse_command_line<T>(arguments_);
+  }
+
+  // Forgets the arguments of the last parse, e.g., to release the response
+  // files it read. Their memory is kept for the next parse.
+  void reset() { arguments_.clear(); }
+
+  std::string help() const { return app_.help(); }
 };
 
 } // namespace structopt
@@ -0,0 +1,44 @@
+#pragma once
+#include <optional>
+#include <string_view>
+#include <structopt/string.hpp>
+
+namespace structopt {
+
+// The spellings of boolean values, matched regardless of case
+//
+// Specialize to accept other spellings, e.g.,
+//
+//   template <> struct structopt::bool_literals<> {
+//     static constexpr std::string_view true_literals[] = {"true", "enabled"};
+//     static constexpr std::string_view false_literals[] = {"false", "disabled"};
+//   };
+template <typename = void> struct bool_literals {
+  static constexpr std::string_view true_literals[] = {"on", "yes", "1", "true"};
+  static constexpr std::string_view false_literals[] = {"off", "no", "0", "false"};
+};
+
+namespace details {
+
+// Convert a boolean argument without copying or allocating, e.g., YES => true
+//
+// A template, so that bool_literals<> is only looked into where a boolean
+// is parsed, after any specialization of it
+template <typename Literals = bool_literals<>>
+constexpr std::optional<bool> parse_bool(std::string_view input) {
+  for (auto literal : Literals::true_literals) {
+    if (is_case_insensitive_equal(input, literal)) {
+      return true;
+    }
+  }
+  for (auto literal : Literals::false_literals) {
+    if (is_case_insensitive_equal(input, literal)) {
+      return false;
+    }
+  }
+  return std::nullopt;
+}
+
+} // namespace details
+
+} // namespace structopt
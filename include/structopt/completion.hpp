@@ -0,0 +1,566 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <structopt/is_specialization.hpp>
+#include <structopt/option_index.hpp>
+#include <structopt/schema.hpp>
+#include <structopt/third_party/magic_enum/magic_enum.hpp>
+#include <structopt/third_party/visit_struct/visit_struct.hpp>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace structopt {
+
+enum class completion_shell { bash, zsh, fish };
+
+// The values a field can take, computed when the shell asks for them, e.g.,
+// the branches of a repository; `prefix` is the word at the cursor so far
+using completer = std::function<std::vector<std::string>(std::string_view prefix)>;
+
+namespace details {
+
+inline std::optional<completion_shell> completion_shell_named(std::string_view name) {
+  if (name == "bash") {
+    return completion_shell::bash;
+  } else if (name == "zsh") {
+    return completion_shell::zsh;
+  } else if (name == "fish") {
+    return completion_shell::fish;
+  }
+  return std::nullopt;
+}
+
+// An optional or flag argument, as offered by a completion script
+struct completion_option {
+  std::string name;     // the long form, in kebab case, e.g., log-level
+  char short_name{0};   // 0 if the initial belongs to an earlier field
+  bool takes_value{true};
+  std::vector<std::string_view> values; // the names of an enum, if any
+};
+
+// A command, or a sub-command, as offered by a completion script
+struct completion_command {
+  std::string path; // e.g., `build.test` for the sub-command test of build
+  std::string name;
+  std::vector<completion_option> options;
+  std::vector<std::string_view> values; // enum names that positional fields take
+  bool takes_files{false};              // a positional field takes any value
+  std::vector<completion_command> sub_commands;
+};
+
+// The names of the enum that a field, or the elements of a container field,
+// take; empty if there is no such enum
+template <typename T> std::vector<std::string_view> completion_values() {
+  if constexpr (std::is_enum<T>::value) {
+    const auto names = magic_enum::enum_names<T>();
+    return {names.begin(), names.end()};
+  } else if constexpr (structopt::is_specialization<T, std::optional>::value ||
+                       is_container_field<T>()) {
+    return completion_values<typename T::value_type>();
+  } else {
+    return {};
+  }
+}
+
+// Describe the arguments of a STRUCTOPT struct, and of its sub-commands
+template <typename T>
+completion_command describe_completion(const std::string &name, const std::string &path) {
+  completion_command result;
+  result.name = name;
+  result.path = path;
+
+  const auto &schema = schema_of<T>();
+  const auto add_option = [&](std::string_view field_name, std::size_t field,
+                              bool takes_value, std::vector<std::string_view> values) {
+    completion_option option;
+    option.name = std::string(field_name);
+    for (auto &c : option.name) {
+      c = c == '_' ? '-' : c;
+    }
+    if (schema.option_field_index.find_short(field_name[0]) == field) {
+      option.short_name = field_name[0];
+    }
+    option.takes_value = takes_value;
+    option.values = std::move(values);
+    result.options.push_back(std::move(option));
+  };
+
+  std::size_t field = 0;
+  visit_struct::visit_types<T>([&](const char *field_name, auto type) {
+    using field_type = typename decltype(type)::type;
+    switch (kind_of<field_type>()) {
+    case field_kind::flag:
+      add_option(field_name, field, false, {});
+      break;
+    case field_kind::optional:
+      add_option(field_name, field, true, completion_values<field_type>());
+      break;
+    case field_kind::positional: {
+      auto values = completion_values<field_type>();
+      if (values.empty()) {
+        result.takes_files = true;
+      }
+      result.values.insert(result.values.end(), values.begin(), values.end());
+      break;
+    }
+    case field_kind::nested_struct:
+      if constexpr (visit_struct::traits::is_visitable<field_type>::value) {
+        result.sub_commands.push_back(describe_completion<field_type>(
+            field_name, path.empty() ? field_name : path + "." + field_name));
+      }
+      break;
+    }
+    field += 1;
+  });
+  add_option("help", schema.help_field(), false, {});
+  add_option("version", schema.version_field(), false, {});
+  return result;
+}
+
+// The name a program is run by, from its path, e.g., bin/my-app.exe => my-app
+inline std::string completion_program_name(std::string_view path) {
+  const auto slash = path.find_last_of("/\\");
+  if (slash != std::string_view::npos) {
+    path.remove_prefix(slash + 1);
+  }
+  const std::string_view suffix = ".exe";
+  if (path.size() > suffix.size() && path.substr(path.size() - suffix.size()) == suffix) {
+    path.remove_suffix(suffix.size());
+  }
+  return std::string(path);
+}
+
+// A name that can be part of a shell function name, e.g., my-app => my_app
+inline std::string completion_function_name(const std::string &program) {
+  std::string result = "_";
+  for (auto c : program) {
+    const bool is_word = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+                         (c >= '0' && c <= '9') || c == '_';
+    result += is_word ? c : '_';
+  }
+  return result;
+}
+
+template <typename F>
+void for_each_command(const completion_command &command, const F &f) {
+  f(command);
+  for (const auto &sub_command : command.sub_commands) {
+    for_each_command(sub_command, f);
+  }
+}
+
+// The words offered for a command: its options and sub-commands, and the
+// names its positional fields take
+inline std::string completion_words(const completion_command &command) {
+  std::string result;
+  const auto add = [&result](std::string_view word) {
+    if (!result.empty()) {
+      result += ' ';
+    }
+    result += word;
+  };
+  for (const auto &option : command.options) {
+    add("--" + option.name);
+    if (option.short_name) {
+      add(std::string{'-', option.short_name});
+    }
+  }
+  for (const auto &sub_command : command.sub_commands) {
+    add(sub_command.name);
+  }
+  for (auto value : command.values) {
+    add(value);
+  }
+  return result;
+}
+
+inline std::string completion_values_list(const completion_option &option) {
+  std::string result;
+  for (auto value : option.values) {
+    result += result.empty() ? "" : " ";
+    result += value;
+  }
+  return result;
+}
+
+// The case patterns, e.g., `":--log-level"|":-l"`, that match an option
+// taking a value right before the cursor in `command`
+inline std::string completion_option_pattern(const completion_command &command,
+                                             const completion_option &option) {
+  auto result = "\"" + command.path + ":--" + option.name + "\"";
+  if (option.short_name) {
+    result += "|\"" + command.path + ":-" + option.short_name + "\"";
+  }
+  return result;
+}
+
+// bash and zsh share the way they find the sub-command the cursor is in:
+// each word that names a sub-command of the current one enters it
+inline void write_completion_sub_command_cases(std::ostream &os,
+                                               const completion_command &root) {
+  for_each_command(root, [&os](const completion_command &command) {
+    for (const auto &sub_command : command.sub_commands) {
+      os << "      \"" << command.path << ":" << sub_command.name << "\") command=\""
+         << sub_command.path << "\" ;;\n";
+    }
+  });
+}
+
+inline void write_bash_completion(std::ostream &os, const completion_command &root,
+                                  const std::string &program) {
+  const auto function = completion_function_name(program);
+  os << "# bash completion for " << program << ", generated by structopt\n"
+     << function << "() {\n"
+     << "  local cur=\"${COMP_WORDS[COMP_CWORD]}\"\n"
+     << "  local prev=\"${COMP_WORDS[COMP_CWORD-1]}\"\n"
+     << "  local command=\"\" i\n"
+     << "  for ((i = 1; i < COMP_CWORD; i++)); do\n"
+     << "    case \"${command}:${COMP_WORDS[i]}\" in\n";
+  write_completion_sub_command_cases(os, root);
+  os << "    esac\n"
+     << "  done\n"
+     << "  case \"${command}:${prev}\" in\n";
+  for_each_command(root, [&os](const completion_command &command) {
+    for (const auto &option : command.options) {
+      if (!option.takes_value) {
+        continue;
+      }
+      os << "    " << completion_option_pattern(command, option) << ")\n";
+      if (option.values.empty()) {
+        os << "      COMPREPLY=($(compgen -f -- \"${cur}\"))\n";
+      } else {
+        os << "      COMPREPLY=($(compgen -W \"" << completion_values_list(option)
+           << "\" -- \"${cur}\"))\n";
+      }
+      os << "      return ;;\n";
+    }
+  });
+  os << "  esac\n"
+     << "  case \"${command}\" in\n";
+  for_each_command(root, [&os](const completion_command &command) {
+    os << "    \"" << command.path << "\")\n"
+       << "      COMPREPLY=($(compgen -W \"" << completion_words(command)
+       << "\" -- \"${cur}\"))\n";
+    if (command.takes_files) {
+      os << "      COMPREPLY+=($(compgen -f -- \"${cur}\"))\n";
+    }
+    os << "      ;;\n";
+  });
+  os << "  esac\n"
+     << "}\n"
+     << "complete -F " << function << " " << program << "\n";
+}
+
+inline void write_zsh_completion(std::ostream &os, const completion_command &root,
+                                 const std::string &program) {
+  const auto function = completion_function_name(program);
+  os << "#compdef " << program << "\n"
+     << "# zsh completion for " << program << ", generated by structopt\n"
+     << function << "() {\n"
+     << "  local command=\"\" i\n"
+     << "  for ((i = 2; i < CURRENT; i++)); do\n"
+     << "    case \"${command}:${words[i]}\" in\n";
+  write_completion_sub_command_cases(os, root);
+  os << "    esac\n"
+     << "  done\n"
+     << "  case \"${command}:${words[CURRENT-1]}\" in\n";
+  for_each_command(root, [&os](const completion_command &command) {
+    for (const auto &option : command.options) {
+      if (!option.takes_value) {
+        continue;
+      }
+      os << "    " << completion_option_pattern(command, option) << ")\n";
+      if (option.values.empty()) {
+        os << "      _files\n";
+      } else {
+        os << "      compadd -- " << completion_values_list(option) << "\n";
+      }
+      os << "      return ;;\n";
+    }
+  });
+  os << "  esac\n"
+     << "  case \"${command}\" in\n";
+  for_each_command(root, [&os](const completion_command &command) {
+    os << "    \"" << command.path << "\")\n"
+       << "      compadd -- " << completion_words(command) << "\n";
+    if (command.takes_files) {
+      os << "      _files\n";
+    }
+    os << "      ;;\n";
+  });
+  os << "  esac\n"
+     << "}\n"
+     << "if [[ \"${funcstack[1]}\" == \"" << function << "\" ]]; then\n"
+     << "  " << function << " \"$@\"\n"
+     << "else\n"
+     << "  compdef " << function << " " << program << "\n"
+     << "fi\n";
+}
+
+inline void write_fish_completion(std::ostream &os, const completion_command &root,
+                                  const std::string &program) {
+  os << "# fish completion for " << program << ", generated by structopt\n";
+  const auto write_command = [&](const completion_command &command,
+                                 const std::string &condition) {
+    const auto prefix = "complete -c " + program + " -n '" + condition + "'";
+    if (!command.takes_files) {
+      os << prefix << " -f\n";
+    }
+    for (const auto &option : command.options) {
+      os << prefix << " -l " << option.name;
+      if (option.short_name) {
+        os << " -s " << option.short_name;
+      }
+      if (option.takes_value && option.values.empty()) {
+        os << " -r -F";
+      } else if (option.takes_value) {
+        os << " -r -f -a '" << completion_values_list(option) << "'";
+      }
+      os << "\n";
+    }
+    for (const auto &sub_command : command.sub_commands) {
+      os << prefix << " -f -a " << sub_command.name << "\n";
+    }
+    for (auto value : command.values) {
+      os << prefix << " -f -a " << value << "\n";
+    }
+  };
+
+  // a command is active once its name has been seen, and until the name of
+  // one of its sub-commands is
+  const auto not_in_sub_command = [](const completion_command &command) {
+    std::string result;
+    if (!command.sub_commands.empty()) {
+      result = "not __fish_seen_subcommand_from";
+      for (const auto &sub_command : command.sub_commands) {
+        result += " " + sub_command.name;
+      }
+    }
+    return result;
+  };
+  const auto root_condition = not_in_sub_command(root);
+  write_command(root, root_condition.empty() ? "true" : root_condition);
+  for (const auto &sub_command : root.sub_commands) {
+    for_each_command(sub_command, [&](const completion_command &command) {
+      auto condition = "__fish_seen_subcommand_from " + command.name;
+      const auto rest = not_in_sub_command(command);
+      if (!rest.empty()) {
+        condition += "; and " + rest;
+      }
+      write_command(command, condition);
+    });
+  }
+}
+
+// A static completion script for the arguments of `T`; the shell does not
+// run the program to complete its arguments
+template <typename T>
+std::string completion_script(completion_shell shell, const std::string &program) {
+  const auto root = describe_completion<T>(program, "");
+  std::stringstream os;
+  switch (shell) {
+  case completion_shell::bash:
+    write_bash_completion(os, root, program);
+    break;
+  case completion_shell::zsh:
+    write_zsh_completion(os, root, program);
+    break;
+  case completion_shell::fish:
+    write_fish_completion(os, root, program);
+    break;
+  }
+  return os.str();
+}
+
+// The state of `<program> __complete <words...>`, where the last word is the
+// one at the cursor, e.g., `""` right after a space
+struct completion_request {
+  const std::vector<std::string_view> &words;
+  const std::unordered_map<std::string, completer> *completers{nullptr};
+  std::string scope; // e.g., `build.` in the sub-command build
+  std::vector<std::string> candidates;
+
+  std::string_view cursor() const { return words.back(); }
+
+  // Offers `before` followed by `value`, if it completes the word at the cursor
+  void offer(std::string_view before, std::string_view value) {
+    auto word = cursor();
+    const auto common = std::min(word.size(), before.size());
+    if (word.substr(0, common) != before.substr(0, common)) {
+      return;
+    }
+    word.remove_prefix(common);
+    if (word == value.substr(0, word.size())) {
+      candidates.emplace_back(before);
+      candidates.back() += value;
+    }
+  }
+
+  // Offers `--name`, in kebab case, if it completes the word at the cursor
+  void offer_option(std::string_view name) {
+    auto word = cursor();
+    if (word.substr(0, 2) != std::string_view("--").substr(0, word.size())) {
+      return;
+    }
+    word.remove_prefix(std::min<std::size_t>(word.size(), 2));
+    if (word.size() <= name.size() &&
+        is_kebab_case_equal(word, name.substr(0, word.size()))) {
+      auto &candidate = candidates.emplace_back("--");
+      for (auto c : name) {
+        candidate += c == '_' ? '-' : c;
+      }
+    }
+  }
+};
+
+template <typename T> void complete_words(completion_request &request, std::size_t first);
+
+// The functions that complete the fields of a STRUCTOPT struct, by position,
+// so that a field is completed without visiting the others
+template <typename T> struct completion_table {
+  using values_function = std::vector<std::string_view> (*)();
+  using words_function = void (*)(completion_request &, std::size_t);
+
+  static constexpr std::size_t field_count = visit_struct::field_count<T>();
+
+  template <typename F> static constexpr words_function words_of() {
+    if constexpr (kind_of<F>() == field_kind::nested_struct) {
+      return &complete_words<F>;
+    } else {
+      return nullptr;
+    }
+  }
+
+  template <std::size_t... I>
+  static constexpr std::array<values_function, field_count>
+  make_values(std::index_sequence<I...>) {
+    return {{&completion_values<visit_struct::type_at<I, T>>...}};
+  }
+
+  template <std::size_t... I>
+  static constexpr std::array<words_function, field_count>
+  make_sub_commands(std::index_sequence<I...>) {
+    return {{words_of<visit_struct::type_at<I, T>>()...}};
+  }
+
+  static constexpr std::array<values_function, field_count> values =
+      make_values(std::make_index_sequence<field_count>{});
+
+  static constexpr std::array<words_function, field_count> sub_commands =
+      make_sub_commands(std::make_index_sequence<field_count>{});
+};
+
+// Offers the values of a field: the names of its enum, and the candidates
+// of the completer registered for it
+template <typename T>
+void complete_value(completion_request &request, std::size_t field,
+                    std::string_view before) {
+  const auto &schema = schema_of<T>();
+  for (auto value : completion_table<T>::values[field]()) {
+    request.offer(before, value);
+  }
+  if (request.completers) {
+    auto path = request.scope + schema.fields[field].name;
+    const auto completer = request.completers->find(path);
+    if (completer != request.completers->end()) {
+      const auto word = request.cursor();
+      for (const auto &value :
+           completer->second(word.substr(std::min(word.size(), before.size())))) {
+        request.offer(before, value);
+      }
+    }
+  }
+}
+
+// Works out the sub-command and the field at the cursor from the words
+// before it, and offers the candidates for the word at the cursor
+//
+// Values are neither converted nor validated, and no struct is constructed;
+// the words after `first` are looked at once each.
+template <typename T>
+void complete_words(completion_request &request, std::size_t first) {
+  const auto &schema = schema_of<T>();
+  const auto takes_value = [&schema](std::size_t field) {
+    return field < schema.field_count &&
+           schema.fields[field].kind == field_kind::optional;
+  };
+  const auto cursor = request.words.size() - 1;
+  std::size_t positional = 0;
+  bool only_positional = false; // after `--`
+
+  for (auto i = first; i < cursor; i++) {
+    const auto word = request.words[i];
+    if (!only_positional && word == "--") {
+      only_positional = true;
+      continue;
+    }
+    if (!only_positional && word.size() > 1 && word[0] == '-') {
+      const auto field =
+          schema.option_field_index.find(word.substr(0, word.find('=')));
+      if (takes_value(field) && word.find('=') == std::string_view::npos) {
+        if (i + 1 == cursor) {
+          // the word at the cursor is the value of this option
+          complete_value<T>(request, field, "");
+          return;
+        }
+        i += 1; // skip the value
+      }
+      continue;
+    }
+    const auto field = schema.field_index.find_long(word);
+    if (!only_positional && field != option_index::npos &&
+        schema.fields[field].kind == field_kind::nested_struct) {
+      // the rest of the words are for the sub-command
+      request.scope += std::string(schema.fields[field].name) + ".";
+      completion_table<T>::sub_commands[field](request, i + 1);
+      return;
+    }
+    if (positional < schema.positional_count &&
+        !schema.fields[schema.positional_fields[positional]].is_container) {
+      positional += 1;
+    }
+  }
+
+  const auto word = request.cursor();
+  if (!only_positional && !word.empty() && word[0] == '-') {
+    const auto delimiter = word.find('=');
+    if (delimiter != std::string_view::npos) {
+      // e.g., --log-level=de
+      const auto field = schema.option_field_index.find(word.substr(0, delimiter));
+      if (takes_value(field)) {
+        complete_value<T>(request, field, word.substr(0, delimiter + 1));
+      }
+      return;
+    }
+    for (std::size_t field = 0; field < schema.field_count; field++) {
+      if (schema.is_option_field(field)) {
+        request.offer_option(schema.fields[field].name);
+      }
+    }
+    request.offer_option("help");
+    request.offer_option("version");
+    return;
+  }
+
+  for (std::size_t field = 0; field < schema.field_count; field++) {
+    if (schema.fields[field].kind == field_kind::nested_struct) {
+      request.offer("", schema.fields[field].name);
+    }
+  }
+  if (positional < schema.positional_count) {
+    complete_value<T>(request, schema.positional_fields[positional], "");
+  }
+}
+
+} // namespace details
+
+} // namespace structopt
@@ -0,0 +1,179 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <structopt/hash_table.hpp>
+#include <structopt/option_index.hpp>
+#include <structopt/response_file.hpp>
+#include <utility>
+#include <vector>
+
+namespace structopt {
+
+namespace details {
+
+// The options in a configuration file, indexed by section and name
+//
+// The file is an INI file, or a list of key=value lines:
+//
+//   # a comment; so is a line that starts with ;
+//   log-level = debug
+//   verbose
+//   [build]
+//   target = "release"
+//
+// A key names an optional or flag field; `-` and `_` are interchangeable,
+// as they are on the command line. A key without a value is `true`, and a
+// value in quotes is taken without them. The keys in a section name the
+// fields of the sub-command with that name, e.g., [build.test] for the
+// sub-command test of the sub-command build.
+//
+// Keys and values are views into the memory-mapped file; nothing is copied.
+// A key that is set more than once keeps its last value.
+class config_file {
+public:
+  struct entry {
+    std::string_view section;
+    std::string_view key;
+    std::string_view value;
+    std::size_t line{0};
+  };
+
+private:
+  std::string path_;
+  mapped_file file_;
+  std::vector<entry> entries_;
+  std::vector<std::uint32_t> slots_; // 1 + the position in `entries_`; 0 is empty
+
+  static bool is_blank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+  static std::string_view trim(std::string_view text) {
+    while (!text.empty() && is_blank(text.front())) {
+      text.remove_prefix(1);
+    }
+    while (!text.empty() && is_blank(text.back())) {
+      text.remove_suffix(1);
+    }
+    return text;
+  }
+
+  // The hash of `scope` and `name`, where `scope` is empty or a section
+  // followed by `.`, e.g., `build.`
+  static std::size_t hash(std::string_view section, bool has_dot, std::string_view name) {
+    fnv1a result;
+    result.add(section, normalize_option_char);
+    if (has_dot) {
+      result.add('.');
+    }
+    return result.add(name, normalize_option_char).value();
+  }
+
+  static bool is_empty(std::uint32_t slot) { return slot == 0; }
+
+  static bool is_scope_equal(std::string_view section, std::string_view scope) {
+    if (section.empty() || scope.empty()) {
+      return section.empty() && scope.empty();
+    }
+    return scope.back() == '.' &&
+           is_kebab_case_equal(section, scope.substr(0, scope.size() - 1));
+  }
+
+  void index(std::string_view contents) {
+    // at most one entry per line
+    const auto lines = std::count(contents.begin(), contents.end(), '\n');
+    entries_.reserve(static_cast<std::size_t>(lines) + 1);
+
+    std::string_view section;
+    std::size_t line = 0;
+    while (!contents.empty()) {
+      line += 1;
+      const auto end = contents.find('\n');
+      auto text = trim(contents.substr(0, end));
+      contents.remove_prefix(end == std::string_view::npos ? contents.size() : end + 1);
+
+      if (text.empty() || text[0] == '#' || text[0] == ';') {
+        continue;
+      } else if (text[0] == '[') {
+        const auto close = text.find(']');
+        section = trim(text.substr(1, close == std::string_view::npos ? text.npos
+                                                                       : close - 1));
+        continue;
+      }
+
+      const auto delimiter = text.find('=');
+      const auto key = trim(text.substr(0, delimiter));
+      auto value = delimiter == std::string_view::npos
+                       ? std::string_view("true")
+                       : trim(text.substr(delimiter + 1));
+      if (value.size() >= 2 && (value[0] == '"' || value[0] == '\'') &&
+          value.back() == value[0]) {
+        value = value.substr(1, value.size() - 2);
+      }
+      if (!key.empty()) {
+        entries_.push_back({section, key, value, line});
+      }
+    }
+
+    slots_.assign(hash_table_capacity(entries_.size()), 0);
+    for (std::size_t k = 0; k < entries_.size(); k++) {
+      const auto &e = entries_[k];
+      // the later value replaces the earlier one
+      const auto is_same_key = [this, &e](std::uint32_t slot) {
+        const auto &other = entries_[slot - 1];
+        return is_kebab_case_equal(other.section, e.section) &&
+               is_kebab_case_equal(other.key, e.key);
+      };
+      const auto i = hash_table_probe(slots_, hash(e.section, !e.section.empty(), e.key),
+                                      is_empty, is_same_key);
+      slots_[i] = static_cast<std::uint32_t>(k + 1);
+    }
+  }
+
+public:
+  // Indexes `contents`, which has to outlive the index
+  explicit config_file(std::string_view contents, std::string path = "")
+      : path_(std::move(path)) {
+    index(contents);
+  }
+
+  config_file(const config_file &) = delete;
+  config_file &operator=(const config_file &) = delete;
+
+  // Returns std::nullopt if the file cannot be opened
+  static std::optional<config_file> open(const std::string &path) {
+    auto file = mapped_file::open(path);
+    if (!file) {
+      return std::nullopt;
+    }
+    std::optional<config_file> result(std::in_place, std::string_view{}, path);
+    // the views stay valid when the file is moved; the mapping does not move
+    result->file_ = std::move(*file);
+    result->index(result->file_.contents());
+    return result;
+  }
+
+  config_file(config_file &&) = default;
+  config_file &operator=(config_file &&) = default;
+
+  const std::string &path() const { return path_; }
+
+  // The entry for a field, e.g., `target` in the scope `build.`, or nullptr
+  const entry *find(std::string_view scope, std::string_view field) const {
+    const auto has_dot = !scope.empty();
+    const auto section = has_dot ? scope.substr(0, scope.size() - 1) : scope;
+    const auto i = hash_table_probe(slots_, hash(section, has_dot, field), is_empty,
+                                    [this, scope, field](std::uint32_t slot) {
+                                      const auto &e = entries_[slot - 1];
+                                      return is_kebab_case_equal(e.key, field) &&
+                                             is_scope_equal(e.section, scope);
+                                    });
+    return is_empty(slots_[i]) ? nullptr : &entries_[slots_[i] - 1];
+  }
+};
+
+} // namespace details
+
+} // namespace structopt
@@ -0,0 +1,115 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <limits>
+#include <optional>
+#include <string_view>
+#include <structopt/hash_table.hpp>
+#include <structopt/string.hpp>
+#include <structopt/third_party/magic_enum/magic_enum.hpp>
+#include <type_traits>
+
+namespace structopt {
+
+// Specialize to match the names of an enum regardless of case, e.g.,
+//
+//   template <> struct structopt::case_insensitive_enum<Codec> : std::true_type {};
+template <typename T> struct case_insensitive_enum : std::false_type {};
+
+namespace details {
+
+constexpr bool is_enum_name_equal(std::string_view lhs, std::string_view rhs,
+                                  bool ignore_case) {
+  if (lhs.size() != rhs.size()) {
+    return false;
+  }
+  for (std::size_t i = 0; i < lhs.size(); i++) {
+    const auto l = ignore_case ? to_lower_ascii(lhs[i]) : lhs[i];
+    const auto r = ignore_case ? to_lower_ascii(rhs[i]) : rhs[i];
+    if (l != r) {
+      return false;
+    }
+  }
+  return true;
+}
+
+constexpr std::size_t enum_name_hash(std::string_view name, bool ignore_case) {
+  return fnv1a()
+      .add(name, [ignore_case](char c) { return ignore_case ? to_lower_ascii(c) : c; })
+      .value();
+}
+
+// Maps the names of an enum to their values
+//
+// The table is an open addressing hash table, built at compile time from
+// magic_enum::enum_names<T>() and at most half full, so a lookup costs the
+// same no matter how many values the enum has.
+template <typename T> struct enum_index {
+  static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+  static constexpr std::size_t count = magic_enum::enum_count<T>();
+  static constexpr bool ignore_case = case_insensitive_enum<T>::value;
+
+  static constexpr std::size_t capacity = hash_table_capacity(count);
+
+  static constexpr bool is_empty(std::size_t slot) { return slot == npos; }
+
+  // position of the name in magic_enum::enum_names<T>(), or npos
+  static constexpr std::array<std::size_t, capacity> slots = [] {
+    std::array<std::size_t, capacity> result{};
+    for (auto &slot : result) {
+      slot = npos;
+    }
+    constexpr auto names = magic_enum::enum_names<T>();
+    for (std::size_t i = 0; i < count; i++) {
+      // the names of an enum are unique
+      result[hash_table_probe(result, enum_name_hash(names[i], ignore_case), is_empty,
+                              [](std::size_t) { return false; })] = i;
+    }
+    return result;
+  }();
+
+  // The names, separated by ", ", e.g., "red, blue, green"
+  static constexpr std::size_t allowed_names_size = [] {
+    std::size_t result = 0;
+    for (auto name : magic_enum::enum_names<T>()) {
+      result += name.size() + 2;
+    }
+    return result < 2 ? 0 : result - 2; // an enum can have no enumerators
+  }();
+
+  static constexpr std::array<char, allowed_names_size> allowed_names_buffer = [] {
+    std::array<char, allowed_names_size> result{};
+    std::size_t k = 0;
+    for (auto name : magic_enum::enum_names<T>()) {
+      if (k > 0) {
+        result[k++] = ',';
+        result[k++] = ' ';
+      }
+      for (auto c : name) {
+        result[k++] = c;
+      }
+    }
+    return result;
+  }();
+
+  static constexpr std::string_view allowed_names() {
+    return {allowed_names_buffer.data(), allowed_names_buffer.size()};
+  }
+
+  static std::optional<T> find(std::string_view name) {
+    constexpr auto names = magic_enum::enum_names<T>();
+    const auto matches = [&names, name](std::size_t i) {
+      return is_enum_name_equal(names[i], name, ignore_case);
+    };
+    const auto hash = enum_name_hash(name, ignore_case);
+    const auto slot = slots[hash_table_probe(slots, hash, is_empty, matches)];
+    if (is_empty(slot)) {
+      return std::nullopt;
+    }
+    return magic_enum::enum_value<T>(slot);
+  }
+};
+
+} // namespace details
+
+} // namespace structopt
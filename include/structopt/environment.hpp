@@ -0,0 +1,169 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <structopt/hash_table.hpp>
+#include <vector>
+
+#if defined(_WIN32)
+#include <stdlib.h> // _environ
+#elif defined(__APPLE__)
+#include <crt_externs.h> // _NSGetEnviron
+#else
+extern "C" {
+extern char **environ; // not declared by every <unistd.h>
+}
+#endif
+
+namespace structopt {
+
+namespace details {
+
+// The variables of the environment of this process, as NAME=value strings
+inline char **environment_variables() {
+#if defined(_WIN32)
+  return _environ;
+#elif defined(__APPLE__)
+  return *_NSGetEnviron();
+#else
+  return environ;
+#endif
+}
+
+// Names of environment variables are upper case, with `_` for `-` and `.`,
+// e.g., the field log-level falls back to LOG_LEVEL
+constexpr char to_environment_char(char c) {
+  if (c == '-' || c == '.') {
+    return '_';
+  }
+  return (c >= 'a' && c <= 'z') ? static_cast<char>(c - 'a' + 'A') : c;
+}
+
+// The environment variables whose names start with a prefix, e.g., APP_,
+// indexed by the rest of their names, e.g., LOG_LEVEL
+//
+// The environment is scanned once, when the index is built; later changes
+// to it are not seen. Names and values are copied back to back into a
+// single buffer and probed with an open addressing table, so a lookup costs
+// the same no matter how many variables there are.
+class environment_index {
+  struct slot {
+    std::uint32_t offset{0}; // of the name in `text_`; the value follows it
+    std::uint32_t name_length{0};
+    std::uint32_t value_length{0};
+    bool is_used{false};
+  };
+
+  std::string prefix_;
+  std::string text_;
+  std::vector<slot> slots_;
+
+  // The hash of the name of the variable for `scope` and `field` together
+  static std::size_t hash(std::string_view scope, std::string_view field) {
+    fnv1a result;
+    result.add(scope, to_environment_char).add(field, to_environment_char);
+    return result.value();
+  }
+
+  static bool is_empty(const slot &s) { return !s.is_used; }
+
+  static bool is_name_equal(std::string_view name, std::string_view scope,
+                            std::string_view field) {
+    if (name.size() != scope.size() + field.size()) {
+      return false;
+    }
+    for (std::size_t i = 0; i < scope.size(); i++) {
+      if (name[i] != to_environment_char(scope[i])) {
+        return false;
+      }
+    }
+    for (std::size_t i = 0; i < field.size(); i++) {
+      if (name[scope.size() + i] != to_environment_char(field[i])) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+public:
+  // `prefix` is the name of the program, e.g., APP, and is followed by `_`
+  // in the names of its variables. Without a prefix, every variable is
+  // indexed.
+  explicit environment_index(std::string_view prefix,
+                             char **variables = environment_variables()) {
+    for (auto c : prefix) {
+      prefix_ += to_environment_char(c);
+    }
+    if (!prefix_.empty() && prefix_.back() != '_') {
+      prefix_ += '_';
+    }
+
+    std::vector<std::string_view> names, values;
+    for (auto variable = variables; variable && *variable; ++variable) {
+      const std::string_view entry(*variable);
+      const auto delimiter = entry.find('=');
+      if (delimiter == std::string_view::npos ||
+          entry.substr(0, delimiter).substr(0, prefix_.size()) != prefix_ ||
+          delimiter == prefix_.size()) {
+        continue;
+      }
+      names.push_back(entry.substr(prefix_.size(), delimiter - prefix_.size()));
+      values.push_back(entry.substr(delimiter + 1));
+    }
+
+    slots_.resize(hash_table_capacity(names.size()));
+
+    for (std::size_t k = 0; k < names.size(); k++) {
+      // a duplicate name keeps the first variable, like getenv
+      const auto i = hash_table_probe(slots_, hash(names[k], {}), is_empty,
+                                      [this, &names, k](const slot &s) {
+                                        return name(s) == names[k];
+                                      });
+      if (is_empty(slots_[i])) {
+        slots_[i] = {static_cast<std::uint32_t>(text_.size()),
+                     static_cast<std::uint32_t>(names[k].size()),
+                     static_cast<std::uint32_t>(values[k].size()), true};
+        text_ += names[k];
+        text_ += values[k];
+      }
+    }
+  }
+
+  // The name of the variable for a field, e.g., APP_BUILD_LOG_LEVEL for
+  // the field log-level of the sub-command build, whose scope is `build.`
+  std::string name(std::string_view scope, std::string_view field) const {
+    auto result = prefix_;
+    for (auto part : {scope, field}) {
+      for (auto c : part) {
+        result += to_environment_char(c);
+      }
+    }
+    return result;
+  }
+
+  // The value of the variable for a field, or std::nullopt if it is not set
+  std::optional<std::string_view> find(std::string_view scope,
+                                       std::string_view field) const {
+    const auto i = hash_table_probe(slots_, hash(scope, field), is_empty,
+                                    [this, scope, field](const slot &s) {
+                                      return is_name_equal(name(s), scope, field);
+                                    });
+    const auto &s = slots_[i];
+    if (is_empty(s)) {
+      return std::nullopt;
+    }
+    return std::string_view(text_).substr(s.offset + s.name_length, s.value_length);
+  }
+
+private:
+  std::string_view name(const slot &s) const {
+    return std::string_view(text_).substr(s.offset, s.name_length);
+  }
+};
+
+} // namespace details
+
+} // namespace structopt
@@ -1,28 +1,52 @@
-
 #pragma once
+#include <cstddef>
+#include <cstdint>
 #include <exception>
-#include <sstream>
+#include <limits>
 #include <string>
 #include <structopt/visitor.hpp>
 
+// app::parse reports errors with exceptions, and app::try_parse without
+// them; a program built without exceptions can still use try_parse
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS) || defined(_CPPUNWIND)
+#define STRUCTOPT_HAS_EXCEPTIONS
+#endif
+
 namespace structopt {
 
+// What went wrong, for callers that handle errors without parsing what()
+enum class error_code : std::uint8_t {
+  invalid_value,        // e.g., `abc` for an int, or an unknown enum value
+  missing_value,        // e.g., `--log-level` at the end of the arguments
+  out_of_range,         // e.g., `40000` for a std::int16_t
+  combined_flag_value,  // e.g., `-ab 5` where `-a` takes a value
+  duplicate_sub_command // a different sub-command was already invoked
+};
+
 class exception : public std::exception {
   std::string what_{""};
   std::string help_{""};
-  details::visitor visitor_;
+  error_code code_{error_code::invalid_value};
+  std::size_t index_{npos};
 
 public:
-  exception(const std::string &what, const details::visitor &visitor)
-      : what_(what), help_(""), visitor_(visitor) {
-    std::stringstream os;
-    visitor_.print_help(os);
-    help_ = os.str();
-  }
+  static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+  exception(const std::string &what, const details::visitor &visitor,
+            error_code code = error_code::invalid_value, std::size_t index = npos)
+      : what_(what), help_(visitor.help()), code_(code), index_(index) {}
 
   const char *what() const throw() { return what_.c_str(); }
 
+  // The help is rendered at compile time, so building it here only adds the
+  // name of the program to it
   const char *help() const throw() { return help_.c_str(); }
+
+  error_code code() const { return code_; }
+
+  // The position of the offending argument in argv, or npos if the
+  // arguments ended before a value was found
+  std::size_t index() const { return index_; }
 };
 
-} // namespace structopt
\ No newline at end of file
+} // namespace structopt
@@ -0,0 +1,59 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace structopt {
+
+namespace details {
+
+// FNV-1a, 64 bits wide on every platform, e.g., the same on Win32 as on x64
+class fnv1a {
+  std::uint64_t state_{14695981039346656037ull};
+
+public:
+  constexpr fnv1a &add(char c) {
+    state_ ^= static_cast<unsigned char>(c);
+    state_ *= 1099511628211ull;
+    return *this;
+  }
+
+  // Hashes `text` as `map` spells it, e.g., with `-` for `_`
+  template <typename Map> constexpr fnv1a &add(std::string_view text, Map map) {
+    for (auto c : text) {
+      add(map(c));
+    }
+    return *this;
+  }
+
+  constexpr std::size_t value() const { return static_cast<std::size_t>(state_); }
+};
+
+// The number of slots of an open addressing table for `count` keys: a power
+// of two, at least 8, and at least twice `count`, so the table is at most
+// half full
+constexpr std::size_t hash_table_capacity(std::size_t count) {
+  std::size_t result = 8;
+  while (result < count * 2) {
+    result *= 2;
+  }
+  return result;
+}
+
+// Walks the open addressing table `slots` from the slot of `hash`, and
+// returns the position of the first slot that is empty or that `matches`.
+// The table is never full, so the walk ends.
+template <typename Slots, typename IsEmpty, typename Matches>
+constexpr std::size_t hash_table_probe(const Slots &slots, std::size_t hash,
+                                       IsEmpty is_empty, Matches matches) {
+  const auto mask = slots.size() - 1;
+  auto i = hash & mask;
+  while (!is_empty(slots[i]) && !matches(slots[i])) {
+    i = (i + 1) & mask;
+  }
+  return i;
+}
+
+} // namespace details
+
+} // namespace structopt
@@ -1,106 +1,211 @@
-
 #pragma once
-#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
 
 namespace structopt {
 
 namespace details {
 
-static inline bool is_binary_notation(std::string const &input) {
-  return input.compare(0, 2, "0b") == 0 && input.size() > 2 &&
-         input.find_first_not_of("01", 2) == std::string::npos;
-}
-
-static inline bool is_hex_notation(std::string const &input) {
-  return input.compare(0, 2, "0x") == 0 && input.size() > 2 &&
-         input.find_first_not_of("0123456789abcdefABCDEF", 2) == std::string::npos;
-}
-
-static inline bool is_octal_notation(std::string const &input) {
-  return input.compare(0, 1, "0") == 0 && input.size() > 1 &&
-         input.find_first_not_of("01234567", 1) == std::string::npos;
-}
-
-static inline bool is_valid_number(const std::string &input) {
-  if (is_binary_notation(input) || is_hex_notation(input) || is_octal_notation(input)) {
-    return true;
-  }
-
-  if (input.empty()) {
-    return false;
-  }
-
-  std::size_t i = 0, j = input.length() - 1;
-
-  // Handling whitespaces
-  while (i < input.length() && input[i] == ' ')
-    i++;
-  while (input[j] == ' ')
-    j--;
-
-  if (i > j)
-    return false;
-
-  // if string is of length 1 and the only
-  // character is not a digit
-  if (i == j && !(input[i] >= '0' && input[i] <= '9'))
-    return false;
-
-  // If the 1st char is not '+', '-', '.' or digit
-  if (input[i] != '.' && input[i] != '+' && input[i] != '-' &&
-      !(input[i] >= '0' && input[i] <= '9'))
-    return false;
-
-  // To check if a '.' or 'e' is found in given
-  // string. We use this flag to make sure that
-  // either of them appear only once.
-  bool dot_or_exp = false;
-
-  for (; i <= j; i++) {
-    // If any of the char does not belong to
-    // {digit, +, -, ., e}
-    if (input[i] != 'e' && input[i] != '.' && input[i] != '+' && input[i] != '-' &&
-        !(input[i] >= '0' && input[i] <= '9'))
+enum class number_notation : std::uint8_t {
+  none,           // not a number, e.g., -v or foo.csv
+  decimal,        // e.g., 5, -10, +3
+  floating_point, // e.g., 3.14, -.5, 1e-3
+  hex,            // e.g., 0x5B, -0x5B
+  octal,          // e.g., 071
+  binary          // e.g., 0b0101
+};
+
+// The shape of a command-line argument, found in a single scan
+struct argument_shape {
+  static constexpr std::size_t npos = std::string_view::npos;
+
+  number_notation notation{number_notation::none};
+
+  // `hex`, `octal`, and `binary`: where the digits start, after the sign
+  // and the notation prefix, e.g., 3 for -0x5B
+  std::size_t digits{0};
+
+  bool negative{false}; // a number with a leading '-'
+
+  // position of the first '=' or ':', e.g., 3 for -o=main
+  std::size_t delimiter{npos};
+
+  // the part before the delimiter is a number, e.g., -5 in -5=x
+  bool key_is_number{false};
+};
+
+// Scan an argument once, character by character
+//
+// A number is an optional sign followed by
+// * 0x and hex digits, or 0b and binary digits
+// * 0 and octal digits
+// * decimal digits with an optional fraction and exponent, e.g., 1.5e-3
+constexpr argument_shape scan_argument(std::string_view input) {
+  enum class state : std::uint8_t {
+    start,
+    sign,            // after '+' or '-'
+    zero,            // a leading 0, e.g., 0 in 071 or 0x5B
+    prefix,          // after 0x or 0b, before the first digit
+    prefixed_digits, // hex or binary digits
+    integer,         // decimal digits
+    dot,             // '.' before the fraction digits
+    fraction,        // digits after '.'
+    exponent,        // after 'e' or 'E'
+    exponent_sign,   // after the sign of the exponent
+    exponent_digits,
+    invalid
+  };
+
+  argument_shape result;
+  auto s = state::start;
+  auto notation = number_notation::decimal;
+  bool is_octal = true; // every digit after the leading 0 is an octal digit
+
+  const auto is_number = [&]() {
+    switch (s) {
+    case state::zero:
+    case state::prefixed_digits:
+    case state::integer:
+    case state::fraction:
+    case state::exponent_digits:
+      return true;
+    default:
       return false;
-
-    if (input[i] == '.') {
-      // checks if the char 'e' has already
-      // occurred before '.' If yes, return false;.
-      if (dot_or_exp == true)
-        return false;
-
-      // If '.' is the last character.
-      if (i + 1 > input.length())
-        return false;
-
-      // if '.' is not followed by a digit.
-      if (!(input[i + 1] >= '0' && input[i + 1] <= '9'))
-        return false;
+    }
+  };
+
+  for (std::size_t i = 0; i < input.size(); i++) {
+    const char c = input[i];
+    if (c == '=' || c == ':') {
+      result.delimiter = i;
+      result.key_is_number = is_number();
+      return result;
     }
 
-    else if (input[i] == 'e') {
-      // set dot_or_exp = 1 when e is encountered.
-      dot_or_exp = true;
+    const bool is_digit = c >= '0' && c <= '9';
+    switch (s) {
+    case state::start:
+      if (c == '+' || c == '-') {
+        result.negative = c == '-';
+        s = state::sign;
+      } else if (c == '0') {
+        s = state::zero;
+      } else if (is_digit) {
+        s = state::integer;
+      } else if (c == '.') {
+        s = state::dot;
+      } else {
+        s = state::invalid;
+      }
+      break;
+    case state::sign:
+      if (c == '0') {
+        s = state::zero;
+      } else if (is_digit) {
+        s = state::integer;
+      } else if (c == '.') {
+        s = state::dot;
+      } else {
+        s = state::invalid;
+      }
+      break;
+    case state::zero:
+      if (c == 'x' || c == 'b') {
+        notation = c == 'x' ? number_notation::hex : number_notation::binary;
+        result.digits = i + 1;
+        s = state::prefix;
+      } else if (is_digit) {
+        is_octal = is_octal && c <= '7';
+        notation = number_notation::octal;
+        result.digits = i;
+        s = state::integer;
+      } else if (c == '.') {
+        s = state::dot;
+      } else if (c == 'e' || c == 'E') {
+        s = state::exponent;
+      } else {
+        s = state::invalid;
+      }
+      break;
+    case state::prefix:
+    case state::prefixed_digits:
+      if ((notation == number_notation::binary && (c == '0' || c == '1')) ||
+          (notation == number_notation::hex &&
+           (is_digit || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F')))) {
+        s = state::prefixed_digits;
+      } else {
+        s = state::invalid;
+      }
+      break;
+    case state::integer:
+      if (is_digit) {
+        is_octal = is_octal && c <= '7';
+      } else if (c == '.') {
+        s = state::dot;
+      } else if (c == 'e' || c == 'E') {
+        s = state::exponent;
+      } else {
+        s = state::invalid;
+      }
+      break;
+    case state::dot:
+      s = is_digit ? state::fraction : state::invalid;
+      break;
+    case state::fraction:
+      if (c == 'e' || c == 'E') {
+        s = state::exponent;
+      } else if (!is_digit) {
+        s = state::invalid;
+      }
+      break;
+    case state::exponent:
+      if (c == '+' || c == '-') {
+        s = state::exponent_sign;
+      } else {
+        s = is_digit ? state::exponent_digits : state::invalid;
+      }
+      break;
+    case state::exponent_sign:
+    case state::exponent_digits:
+      s = is_digit ? state::exponent_digits : state::invalid;
+      break;
+    case state::invalid:
+      break;
+    }
 
-      // if there is no digit before 'e'.
-      if (!(input[i - 1] >= '0' && input[i - 1] <= '9'))
-        return false;
+    if (s == state::invalid) {
+      // not a number; only the delimiter is left to find
+      const auto delimiter = input.find_first_of("=:", i + 1);
+      if (delimiter != std::string_view::npos) {
+        result.delimiter = delimiter;
+      }
+      result.negative = false;
+      return result;
+    }
+  }
 
-      // If 'e' is the last Character
-      if (i + 1 > input.length())
-        return false;
+  if (!is_number()) {
+    result.negative = false;
+    return result;
+  }
 
-      // if e is not followed either by
-      // '+', '-' or a digit
-      if (input[i + 1] != '+' && input[i + 1] != '-' &&
-          (input[i + 1] >= '0' && input[i] <= '9'))
-        return false;
-    }
+  if (s == state::fraction || s == state::exponent_digits) {
+    result.notation = number_notation::floating_point;
+  } else if (notation == number_notation::octal && !is_octal) {
+    // e.g., 089
+    result.notation = number_notation::decimal;
+  } else {
+    result.notation = notation;
   }
+  if (result.notation == number_notation::decimal) {
+    result.digits = 0;
+  }
+  return result;
+}
 
-  /* If the string skips all above cases, then
-  it is numeric*/
-  return true;
+constexpr bool is_valid_number(std::string_view input) {
+  return scan_argument(input).notation != number_notation::none;
 }
 
 } // namespace details
@@ -0,0 +1,129 @@
+#pragma once
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <new>
+#include <optional>
+#include <structopt/is_specialization.hpp>
+#include <structopt/third_party/visit_struct/visit_struct.hpp>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__has_include)
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#define STRUCTOPT_HAS_MEMORY_RESOURCE
+#endif
+#endif
+
+namespace structopt {
+
+namespace details {
+
+#ifdef STRUCTOPT_HAS_MEMORY_RESOURCE
+
+using memory_resource = std::pmr::memory_resource;
+
+// The lists a parse works with, e.g., the arguments and their tokens, take
+// their memory from the resource passed to app::memory_resource
+template <typename T> using scratch_vector = std::pmr::vector<T>;
+template <typename T> using scratch_deque = std::pmr::deque<T>;
+
+inline memory_resource *default_memory_resource() {
+  return std::pmr::get_default_resource();
+}
+
+// Types that take their memory from a memory resource, e.g.,
+// std::pmr::vector<int> or std::pmr::string, but not std::tuple, which only
+// passes an allocator on to its elements
+template <typename T>
+struct uses_memory_resource
+    : std::conjunction<
+          std::uses_allocator<T, std::pmr::polymorphic_allocator<std::byte>>,
+          std::is_constructible<T, std::pmr::polymorphic_allocator<std::byte>>> {};
+
+// An empty `T`, which takes its memory from `resource` if it can
+template <typename T> T make_value(memory_resource *resource) {
+  if constexpr (uses_memory_resource<T>::value) {
+    // converts to the allocator of any std::pmr container or adapter
+    return T(std::pmr::polymorphic_allocator<std::byte>(resource));
+  } else {
+    return T();
+  }
+}
+
+#else
+
+// <memory_resource> is missing, e.g., from older versions of libc++; every
+// parse then uses the global allocator
+struct memory_resource;
+
+template <typename T> using scratch_vector = std::vector<T>;
+template <typename T> using scratch_deque = std::deque<T>;
+
+inline memory_resource *default_memory_resource() { return nullptr; }
+
+template <typename T> struct uses_memory_resource : std::false_type {};
+
+template <typename T> T make_value(memory_resource *) { return T(); }
+
+#endif
+
+template <typename T> constexpr bool has_memory_resource();
+
+template <typename T, std::size_t... I>
+constexpr bool has_memory_resource_field(std::index_sequence<I...>) {
+  return (has_memory_resource<visit_struct::type_at<I, T>>() || ...);
+}
+
+// Whether `T` takes its memory from a memory resource, or holds something
+// that does, e.g., a nested struct with a std::pmr::vector field
+template <typename T> constexpr bool has_memory_resource() {
+  if constexpr (uses_memory_resource<T>::value) {
+    return true;
+  } else if constexpr (structopt::is_specialization<T, std::optional>::value) {
+    return has_memory_resource<typename T::value_type>();
+  } else if constexpr (visit_struct::traits::is_visitable<T>::value) {
+    return has_memory_resource_field<T>(
+        std::make_index_sequence<visit_struct::field_count<T>()>{});
+  } else {
+    return false;
+  }
+}
+
+// Destroys `field` and constructs it anew from `value`
+//
+// Unlike an assignment, this keeps the memory resource of `value`, e.g., of
+// a std::pmr::vector, or of the std::pmr containers of a nested struct.
+// The move constructor of `T` must not throw, or `field` would be left
+// destroyed.
+template <typename T> void replace_field(T &field, T &&value) {
+  static_assert(std::is_nothrow_move_constructible<T>::value);
+  field.~T();
+  ::new (static_cast<void *>(std::addressof(field))) T(std::move(value));
+}
+
+// Moves `value` into `field`, keeping the memory resource of `value`
+//
+// Types whose move constructor can throw, e.g., std::pmr::deque with
+// libstdc++, are assigned, and their values move into the memory of
+// `field`.
+template <typename T> void assign_field(T &field, T &&value) {
+  if constexpr (structopt::is_specialization<T, std::optional>::value) {
+    if constexpr (has_memory_resource<typename T::value_type>()) {
+      // an empty optional takes the value as it is
+      field.reset();
+    }
+    field = std::move(value);
+  } else if constexpr (has_memory_resource<T>() &&
+                       std::is_nothrow_move_constructible<T>::value) {
+    replace_field(field, std::move(value));
+  } else {
+    field = std::move(value);
+  }
+}
+
+} // namespace details
+
+} // namespace structopt
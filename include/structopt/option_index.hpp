@@ -0,0 +1,160 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <structopt/hash_table.hpp>
+#include <vector>
+
+namespace structopt {
+
+namespace details {
+
+// `-` and `_` are interchangeable in option names, e.g., `--bind-address`
+// and `--bind_address` both name the field `bind_address`
+static inline char normalize_option_char(char c) { return c == '-' ? '_' : c; }
+
+static inline bool is_kebab_case_equal(std::string_view lhs, std::string_view rhs) {
+  if (lhs.size() != rhs.size()) {
+    return false;
+  }
+  for (std::size_t i = 0; i < lhs.size(); i++) {
+    if (normalize_option_char(lhs[i]) != normalize_option_char(rhs[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Strip up to two leading dashes from an optional argument
+// e.g., --verbose => verbose
+// e.g., -log-level => log-level
+static inline std::string_view strip_option_dashes(std::string_view next) {
+  if (next.size() > 1 && next[0] == '-') {
+    next.remove_prefix(1);
+    if (next[0] == '-') {
+      next.remove_prefix(1);
+    }
+  }
+  return next;
+}
+
+// The short option for a letter, e.g., 'v' => -v
+// The views point into a static table, so no string is ever allocated
+static inline std::string_view short_option(char c) {
+  static const auto options = [] {
+    std::array<char, 512> result{};
+    for (std::size_t i = 0; i < 256; i++) {
+      result[2 * i] = '-';
+      result[2 * i + 1] = static_cast<char>(i);
+    }
+    return result;
+  }();
+  return {options.data() + 2 * static_cast<unsigned char>(c), 2};
+}
+
+// Maps every spelling of an option (long name, kebab-case alias and short
+// letter) to the position of the field in the list it was built from.
+//
+// The index is built once per parser. Lookups never allocate: names are
+// stored back to back in a single buffer and probed with an open addressing
+// table that treats `-` and `_` as the same character.
+class option_index {
+  struct slot {
+    std::uint32_t offset{0};
+    std::uint32_t length{0};
+    std::size_t field{npos};
+  };
+
+  std::string names_;
+  std::vector<slot> slots_;
+  std::array<std::size_t, 256> short_names_;
+
+  static std::size_t hash(std::string_view name) {
+    return fnv1a().add(name, normalize_option_char).value();
+  }
+
+  static bool is_empty(const slot &s) { return s.field == npos; }
+
+public:
+  static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+  option_index() { short_names_.fill(npos); }
+
+  template <typename Container> explicit option_index(const Container &field_names) {
+    short_names_.fill(npos);
+
+    slots_.resize(hash_table_capacity(field_names.size()));
+
+    std::size_t field = 0;
+    for (auto &field_name : field_names) {
+      if (field_name.empty()) {
+        // placeholder, e.g., for a field that cannot be named on the command line
+        field += 1;
+        continue;
+      }
+
+      const auto offset = names_.size();
+      names_ += field_name;
+
+      // the first field with a given initial owns the short form
+      auto &short_name = short_names_[static_cast<unsigned char>(field_name[0])];
+      if (short_name == npos) {
+        short_name = field;
+      }
+
+      // a duplicate name keeps the first field
+      const auto i = hash_table_probe(slots_, hash(field_name), is_empty,
+                                      [this, &field_name](const slot &s) {
+                                        return name_of(s) == field_name;
+                                      });
+      if (is_empty(slots_[i])) {
+        slots_[i] = {static_cast<std::uint32_t>(offset),
+                     static_cast<std::uint32_t>(field_name.size()), field};
+      }
+      field += 1;
+    }
+  }
+
+  // Look up a name without leading dashes, e.g., `bind-address`
+  std::size_t find_long(std::string_view name) const {
+    if (slots_.empty()) {
+      return npos;
+    }
+    const auto i = hash_table_probe(slots_, hash(name), is_empty,
+                                    [this, name](const slot &other) {
+                                      return is_kebab_case_equal(name_of(other), name);
+                                    });
+    return slots_[i].field;
+  }
+
+  // Look up the short form of an option, e.g., `v` for `-v`
+  std::size_t find_short(char c) const {
+    return short_names_[static_cast<unsigned char>(c)];
+  }
+
+  // Look up a command-line token that looks like an option
+  // e.g., `-v`, `--verbose`, `-log-level`
+  std::size_t find(std::string_view next) const {
+    if (next.size() < 2 || next[0] != '-') {
+      return npos;
+    }
+    if (next.size() == 2) {
+      const auto result = find_short(next[1]);
+      if (result != npos) {
+        return result;
+      }
+    }
+    return find_long(strip_option_dashes(next));
+  }
+
+private:
+  std::string_view name_of(const slot &s) const {
+    return std::string_view(names_).substr(s.offset, s.length);
+  }
+};
+
+} // namespace details
+
+} // namespace structopt
@@ -0,0 +1,158 @@
+#pragma once
+#include <charconv>
+#include <cmath>
+#include <limits>
+#include <string_view>
+#include <structopt/is_number.hpp>
+#include <system_error>
+#include <type_traits>
+
+namespace structopt {
+
+namespace details {
+
+// Integral and floating point types are converted with std::from_chars
+// Character types are read as characters, e.g., `std::optional<char> c`
+template <typename T>
+struct is_from_chars_number
+    : std::integral_constant<bool, (std::is_integral<T>::value &&
+                                    !std::is_same<T, bool>::value &&
+                                    !std::is_same<T, char>::value &&
+                                    !std::is_same<T, signed char>::value &&
+                                    !std::is_same<T, unsigned char>::value &&
+                                    !std::is_same<T, wchar_t>::value &&
+                                    !std::is_same<T, char16_t>::value &&
+                                    !std::is_same<T, char32_t>::value) ||
+                                       std::is_floating_point<T>::value> {};
+
+// Convert a decimal number with a fraction or an exponent to an integer,
+// truncated toward zero, e.g., -1.9 => -1 and 1.5e1 => 15
+template <typename T> std::errc parse_integral_part(std::string_view input, T &result) {
+  if (input.find_first_of("eE") == std::string_view::npos) {
+    // e.g., -1.1: the digits before the point are converted exactly, and
+    // the ones after it have to be digits
+    const auto point = input.find('.');
+    for (auto c : input.substr(point + 1)) {
+      if (c < '0' || c > '9') {
+        return std::errc::invalid_argument;
+      }
+    }
+    const auto integral = input.substr(0, point);
+    if (integral.empty() || integral == "-") {
+      result = 0; // e.g., .5 or -.5
+      return std::errc{};
+    }
+    T value{};
+    const auto [end, error] =
+        std::from_chars(integral.data(), integral.data() + integral.size(), value);
+    if (error != std::errc{}) {
+      return error;
+    } else if (end != integral.data() + integral.size()) {
+      return std::errc::invalid_argument;
+    }
+    result = value;
+    return std::errc{};
+  }
+
+  // e.g., -1e3 or 1.5e1: the value is computed as a double, which has to be
+  // in the range of `T` once truncated
+  const auto last = input.data() + input.size();
+  double value{};
+  const auto [end, error] = std::from_chars(input.data(), last, value);
+  if (error != std::errc{}) {
+    return error;
+  } else if (end != last) {
+    return std::errc::invalid_argument;
+  }
+  const auto integral = std::trunc(value);
+  const auto bound = std::ldexp(1.0, std::numeric_limits<T>::digits); // max() + 1
+  const auto lowest = std::is_signed<T>::value ? -bound : 0.0;
+  if (integral < lowest || integral >= bound) {
+    return std::errc::result_out_of_range;
+  }
+  result = static_cast<T>(integral);
+  return std::errc{};
+}
+
+// Convert a numeric argument without locales or allocations
+//
+// Integers can be written in binary, hex, or octal notation, e.g., 0b0101,
+// -0x5B, or 071. The whole argument has to be a number: trailing characters
+// are reported as std::errc::invalid_argument and values that do not fit
+// into `T` as std::errc::result_out_of_range. Decimal fractions are
+// truncated when converted to an integer, e.g., -1.1 => -1, and exponents
+// are applied, e.g., -1e3 => -1000.
+template <typename T> std::errc parse_number(std::string_view input, T &result) {
+  const auto shape = scan_argument(input);
+  const auto last = input.data() + input.size();
+
+  // std::from_chars accepts a leading '-' but not a leading '+'
+  const auto first =
+      input.data() + (shape.notation != number_notation::none && input[0] == '+' ? 1 : 0);
+
+  if constexpr (std::is_integral<T>::value) {
+    int base = 10;
+    switch (shape.notation) {
+    case number_notation::none:
+      return std::errc::invalid_argument;
+    case number_notation::decimal:
+      break;
+    case number_notation::floating_point:
+      return parse_integral_part(std::string_view(first, last - first), result);
+    case number_notation::hex:
+      base = 16;
+      break;
+    case number_notation::octal:
+      base = 8;
+      break;
+    case number_notation::binary:
+      base = 2;
+      break;
+    }
+
+    if (base == 10 || !shape.negative) {
+      // the digits follow the sign and the notation prefix, e.g., +0x
+      const auto digits = base == 10 ? first : input.data() + shape.digits;
+      const auto [end, error] = std::from_chars(digits, last, result, base);
+      if (error == std::errc{} && end != last) {
+        return std::errc::invalid_argument;
+      }
+      return error;
+    }
+
+    // e.g., -0x5B; the sign comes before the notation prefix, where
+    // std::from_chars does not expect it
+    if constexpr (std::is_signed<T>::value) {
+      using magnitude_type = typename std::make_unsigned<T>::type;
+      magnitude_type magnitude{};
+      const auto digits = input.data() + shape.digits;
+      const auto [end, error] = std::from_chars(digits, last, magnitude, base);
+      if (error != std::errc{}) {
+        return error;
+      } else if (end != last) {
+        return std::errc::invalid_argument;
+      }
+
+      const auto limit = static_cast<magnitude_type>(
+          static_cast<magnitude_type>(std::numeric_limits<T>::max()) + 1);
+      if (magnitude > limit) {
+        return std::errc::result_out_of_range;
+      }
+      result = magnitude == limit ? std::numeric_limits<T>::min()
+                                  : static_cast<T>(-static_cast<T>(magnitude));
+      return std::errc{};
+    } else {
+      return std::errc::invalid_argument;
+    }
+  } else {
+    const auto [end, error] = std::from_chars(first, last, result);
+    if (error == std::errc{} && end != last) {
+      return std::errc::invalid_argument;
+    }
+    return error;
+  }
+}
+
+} // namespace details
+
+} // namespace structopt
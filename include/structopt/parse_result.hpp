@@ -0,0 +1,73 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <structopt/exception.hpp>
+#include <utility>
+
+namespace structopt {
+
+enum class parse_status : std::uint8_t {
+  success,
+  error,                // see code(), index(), and message()
+  help_requested,       // -h or --help; message() is the help
+  version_requested,    // -v or --version; message() is the version
+  completion_requested  // __complete or --structopt-completion in argv;
+                        // message() is the output, to be printed as it is
+};
+
+namespace details {
+
+// Why app::try_parse stopped before the end of the arguments
+struct parse_stop {
+  parse_status status{parse_status::error};
+  error_code code{error_code::invalid_value};
+  std::size_t index{exception::npos};
+  std::string message;
+};
+
+} // namespace details
+
+// The outcome of app::try_parse: the parsed struct, an error, or a request
+// for the help, the version or a completion
+template <typename T> class parse_result {
+  T value_{};
+  details::parse_stop stop_{parse_status::success, error_code::invalid_value,
+                            exception::npos, {}};
+
+public:
+  explicit parse_result(T value) : value_(std::move(value)) {}
+
+  explicit parse_result(details::parse_stop stop) : stop_(std::move(stop)) {}
+
+  parse_status status() const { return stop_.status; }
+
+  bool has_value() const { return stop_.status == parse_status::success; }
+
+  explicit operator bool() const { return has_value(); }
+
+  // The parsed struct, or a default-constructed one if there is no value
+  T &value() & { return value_; }
+  const T &value() const & { return value_; }
+  T &&value() && { return std::move(value_); }
+
+  T &operator*() & { return value_; }
+  const T &operator*() const & { return value_; }
+
+  T *operator->() { return &value_; }
+  const T *operator->() const { return &value_; }
+
+  // `error`: what went wrong, see structopt::exception
+  error_code code() const { return stop_.code; }
+
+  // `error`: the position of the offending argument in argv, or
+  // exception::npos if the arguments ended before a value was found
+  std::size_t index() const { return stop_.index; }
+
+  // `error`: the error message, `help_requested`: the help,
+  // `version_requested`: the version, and `completion_requested`: the
+  // completion script or candidates
+  const std::string &message() const { return stop_.message; }
+};
+
+} // namespace structopt
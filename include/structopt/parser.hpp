@@ -3,18 +3,34 @@
 #include <algorithm>
 #include <array>
 #include <cctype>
+#include <cstdlib>
 #include <iostream>
 #include <iterator>
+#include <memory>
 #include <set>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <structopt/array_size.hpp>
+#include <structopt/bool_literals.hpp>
+#include <structopt/config_file.hpp>
+#include <structopt/enum_index.hpp>
+#include <structopt/environment.hpp>
 #include <structopt/exception.hpp>
 #include <structopt/is_number.hpp>
 #include <structopt/is_specialization.hpp>
+#include <structopt/memory_resource.hpp>
+#include <structopt/option_index.hpp>
+#include <structopt/parse_number.hpp>
+#include <structopt/parse_result.hpp>
+#include <structopt/schema.hpp>
 #include <structopt/sub_command.hpp>
+#include <structopt/token.hpp>
+#include <structopt/visit_field.hpp>
 #include <structopt/third_party/magic_enum/magic_enum.hpp>
 #include <structopt/third_party/visit_struct/visit_struct.hpp>
+#include <system_error>
+#include <thread>
 #include <tuple>
 #include <type_traits>
 #include <utility>
@@ -26,205 +42,412 @@ namespace details {
 
 struct parser {
   structopt::details::visitor visitor;
-  std::vector<std::string> arguments;
+  const details::schema *schema{nullptr}; // visitor.schema
+  argument_list *arguments{nullptr};      // shared with the parsers of sub-commands
   std::size_t current_index{1};
   std::size_t next_index{1};
+  std::size_t positional_index{0}; // the next positional field to take a value
   bool double_dash_encountered{false}; // "--" option-argument delimiter
   bool sub_command_invoked{false};
   std::string already_invoked_subcommand_name{""};
-
-  bool is_optional(const std::string &name) {
-    if (double_dash_encountered) {
-      return false;
-    } else if (name == "--") {
-      double_dash_encountered = true;
-      return false;
-    } else if (is_valid_number(name)) {
-      return false;
+  bool help_requested{false};
+  bool version_requested{false};
+
+  // numeric std::vector and std::deque fields with at least this many values
+  // are converted on several threads; 0 converts every field on this thread
+  std::size_t parallel_threshold{0};
+  std::size_t parallel_threads{0}; // at most; 0 is one per core
+
+  // std::pmr containers and strings in the parsed struct take their memory
+  // from here, see app::memory_resource
+  memory_resource *resource{default_memory_resource()};
+
+  // optional and flag fields that are not named on the command line fall
+  // back to the environment, see app::environment, and then to the
+  // configuration files, the last one first, see app::config_file
+  const environment_index *environment{nullptr};
+  const std::vector<std::shared_ptr<const config_file>> *config_files{nullptr};
+  std::vector<bool> given_fields; // named on the command line
+
+  // the sub-commands that lead to this parser, e.g., `build.` for the
+  // fallbacks APP_BUILD_TARGET and [build] target
+  std::string fallback_scope;
+
+  // app::try_parse: errors, and requests for the help or the version, are
+  // kept in `stop` instead of being thrown or handled here. The first one
+  // stops the parse; the parser then acts as if the arguments had ended.
+  bool throws{true};
+  std::optional<parse_stop> stop;
+
+  parser() = default;
+
+  parser(const structopt::details::visitor &visitor, argument_list &arguments)
+      : visitor(visitor), schema(visitor.schema), arguments(&arguments) {}
+
+  std::string_view argument(std::size_t index) const { return (*arguments)[index]; }
+
+  // checks if there is an argument at `index`
+  // Arguments read from a stream are read up to `index`, not further.
+  bool has_argument(std::size_t index) { return !stop && arguments->has(index); }
+
+  // Report an error: throw it, or keep it if it is the first one, see `stop`
+  // `visitor` is only used for the exception, so it is unused without them
+  void fail(const std::string &what, [[maybe_unused]] const details::visitor &visitor,
+            error_code code = error_code::invalid_value,
+            std::size_t index = exception::npos) {
+    if (throws) {
+#ifdef STRUCTOPT_HAS_EXCEPTIONS
+      throw structopt::exception(what, visitor, code, index);
+#else
+      // app::parse needs exceptions; see app::try_parse
+      std::cerr << what << "\n";
+      std::abort();
+#endif
+    } else if (!stop) {
+      stop = parse_stop{parse_status::error, code, index, what};
     }
+  }
 
-    bool result = false;
-    if (name.size() >= 2) {
-      // e.g., -b, -v
-      if (name[0] == '-') {
-        result = true;
-        // e.g., --verbose
-        if (name[1] == '-') {
-          result = true;
-        }
-      }
+  std::size_t help_field() const { return schema->help_field(); }
+
+  std::size_t version_field() const { return schema->version_field(); }
+
+  bool is_option_field(std::size_t field) const { return schema->is_option_field(field); }
+
+  // Find the field named by an optional argument, e.g., -v, --verbose
+  // Optional and flag fields take precedence over other fields with the same initial
+  std::size_t find_field(std::string_view next) const {
+    auto result = schema->option_field_index.find(next);
+    if (result == option_index::npos) {
+      result = schema->field_index.find(next);
     }
     return result;
   }
 
-  bool is_kebab_case(const std::string &next, const std::string &field_name) {
-    bool result = false;
-    auto maybe_kebab_case = next;
-    if (maybe_kebab_case.size() > 1 && maybe_kebab_case[0] == '-') {
-      // remove first dash
-      maybe_kebab_case.erase(0, 1);
-      if (maybe_kebab_case[0] == '-') {
-        // there is a second leading dash
-        // remove it
-        maybe_kebab_case.erase(0, 1);
+  // Classify a command-line argument
+  // This is done once per argument; all later checks look at the token
+  token classify(std::string_view next) {
+    token result;
+
+    if (double_dash_encountered) {
+      // everything after `--` is a value
+      return result;
+    } else if (next == "--") {
+      double_dash_encountered = true;
+      result.kind = token_kind::double_dash;
+      return result;
+    } else if (next.size() < 2 || next[0] != '-') {
+      // e.g., foo.csv, 0x5B
+      return result;
+    }
+
+    // a single scan tells numbers from options and finds the delimiter
+    const auto shape = scan_argument(next);
+    if (shape.notation != number_notation::none) {
+      // e.g., -5, -0x5B, -.5e3
+      return result;
+    }
+
+    // e.g., -v, --verbose, -log-level
+    result.field = find_field(next);
+    if (result.field != token::npos) {
+      result.kind = token_kind::option;
+      return result;
+    }
+
+    // maybe this is an optional argument that is delimited with '=' or ':'
+    // e.g., -std=c++17 or --output:main
+    const auto delimiter = shape.delimiter;
+    if (delimiter != argument_shape::npos) {
+      const auto key = next.substr(0, delimiter);
+      if (key.size() >= 2 && !shape.key_is_number) {
+        result.field = find_field(key);
+        if (result.field != token::npos) {
+          result.kind = token_kind::delimited_option;
+          result.delimiter = delimiter;
+          return result;
+        }
       }
-      std::replace(maybe_kebab_case.begin(), maybe_kebab_case.end(), '-', '_');
-      if (maybe_kebab_case == field_name) {
-        result = true;
+    }
+
+    // maybe this is a combined argument
+    // e.g., -abc => -a, -b, and -c where each letter is the short form of a field
+    result.kind = token_kind::combined_flags;
+    if (next[1] == '-') {
+      result.kind = token_kind::unknown_option;
+    }
+    for (std::size_t i = 1; i < next.size() && result.kind == token_kind::combined_flags;
+         i++) {
+      if (std::isdigit(static_cast<unsigned char>(next[i])) ||
+          schema->field_index.find_short(next[i]) == option_index::npos) {
+        result.kind = token_kind::unknown_option;
       }
     }
     return result;
   }
 
-  bool is_optional_field(const std::string &next, const std::string &field_name) {
-    bool result = false;
-    if (next == "-" + field_name || next == "--" + field_name ||
-        next == "-" + std::string(1, field_name[0]) || is_kebab_case(next, field_name)) {
-      // okay `next` matches _a_ field name (which is an optional field)
-      result = true;
+  // Arguments are classified lazily, in order, so that the parser of a
+  // sub-command classifies the arguments it consumes with its own fields.
+  // Arguments that were consumed as values, e.g., `bar` in `--foo bar`,
+  // are never classified.
+  const token &token_at(std::size_t index) {
+    auto &tokens = arguments->tokens;
+    const auto position = index - arguments->offset;
+    if (tokens.size() <= position) {
+      tokens.resize(position);
+      tokens.push_back(classify(argument(index)));
+    }
+    return tokens[position];
+  }
+
+  // checks if the argument at `index` marks the end of a container
+  // argument, i.e., it names a field, it is a delimited optional argument,
+  // or it is `--`
+  bool ends_container(std::size_t index) {
+    const auto next = argument(index);
+    if (next.size() < 2 || next[0] != '-') {
+      // e.g., foo.csv or 5; a value, whatever the fields
+      return false;
     }
-    return result;
+    const auto &token = token_at(index);
+    return token.kind == token_kind::double_dash ||
+           ((token.kind == token_kind::option ||
+             token.kind == token_kind::delimited_option) &&
+            token.field < schema->field_count);
   }
 
-  bool is_optional_field(const std::string &next) {
-    if (!is_optional(next)) {
+  // checks if the argument at `next_index` marks the end of a container
+  // argument, and gets past it if it is `--`
+  bool is_end_of_container() {
+    if (!ends_container(next_index)) {
       return false;
     }
+    if (token_at(next_index).kind == token_kind::double_dash) {
+      next_index += 1;
+    }
+    return true;
+  }
+
+  // The field that takes the value at `current_index`: the next positional
+  // field, or the sub-command with that name if it comes first in the struct
+  std::size_t value_field() {
+    std::size_t result = token::npos;
+    if (positional_index < schema->positional_count) {
+      result = schema->positional_fields[positional_index];
+    }
 
-    bool result = false;
-    for (auto &field_name : visitor.field_names) {
-      result = is_optional_field(next, field_name);
-      if (result) {
-        break;
-      }
+    const auto next = argument(current_index);
+    const auto sub_command = schema->field_index.find_long(next);
+    if (sub_command < result &&
+        schema->fields[sub_command].kind == field_kind::nested_struct &&
+        schema->fields[sub_command].name == next) {
+      result = sub_command;
     }
     return result;
   }
 
-  // checks if the next argument is a delimited optional field
-  // e.g., -std=c++17, where std matches a field name
-  // and it is delimited by one of the two allowed delimiters: `=` and `:`
+  // Parse a combined argument flag by flag, e.g., -abc => -a, -b, and -c
   //
-  // if true, the return value includes the delimiter that was used
-  std::pair<bool, char> is_delimited_optional_argument(const std::string &next) {
-    bool success = false;
-    char delimiter = '\0';
-
-    auto equal_pos = next.find('=');
-    auto colon_pos = next.find(':');
-
-    if (equal_pos == std::string::npos && colon_pos == std::string::npos) {
-      // not delimited
-      return {success, delimiter};
-    } else {
-      // assume `=` comes first
-      char c = '=';
-
-      if (colon_pos < equal_pos) {
-        // confirmed: `:` comes first
-        c = ':';
+  // Each flag in turn takes the place of the combined argument and is parsed
+  // like any other optional argument, so the argument list is never shifted.
+  // Only the last flag can take values, e.g., "./main -ac 3.14 2.718"
+  template <typename T> void parse_combined_flags(T &argument_struct) {
+    // a copy; the values of the last flag may release the argument
+    const std::string next{argument(current_index)};
+
+    bool names_option = false;
+    for (std::size_t i = 1; i < next.size(); i++) {
+      if (schema->option_field_index.find_short(next[i]) != option_index::npos) {
+        names_option = true;
+      }
+    }
+    if (!names_option) {
+      return;
+    }
+
+    for (std::size_t i = 1; i < next.size(); i++) {
+      arguments->replace(current_index, short_option(next[i]));
+      next_index = current_index;
+      parse_token(argument_struct);
+      if (i + 1 < next.size() && next_index > current_index + 1) {
+        fail("Error: failed to correctly parse combined argument `" + next +
+                 "`. Only its last flag `-" + std::string(1, next.back()) +
+                 "` can take a value.",
+             visitor, error_code::combined_flag_value, current_index);
+        return;
       }
+    }
 
-      // split `next` into key and value
-      // check if key is an optional field
-      std::string key;
-      bool delimiter_found = false;
-      for (size_t i = 0; i < next.size(); i++) {
-        if (next[i] == c && !delimiter_found) {
-          delimiter = c;
-          delimiter_found = true;
-        } else {
-          if (!delimiter_found) {
-            key += next[i];
-          }
-        }
-      }
+    // get past the combined argument, and any values of its last flag
+    next_index = std::max(next_index, current_index + 1);
+  }
 
-      // check if `key` is a valid optional field
-      if (delimiter_found && is_optional_field(key)) {
-        success = true;
+  // Parse the argument at `current_index` into whichever field it belongs to
+  template <typename T> void parse_token(T &argument_struct) {
+    const auto next = token_at(current_index);
+    switch (next.kind) {
+    case token_kind::double_dash:
+      next_index += 1;
+      break;
+    case token_kind::option:
+    case token_kind::delimited_option:
+      if (next.field == help_field()) {
+        help_requested = true;
+        next_index += 1;
+      } else if (next.field == version_field()) {
+        version_requested = true;
+        next_index += 1;
+      } else if (is_option_field(next.field)) {
+        if (has_fallbacks()) {
+          given_fields[next.field] = true;
+        }
+        visit_field(argument_struct, next.field, *this);
+      } else if (next.kind == token_kind::delimited_option) {
+        // e.g., --foo=bar where `foo` is not an optional field
+        next_index += 1;
       }
+      break;
+    case token_kind::combined_flags:
+      parse_combined_flags(argument_struct);
+      break;
+    case token_kind::unknown_option:
+      break;
+    case token_kind::value:
+      visit_field(argument_struct, value_field(), *this);
+      break;
     }
-    return {success, delimiter};
   }
 
-  std::pair<std::string, std::string> split_delimited_argument(char delimiter,
-                                                               const std::string &next) {
-    std::string key, value;
-    bool delimiter_found = false;
-    for (size_t i = 0; i < next.size(); i++) {
-      if (next[i] == delimiter && !delimiter_found) {
-        delimiter_found = true;
+  // Parse the arguments from `current_index` on into `argument_struct`
+  //
+  // Each argument is visited once and handed to the field it belongs to.
+  // Arguments that no field takes are skipped. Afterwards, `next_index`
+  // is the end of the last argument that was consumed.
+  template <typename T> void parse_fields(T &argument_struct) {
+    if (has_fallbacks()) {
+      given_fields.assign(schema->field_count, false);
+    }
+
+    while (has_argument(current_index)) {
+      const auto last_index = next_index;
+      next_index = current_index;
+      parse_token(argument_struct);
+      if (next_index > current_index) {
+        current_index = next_index;
       } else {
-        if (!delimiter_found) {
-          key += next[i];
-        } else {
-          value += next[i];
-        }
+        next_index = last_index;
+        current_index += 1;
+      }
+    }
+
+    if (stop) {
+      return;
+    } else if (!throws && (help_requested || version_requested)) {
+      // try_parse leaves printing the help or the version to its caller
+      stop = parse_stop{help_requested ? parse_status::help_requested
+                                       : parse_status::version_requested,
+                        error_code::invalid_value, exception::npos,
+                        help_requested ? visitor.help() : visitor.version};
+      return;
+    } else if (help_requested) {
+      // if help is requested, print help and exit
+      visitor.print_help(std::cout);
+      exit(EXIT_SUCCESS);
+    } else if (version_requested) {
+      // if version is requested, print version and exit
+      std::cout << visitor.version << "\n";
+      exit(EXIT_SUCCESS);
+    }
+
+    if (has_fallbacks()) {
+      parse_fallbacks(argument_struct);
+      if (stop) {
+        return;
       }
     }
-    return {key, value};
-  }
 
-  // Strip the initial dashes on the left of an optional argument
-  // e.g., --verbose => verbose
-  // e.g., -log-level => log-level
-  std::string lstrip_dashes(const std::string& next) {
-    std::string result;
-    bool prefix_dashes_ended = false;
-    for (auto& c : next) {
-      if (prefix_dashes_ended == false && c != '-') {
-        prefix_dashes_ended = true;
-      }
-      if (prefix_dashes_ended) {
-        result += c;
+    // if all positional arguments were provided
+    // there would be none left
+    for (auto i = positional_index; i < schema->positional_count; i++) {
+      const auto &field = schema->fields[schema->positional_fields[i]];
+      if (!field.is_container) {
+        // this positional argument is not a vector-like argument
+        // it expects value(s)
+        fail("Error: expected value for positional argument `" + std::string{field.name} +
+                 "`.",
+             visitor, error_code::missing_value);
+        return;
       }
     }
-    return result;
   }
 
-  // Get the optional field name if any from 
-  // e.g., `-v` => `verbose`
-  // e.g., `-log-level` => `log_level`
-  std::optional<std::string> get_full_optional_field_name(const std::string& next) {
-    std::optional<std::string> result;
-
-    if (next.size() == 2 && next[0] == '-') {
-      // short form of optional argument
-      for (auto& oarg : visitor.optional_field_names) {
-        if (oarg[0] == next[1]) {
-          // second character of next matches first character of some optional field_name
-          result = oarg;
-          break;
+  bool has_fallbacks() const {
+    return environment || (config_files && !config_files->empty());
+  }
+
+  // Parse the values of the optional and flag fields that were not named on
+  // the command line from their fallbacks, e.g., APP_LOG_LEVEL=debug as if
+  // `--log-level=debug` had been provided
+  template <typename T> void parse_fallbacks(T &argument_struct) {
+    // each value is the only argument of a parser of its own, which keeps
+    // its errors so that they can name the source instead of an index
+    argument_list list(resource);
+    parser value_parser(visitor, list);
+    value_parser.throws = false;
+    value_parser.resource = resource;
+
+    for (std::size_t field = 0; field < schema->field_count && !stop; field++) {
+      if (!is_option_field(field) || given_fields[field]) {
+        continue;
+      }
+      const auto field_name = schema->fields[field].name;
+      std::optional<std::string_view> value;
+      const config_file *file = nullptr;
+      const config_file::entry *entry = nullptr;
+      if (environment) {
+        value = environment->find(fallback_scope, field_name);
+      }
+      if (!value && config_files) {
+        for (auto i = config_files->size(); i > 0 && !entry; i--) {
+          file = (*config_files)[i - 1].get();
+          entry = file->find(fallback_scope, field_name);
+        }
+        if (entry) {
+          value = entry->value;
         }
       }
-    } else {
-      // long form of optional argument
-
-      // strip dashes on the left
-      std::string potential_field_name = lstrip_dashes(next);
-
-      // replace `-` in the middle with `_`
-      std::replace(potential_field_name.begin(), potential_field_name.end(), '-', '_');
+      if (!value) {
+        continue;
+      }
 
-      // check if `potential_field_name` is in the optional field names list
-      for (auto& oarg : visitor.optional_field_names) {
-        if (oarg == potential_field_name) {
-          result = oarg;
-          break;
+      list.assign(&*value, &*value + 1);
+      value_parser.next_index = 0;
+      auto parse_value = [&value_parser](const char *name, auto &result) {
+        using field_type = std::decay_t<decltype(result)>;
+        if constexpr (structopt::is_specialization<field_type, std::optional>::value) {
+          assign_field(result,
+                       value_parser.parse_optional_value<typename field_type::value_type>(
+                           name));
         }
-      }
+      };
+      visit_field(argument_struct, field, parse_value);
 
+      if (value_parser.stop) {
+        const auto source =
+            entry ? "`" + file->path() + "`, line " + std::to_string(entry->line)
+                  : "the environment variable `" +
+                        environment->name(fallback_scope, field_name) + "`";
+        fail(value_parser.stop->message + " The value is from " + source + ".", visitor,
+             value_parser.stop->code);
+      }
     }
-
-    return result;
   }
 
   template <typename T> std::pair<T, bool> parse_argument(const char *name) {
-    if (next_index >= arguments.size()) {
+    if (!has_argument(next_index)) {
       return {T(), false};
     }
-    T result;
+    T result = make_value<T>(resource);
     bool success = true;
     if constexpr (visit_struct::traits::is_visitable<T>::value) {
       result = parse_nested_struct<T>(name);
@@ -258,56 +481,79 @@ struct parser {
     } else {
       success = false;
     }
-    return {result, success};
+    return {std::move(result), success};
   }
 
+  // Parse the value(s) that follow an optional argument, e.g., `bar` in `--foo bar`
   template <typename T> std::optional<T> parse_optional_argument(const char *name) {
     next_index += 1;
+    return parse_optional_value<T>(name);
+  }
+
+  // Parse the value(s) of an optional argument, starting at `next_index`
+  template <typename T> std::optional<T> parse_optional_value(const char *name) {
     std::optional<T> result;
-    if (next_index < arguments.size()) {
+    if (has_argument(next_index)) {
       auto [value, success] = parse_argument<T>(name);
       if (success) {
-        result = value;
+        result = std::move(value);
       } else {
-        throw structopt::exception(
-            "Error: failed to correctly parse optional argument `" + std::string{name} +
-                "`.",
-            visitor);
+        fail("Error: failed to correctly parse optional argument `" + std::string{name} +
+                 "`.",
+             visitor, error_code::invalid_value, next_index);
       }
     } else {
-      throw structopt::exception("Error: expected value for optional argument `" +
-                                     std::string{name} + "`.",
-                                 visitor);
+      fail("Error: expected value for optional argument `" + std::string{name} + "`.",
+           visitor, error_code::missing_value);
     }
     return result;
   }
 
-  // Any field that can be constructed using std::stringstream
+  // Any field that can be converted with std::from_chars or constructed
+  // using std::stringstream
   // Not container type
   // Not a visitable type, i.e., a nested struct
   template <typename T>
   inline typename std::enable_if<!visit_struct::traits::is_visitable<T>::value, T>::type
-  parse_single_argument(const char *) {
-    std::string argument = arguments[next_index];
-    std::istringstream ss(argument);
-    T result;
-
-    if constexpr (std::is_integral<T>::value) {
-      if (is_hex_notation(argument)) {
-        ss >> std::hex >> result;
-      } else if (is_octal_notation(argument)) {
-        ss >> std::oct >> result;
-      } else if (is_binary_notation(argument)) {
-        argument.erase(0, 2); // remove "0b"
-        result = static_cast<T>(std::stoi(argument, nullptr, 2));
-      } else {
-        ss >> std::dec >> result;
-      }
+  parse_single_argument(const char *name) {
+    if constexpr (is_from_chars_number<T>::value) {
+      T result{};
+      const auto error = parse_number(argument(next_index), result);
+      if (error == std::errc::result_out_of_range) {
+        fail("Error: value `" + std::string{argument(next_index)} +
+                 "` is out of range for argument `" + std::string{name} + "`.",
+             visitor, error_code::out_of_range, next_index);
+      } else if (error != std::errc{}) {
+        fail("Error: failed to correctly parse argument `" + std::string{name} + "`. `" +
+                 std::string{argument(next_index)} + "` is not a number.",
+             visitor, error_code::invalid_value, next_index);
+      }
+      return result;
+    } else if constexpr (uses_memory_resource<T>::value &&
+                         structopt::is_specialization<T, std::basic_string>::value) {
+      // e.g., std::pmr::string
+      return T(argument(next_index), typename T::allocator_type(resource));
+    } else if constexpr (std::is_same<T, bool>::value) {
+      // yes, YES, on, 1, true, TRUE, etc. = true
+      // no, NO, off, 0, false, FALSE, etc. = false
+      // see structopt::bool_literals
+      if (!has_argument(next_index)) {
+        return false;
+      }
+      const auto result = parse_bool(argument(next_index));
+      if (!result.has_value()) {
+        fail("Error: failed to parse boolean argument `" + std::string{name} + "`." + " `" +
+                 std::string{argument(next_index)} + "`" + " is invalid.",
+             visitor, error_code::invalid_value, next_index);
+        return false;
+      }
+      return result.value();
     } else {
+      std::istringstream ss(std::string{argument(next_index)});
+      T result;
       ss >> result;
+      return result;
     }
-
-    return result;
   }
 
   // Nested visitable struct
@@ -317,82 +563,49 @@ struct parser {
 
     T argument_struct;
 
+    // sub-command name; not the program
+    structopt::details::visitor sub_command_visitor(name, visitor.version);
+    sub_command_visitor.schema = &schema_of<T>();
+
     if constexpr (std::is_base_of<structopt::sub_command, T>::value) {
       argument_struct.invoked_ = true;
     }
 
-    // Save struct field names
-    argument_struct.visitor_.name = name; // sub-command name; not the program
-    argument_struct.visitor_.version = visitor.version;
-    visit_struct::for_each(argument_struct, argument_struct.visitor_);
-
-    // add `help` and `version` optional arguments
-    argument_struct.visitor_.optional_field_names.push_back("help");
-    argument_struct.visitor_.optional_field_names.push_back("version");
-
     if (!sub_command_invoked) {
       sub_command_invoked = true;
       already_invoked_subcommand_name = name;
     } else {
       // a sub-command has already been invoked
-      throw structopt::exception(
-          "Error: failed to invoke sub-command `" + std::string{name} +
-              "` because a different sub-command, `" + already_invoked_subcommand_name +
-              "`, has already been invoked.",
-          argument_struct.visitor_);
+      fail("Error: failed to invoke sub-command `" + std::string{name} +
+               "` because a different sub-command, `" + already_invoked_subcommand_name +
+               "`, has already been invoked.",
+           sub_command_visitor, error_code::duplicate_sub_command, current_index);
+      return argument_struct;
     }
 
-    structopt::details::parser parser;
-    parser.next_index = 0;
-    parser.current_index = 0;
+    // the sub-command continues from here, in the same argument list
+    structopt::details::parser parser(sub_command_visitor, *arguments);
+    parser.next_index = next_index;
+    parser.current_index = next_index;
     parser.double_dash_encountered = double_dash_encountered;
-    parser.visitor = argument_struct.visitor_;
-
-    std::copy(arguments.begin() + next_index, arguments.end(),
-              std::back_inserter(parser.arguments));
-
-    for (std::size_t i = 0; i < parser.arguments.size(); i++) {
-      parser.current_index = i;
-      visit_struct::for_each(argument_struct, parser);
-    }
-
-    // directly call the parser to check for `help` and `version` flags
-    std::optional<bool> help = false, version = false;
-    for (std::size_t i = 0; i < parser.arguments.size(); i++) {
-      parser.operator()("help", help);
-      parser.operator()("version", version);
-
-      if (help == true) {
-        // if help is requested, print help and exit
-        argument_struct.visitor_.print_help(std::cout);
-        exit(EXIT_SUCCESS);
-      } else if (version == true) {
-        // if version is requested, print version and exit
-        std::cout << argument_struct.visitor_.version << "\n";
-        exit(EXIT_SUCCESS);
-      }
+    parser.parallel_threshold = parallel_threshold;
+    parser.parallel_threads = parallel_threads;
+    parser.throws = throws;
+    parser.resource = resource;
+    if (has_fallbacks()) {
+      parser.environment = environment;
+      parser.config_files = config_files;
+      parser.fallback_scope = fallback_scope + name + ".";
     }
 
-    // if all positional arguments were provided
-    // this list would be empty
-    if (!parser.visitor.positional_field_names.empty()) {
-      for (auto &field_name : parser.visitor.positional_field_names) {
-        if (std::find(parser.visitor.vector_like_positional_field_names.begin(),
-                      parser.visitor.vector_like_positional_field_names.end(),
-                      field_name) ==
-            parser.visitor.vector_like_positional_field_names.end()) {
-          // this positional argument is not a vector-like argument
-          // it expects value(s)
-          throw structopt::exception("Error: expected value for positional argument `" +
-                                         field_name + "`.",
-                                     argument_struct.visitor_);
-        }
-      }
-    }
+    parser.parse_fields(argument_struct);
+    stop = std::move(parser.stop);
 
-    // update current and next
-    current_index += parser.next_index;
-    next_index += parser.next_index;
+    // continue after the last argument consumed by the sub-command
+    // arguments after that are classified again, with the fields of this struct
+    next_index = parser.next_index;
+    double_dash_encountered = parser.double_dash_encountered;
+    arguments->reclassify(next_index);
 
     return argument_struct;
   }
@@ -405,20 +618,19 @@ struct parser {
       // Pair first
       auto [value, success] = parse_argument<T1>(name);
       if (success) {
-        result.first = value;
+        assign_field(result.first, std::move(value));
       } else {
-        if (next_index == arguments.size()) {
+        if (!has_argument(next_index)) {
           // end of arguments list
           // first argument not provided
-          throw structopt::exception("Error: failed to correctly parse the pair `" +
-                                         std::string{name} +
-                                         "`. Expected 2 arguments, 0 provided.",
-                                     visitor);
+          fail("Error: failed to correctly parse the pair `" + std::string{name} +
+                   "`. Expected 2 arguments, 0 provided.",
+               visitor, error_code::missing_value);
         } else {
-          throw structopt::exception(
+          fail(
               "Error: failed to correctly parse first element of pair `" +
                   std::string{name} + "`",
-              visitor);
+              visitor, error_code::invalid_value, next_index);
         }
       }
     }
@@ -426,20 +638,19 @@ struct parser {
       // Pair second
       auto [value, success] = parse_argument<T2>(name);
       if (success) {
-        result.second = value;
+        assign_field(result.second, std::move(value));
       } else {
-        if (next_index == arguments.size()) {
+        if (!has_argument(next_index)) {
           // end of arguments list
           // second argument not provided
-          throw structopt::exception("Error: failed to correctly parse the pair `" +
-                                         std::string{name} +
-                                         "`. Expected 2 arguments, only 1 provided.",
-                                     visitor);
+          fail("Error: failed to correctly parse the pair `" + std::string{name} +
+                   "`. Expected 2 arguments, only 1 provided.",
+               visitor, error_code::missing_value);
         } else {
-          throw structopt::exception(
+          fail(
               "Error: failed to correctly parse second element of pair `" +
                   std::string{name} + "`",
-              visitor);
+              visitor, error_code::invalid_value, next_index);
         }
       }
     }
@@ -451,19 +662,21 @@ struct parser {
   std::array<T, N> parse_array_argument(const char *name) {
     std::array<T, N> result{};
 
-    const auto arguments_left = arguments.size() - next_index;
+    std::size_t arguments_left = 0;
+    while (arguments_left < N && has_argument(next_index + arguments_left)) {
+      arguments_left += 1;
+    }
     if (arguments_left == 0 || arguments_left < N) {
-      throw structopt::exception("Error: expected " + std::to_string(N) +
-                                     " values for std::array argument `" + name +
-                                     "` - instead got only " +
-                                     std::to_string(arguments_left) + " arguments.",
-                                 visitor);
+      fail("Error: expected " + std::to_string(N) + " values for std::array argument `" +
+               name + "` - instead got only " + std::to_string(arguments_left) +
+               " arguments.",
+           visitor, error_code::missing_value);
     }
 
     for (std::size_t i = 0; i < N; i++) {
       auto [value, success] = parse_argument<T>(name);
       if (success) {
-        result[i] = value;
+        assign_field(result[i], std::move(value));
       }
     }
     return result;
@@ -488,22 +701,20 @@ struct parser {
                            T &&result) {
     auto [value, success] = parse_argument<typename std::remove_reference<T>::type>(name);
     if (success) {
-      result = value;
+      assign_field(result, std::move(value));
     } else {
-      if (next_index == arguments.size()) {
+      if (!has_argument(next_index)) {
         // end of arguments list
         // failed to parse tuple <>. expected `size` arguments, `index` provided
-        throw structopt::exception("Error: failed to correctly parse tuple `" +
-                                       std::string{name} + "`. Expected " +
-                                       std::to_string(size) + " arguments, " +
-                                       std::to_string(index) + " provided.",
-                                   visitor);
+        fail("Error: failed to correctly parse tuple `" + std::string{name} +
+                 "`. Expected " + std::to_string(size) + " arguments, " +
+                 std::to_string(index) + " provided.",
+             visitor, error_code::missing_value);
       } else {
-        throw structopt::exception("Error: failed to correctly parse tuple `" +
-                                       std::string{name} +
-                                       "` {size = " + std::to_string(size) +
-                                       "} at index " + std::to_string(index) + ".",
-                                   visitor);
+        fail("Error: failed to correctly parse tuple `" + std::string{name} +
+                 "` {size = " + std::to_string(size) + "} at index " +
+                 std::to_string(index) + ".",
+             visitor, error_code::invalid_value, next_index);
       }
     }
   }
@@ -522,357 +733,223 @@ struct parser {
 
   // Vector, deque, list
   template <typename T> T parse_vector_like_argument(const char *name) {
-    T result;
+    auto result = make_value<T>(resource);
+
+    if constexpr (is_from_chars_number<typename T::value_type>::value) {
+      if (!arguments->is_streamed()) {
+        // Numbers: find the end of the values first, then convert them
+        // without classifying each one
+        auto end = next_index;
+        while (has_argument(end) && !ends_container(end)) {
+          end += 1;
+        }
+        if constexpr (structopt::is_specialization<T, std::vector>::value ||
+                      structopt::is_specialization<T, std::deque>::value) {
+          if (parallel_threshold > 0 && end - next_index >= parallel_threshold) {
+            // leaves nothing for the loop below
+            convert_numbers_in_parallel(result, end, name);
+          }
+        }
+        if constexpr (structopt::is_specialization<T, std::vector>::value) {
+          result.reserve(end - next_index);
+        }
+        for (; next_index < end && !stop; next_index++) {
+          result.push_back(parse_single_argument<typename T::value_type>(name));
+        }
+        if (has_argument(next_index)) {
+          // get past `--`, if that is what ends the values
+          is_end_of_container();
+        }
+        return result;
+      }
+    }
 
     // Parse from current till end
-    while (next_index < arguments.size()) {
-      const auto next = arguments[next_index];
-      if (is_optional_field(next) || std::string{next} == "--" ||
-          is_delimited_optional_argument(next).first) {
-        if (std::string{next} == "--") {
-          double_dash_encountered = true;
-          next_index += 1;
-        }
+    // Values read from a stream are parsed as they are read
+    while (has_argument(next_index)) {
+      if (is_end_of_container()) {
         // this marks the end of the container (break here)
         break;
       }
       auto [value, success] = parse_argument<typename T::value_type>(name);
       if (success) {
-        result.push_back(value);
+        result.push_back(std::move(value));
       }
+      arguments->release(next_index);
     }
     return result;
   }
 
+  // Convert the numbers from `next_index` up to `last` into `result`, one
+  // slice of the values per thread
+  //
+  // Every value is written to its own position, so the result does not
+  // depend on the number of threads. If some values do not convert, the
+  // first of them is converted again on this thread, which reports the
+  // same error as a conversion on a single thread would.
+  template <typename T>
+  void convert_numbers_in_parallel(T &result, std::size_t last, const char *name) {
+    constexpr std::size_t minimum_slice = 4096; // values per thread
+    const auto first = next_index;
+    const auto count = last - first;
+    const std::size_t available_threads =
+        parallel_threads > 0 ? parallel_threads : std::thread::hardware_concurrency();
+    const auto thread_count =
+        std::max<std::size_t>(1, std::min(available_threads, count / minimum_slice));
+
+    result.resize(count);
+    std::vector<std::size_t> failed(thread_count, last); // first failure per slice
+    const auto convert = [&](std::size_t slice) {
+      const auto begin = first + count * slice / thread_count;
+      const auto end = first + count * (slice + 1) / thread_count;
+      for (auto i = begin; i < end; i++) {
+        if (parse_number(argument(i), result[i - first]) != std::errc{}) {
+          failed[slice] = i;
+          return;
+        }
+      }
+    };
+
+    std::vector<std::thread> threads;
+    for (std::size_t slice = 1; slice < thread_count; slice++) {
+#ifdef STRUCTOPT_HAS_EXCEPTIONS
+      try {
+        threads.emplace_back(convert, slice);
+      } catch (const std::system_error &) {
+        // no thread to spare
+        convert(slice);
+      }
+#else
+      threads.emplace_back(convert, slice);
+#endif
+    }
+    convert(0);
+    for (auto &thread : threads) {
+      thread.join();
+    }
+
+    next_index = *std::min_element(failed.begin(), failed.end());
+    if (next_index < last) {
+      parse_single_argument<typename T::value_type>(name); // fails
+      next_index = last;
+    }
+  }
+
   // stack, queue, priority_queue
   template <typename T> T parse_container_adapter_argument(const char *name) {
-    T result;
+    auto result = make_value<T>(resource);
     // Parse from current till end
-    while (next_index < arguments.size()) {
-      const auto next = arguments[next_index];
-      if (is_optional_field(next) || std::string{next} == "--" ||
-          is_delimited_optional_argument(next).first) {
-        if (std::string{next} == "--") {
-          double_dash_encountered = true;
-          next_index += 1;
-        }
+    while (has_argument(next_index)) {
+      if (is_end_of_container()) {
         // this marks the end of the container (break here)
         break;
       }
       auto [value, success] = parse_argument<typename T::value_type>(name);
       if (success) {
-        result.push(value);
+        result.push(std::move(value));
       }
+      arguments->release(next_index);
     }
     return result;
   }
 
   // Set, multiset, unordered_set, unordered_multiset
   template <typename T> T parse_set_argument(const char *name) {
-    T result;
+    auto result = make_value<T>(resource);
     // Parse from current till end
-    while (next_index < arguments.size()) {
-      const auto next = arguments[next_index];
-      if (is_optional_field(next) || std::string{next} == "--" ||
-          is_delimited_optional_argument(next).first) {
-        if (std::string{next} == "--") {
-          double_dash_encountered = true;
-          next_index += 1;
-        }
+    while (has_argument(next_index)) {
+      if (is_end_of_container()) {
         // this marks the end of the container (break here)
         break;
       }
       auto [value, success] = parse_argument<typename T::value_type>(name);
       if (success) {
-        result.insert(value);
+        result.insert(std::move(value));
       }
+      arguments->release(next_index);
     }
     return result;
   }
 
   // Enum class
   template <typename T> T parse_enum_argument(const char *name) {
-    T result;
-    auto maybe_enum_value = magic_enum::enum_cast<T>(arguments[next_index]);
-    if (maybe_enum_value.has_value()) {
-      result = maybe_enum_value.value();
-    } else {
-      constexpr auto allowed_names = magic_enum::enum_names<T>();
-
-      std::string allowed_names_string = "";
-      if (allowed_names.size()) {
-        for (size_t i = 0; i < allowed_names.size() - 1; i++) {
-          allowed_names_string += std::string{allowed_names[i]} + ", ";
-        }
-        allowed_names_string += allowed_names[allowed_names.size() - 1];
-      }
-
-      throw structopt::exception(
-          "Error: unexpected input `" + std::string{arguments[next_index]} +
-              "` provided for enum argument `" + std::string{name} +
-              "`. Allowed values are {" + allowed_names_string + "}",
-          visitor);
-      // TODO: Throw error invalid enum option
-    }
-    return result;
+    const auto maybe_enum_value = enum_index<T>::find(argument(next_index));
+    if (!maybe_enum_value.has_value()) {
+      fail("Error: unexpected input `" + std::string{argument(next_index)} +
+               "` provided for enum argument `" + std::string{name} +
+               "`. Allowed values are {" + std::string{enum_index<T>::allowed_names()} +
+               "}",
+           visitor, error_code::invalid_value, next_index);
+      return T{};
+    }
+    return maybe_enum_value.value();
   }
 
   // Visitor function for nested struct
+  // `arguments[current_index]` is the name of this sub-command
   template <typename T>
   inline typename std::enable_if<visit_struct::traits::is_visitable<T>::value, void>::type
   operator()(const char *name, T &value) {
-    if (next_index > current_index) {
-      current_index = next_index;
-    }
-
-    if (current_index < arguments.size()) {
-      const auto next = arguments[current_index];
-      const auto field_name = std::string{name};
-
-      // Check if `next` is the start of a subcommand
-      if (visitor.is_field_name(next) && next == field_name) {
-        next_index += 1;
-        value = parse_nested_struct<T>(name);
-      }
-    }
+    next_index += 1;
+    // its std::pmr fields keep the memory resource they were parsed with
+    assign_field(value, parse_nested_struct<T>(name));
   }
 
   // Visitor function for any positional field (not std::optional)
+  // `arguments[current_index]` is the (first) value of this field
   template <typename T>
   inline typename std::enable_if<!structopt::is_specialization<T, std::optional>::value &&
                                      !visit_struct::traits::is_visitable<T>::value,
                                  void>::type
   operator()(const char *name, T &result) {
-    if (next_index > current_index) {
-      current_index = next_index;
-    }
-
-    if (current_index < arguments.size()) {
-      const auto next = arguments[current_index];
-
-      if (is_optional(next)) {
-        return;
-      }
-
-      if (visitor.positional_field_names.empty()) {
-        // We're not looking to save any more positional fields
-        // all of them already have a value
-        // TODO: Report error, unexpected argument
-        return;
-      }
-
-      const auto field_name = visitor.positional_field_names.front();
-
-      // // This will be parsed as a subcommand (nested struct)
-      // if (visitor.is_field_name(next) && next == field_name) {
-      //   return;
-      // }
-
-      if (field_name != std::string{name}) {
-        // current field is not the one we want to parse
-        return;
-      }
-
-      // Remove from the positional field list as it is about to be parsed
-      visitor.positional_field_names.pop_front();
-
-      auto [value, success] = parse_argument<T>(field_name.c_str());
-      if (success) {
-        result = value;
-      } else {
-        // positional field does not yet have a value
-        visitor.positional_field_names.push_front(field_name);
-      }
+    auto [value, success] = parse_argument<T>(name);
+    if (success) {
+      assign_field(result, std::move(value));
+      // the next positional field takes the next value
+      positional_index += 1;
     }
   }
 
   // Visitor function for std::optional field
+  // `arguments[current_index]` names this field, e.g., -v, --verbose, --foo=bar
   template <typename T>
   inline typename std::enable_if<structopt::is_specialization<T, std::optional>::value,
                                  void>::type
   operator()(const char *name, T &value) {
-    if (next_index > current_index) {
-      current_index = next_index;
-    }
-
-    if (current_index < arguments.size()) {
-      const auto next = arguments[current_index];
-      const auto field_name = std::string{name};
-
-      if (next == "--" && double_dash_encountered == false) {
-        double_dash_encountered = true;
+    const auto next = token_at(current_index);
+
+    if (next.kind == token_kind::delimited_option) {
+      // e.g., --foo=bar or --foo:bar
+      // the value takes the place of the argument and is parsed as if
+      // `--foo bar` had been provided
+      const auto delimited = argument(current_index).substr(next.delimiter + 1);
+      arguments->replace(current_index, delimited);
+      assign_field(value, parse_optional_value<typename T::value_type>(name));
+      return;
+    }
+
+    if constexpr (std::is_same<typename T::value_type, bool>::value) {
+      // It is a boolean optional argument
+      // Does it have a default value?
+      // If yes, this is a FLAG argument, e.g,, "--verbose" will set it to true if the
+      // default value is false No need to write "--verbose true"
+      if (value.has_value()) {
+        // The field already has a default value!
+        value = !value.value(); // simply toggle it
         next_index += 1;
         return;
       }
-
-      // if `next` looks like an optional argument
-      // i.e., starts with `-` or `--`
-      // see if you can find an optional field in the struct with a matching name
-
-      // check if the current argument looks like it could be this optional field
-      if (double_dash_encountered == false && is_optional_field(next, field_name)) {
-
-        // this is an optional argument matching the current struct field
-        if constexpr (std::is_same<typename T::value_type, bool>::value) {
-          // It is a boolean optional argument
-          // Does it have a default value?
-          // If yes, this is a FLAG argument, e.g,, "--verbose" will set it to true if the
-          // default value is false No need to write "--verbose true"
-          if (value.has_value()) {
-            // The field already has a default value!
-            value = !value.value(); // simply toggle it
-            next_index += 1;
-          } else {
-            // boolean optional argument doesn't have a default value
-            // expect one
-            value = parse_optional_argument<typename T::value_type>(name);
-          }
-        } else {
-          // Not std::optional<bool>
-          // Parse the argument type <T>
-          value = parse_optional_argument<typename T::value_type>(name);
-        }
-      } else {
-        if (double_dash_encountered == false) {
-
-          // maybe this is an optional argument that is delimited with '=' or ':'
-          // e.g., --foo=bar or --foo:BAR
-          if (next.size() > 1 && next[0] == '-') {
-            const auto [success, delimiter] = is_delimited_optional_argument(next);
-            if (success) {
-              const auto [lhs, rhs] = split_delimited_argument(delimiter, next);
-              // update next_index and return
-              // the parser will take care of the rest
-
-              // if `lhs` is an optional argument (i.e., maps to an optional field in the original struct), then insert into arguments list
-              auto potential_field_name = get_full_optional_field_name(lhs);
-              if (potential_field_name.has_value()) {
-                for (auto &arg : {rhs, lhs}) {
-                  const auto begin = arguments.begin();
-                  arguments.insert(begin + next_index + 1, arg);
-                }
-              }
-              // get past the current argument, e.g., `--foo=bar`
-              next_index += 1;
-              return;
-            }
-          }
-
-          // A direct match of optional argument with field_name has not happened
-          // This _could_ be a combined argument
-          // e.g., -abc => -a, -b, and -c where each of these is a flag argument
-
-          std::vector<std::string> potential_combined_argument;
-
-          if (is_optional_field(next) == false && next[0] == '-' &&
-              (next.size() > 1 && next[1] != '-')) {
-            for (std::size_t i = 1; i < next.size(); i++) {
-              potential_combined_argument.push_back("-" + std::string(1, next[i]));
-            }
-          }
-
-          if (!potential_combined_argument.empty()) {
-            bool is_combined_argument = true;
-            for (auto &arg : potential_combined_argument) {
-              if (!is_optional_field(arg)) {
-                is_combined_argument = false;
-                // TODO: report error unrecognized option in combined argument
-              }
-            }
-
-            if (is_combined_argument) {
-
-              // check and make sure the current field_name is
-              // in `potential_combined_argument`
-              //
-              // Let's say the argument `next` is `-abc`
-              // the current field name is `b`
-              // 1. Split `-abc` into `-a`, `-b`, and `-c`
-              // 2. Check if `-b` is in the above list
-              //    1. If yes, consider this as a combined argument
-              //       push the list of arguments (split up) into `arguments`
-              //    2. If no, nothing to do here
-              bool field_name_matched = false;
-              for (auto &arg : potential_combined_argument) {
-                if (arg == "-" + std::string(1, field_name[0])) {
-                  field_name_matched = true;
-                }
-              }
-
-              if (field_name_matched) {
-                // confirmed: this is a combined argument
-
-                // insert the individual options that make up the combined argument
-                // right after the combined argument
-                // e.g., ""./main -abc" becomes "./main -abc -a -b -c"
-                // Once this is done, increment `next_index` so that the parser loop will
-                // service
-                // `-a`, `-b` and `-c` like any other optional arguments (flags and
-                // otherwise)
-                for (std::vector<std::string>::reverse_iterator it =
-                         potential_combined_argument.rbegin();
-                     it != potential_combined_argument.rend(); ++it) {
-                  auto &arg = *it;
-                  if (next_index < arguments.size()) {
-                    auto begin = arguments.begin();
-                    arguments.insert(begin + next_index + 1, arg);
-                  } else {
-                    arguments.push_back(arg);
-                  }
-                }
-
-                // get past the current combined argument
-                next_index += 1;
-              }
-            }
-          }
-        }
-      }
     }
+
+    // Parse the argument type <T>
+    // this includes a boolean optional argument without a default value
+    assign_field(value, parse_optional_argument<typename T::value_type>(name));
   }
 };
 
 // Specialization for std::string
 template <> inline std::string parser::parse_single_argument<std::string>(const char *) {
-  return arguments[next_index];
-}
-
-// Specialization for bool
-// yes, YES, on, 1, true, TRUE, etc. = true
-// no, NO, off, 0, false, FALSE, etc. = false
-// Converts argument to lower case before check
-template <> inline bool parser::parse_single_argument<bool>(const char *name) {
-  if (next_index > current_index) {
-    current_index = next_index;
-  }
-
-  if (current_index < arguments.size()) {
-    const std::vector<std::string> true_strings{"on", "yes", "1", "true"};
-    const std::vector<std::string> false_strings{"off", "no", "0", "false"};
-    std::string current_argument = arguments[current_index];
-
-    // Convert argument to lower case
-    std::transform(current_argument.begin(), current_argument.end(),
-                   current_argument.begin(),
-                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
-
-    // Detect if argument is true or false
-    if (std::find(true_strings.begin(), true_strings.end(), current_argument) !=
-        true_strings.end()) {
-      return true;
-    } else if (std::find(false_strings.begin(), false_strings.end(), current_argument) !=
-               false_strings.end()) {
-      return false;
-    } else {
-      throw structopt::exception("Error: failed to parse boolean argument `" +
-                                     std::string{name} + "`." + " `" + current_argument +
-                                     "`" + " is invalid.",
-                                 visitor);
-      return false;
-    }
-  } else {
-    return false;
-  }
+  return std::string{argument(next_index)};
 }
 
 } // namespace details
@@ -0,0 +1,210 @@
+#pragma once
+#include <cstddef>
+#include <deque>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <structopt/memory_resource.hpp>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define STRUCTOPT_HAS_MMAP
+#endif
+
+namespace structopt {
+
+namespace details {
+
+// The contents of a response file, memory-mapped where the platform allows
+// it, read into a buffer otherwise
+class mapped_file {
+  const char *data_{nullptr};
+  std::size_t size_{0};
+  bool is_mapped_{false};
+  std::vector<char> buffer_; // when the file could not be mapped
+
+public:
+  mapped_file() = default;
+
+  mapped_file(const mapped_file &) = delete;
+  mapped_file &operator=(const mapped_file &) = delete;
+
+  mapped_file(mapped_file &&other) noexcept
+      : data_(other.data_), size_(other.size_), is_mapped_(other.is_mapped_),
+        buffer_(std::move(other.buffer_)) {
+    other.data_ = nullptr;
+    other.size_ = 0;
+    other.is_mapped_ = false;
+  }
+
+  mapped_file &operator=(mapped_file &&other) noexcept {
+    if (this != &other) {
+      unmap();
+      data_ = other.data_;
+      size_ = other.size_;
+      is_mapped_ = other.is_mapped_;
+      buffer_ = std::move(other.buffer_);
+      other.data_ = nullptr;
+      other.size_ = 0;
+      other.is_mapped_ = false;
+    }
+    return *this;
+  }
+
+  ~mapped_file() { unmap(); }
+
+  // Returns std::nullopt if the file cannot be opened
+  static std::optional<mapped_file> open(const std::string &path) {
+    mapped_file result;
+#ifdef STRUCTOPT_HAS_MMAP
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return std::nullopt;
+    }
+    struct stat status {};
+    if (::fstat(fd, &status) != 0 || !S_ISREG(status.st_mode)) {
+      ::close(fd);
+      return std::nullopt;
+    }
+    result.size_ = static_cast<std::size_t>(status.st_size);
+    if (result.size_ > 0) {
+      void *data = ::mmap(nullptr, result.size_, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (data != MAP_FAILED) {
+        // the tokenizer reads the file once, front to back
+        ::madvise(data, result.size_, MADV_SEQUENTIAL);
+        result.data_ = static_cast<const char *>(data);
+        result.is_mapped_ = true;
+      }
+    }
+    ::close(fd);
+    if (result.size_ == 0 || result.is_mapped_) {
+      return result;
+    }
+#endif
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+      return std::nullopt;
+    }
+    result.buffer_.assign(std::istreambuf_iterator<char>(file),
+                          std::istreambuf_iterator<char>());
+    result.data_ = result.buffer_.data();
+    result.size_ = result.buffer_.size();
+    return result;
+  }
+
+  std::string_view contents() const { return {data_, size_}; }
+
+private:
+  void unmap() {
+#ifdef STRUCTOPT_HAS_MMAP
+    if (is_mapped_) {
+      ::munmap(const_cast<char *>(data_), size_);
+    }
+#endif
+    is_mapped_ = false;
+  }
+};
+
+// Splits the contents of a response file into arguments, one at a time
+//
+// A file that ends with a NUL byte, e.g., the output of `find -print0`, is
+// split at every NUL byte and nothing is unquoted. Any other file is split
+// at whitespace, like a shell would:
+// * 'single quotes' keep everything up to the next single quote
+// * "double quotes" keep everything up to the next double quote, where a
+//   backslash keeps a double quote or a backslash after it
+// * outside of quotes, a backslash keeps the character after it
+//
+// An argument that is written without quotes or backslashes is a view into
+// the file. Only an argument that has to be unquoted is copied, into
+// `unquoted`.
+class response_file_tokenizer {
+  std::string_view input;
+  std::size_t position{0};
+  bool is_nul_separated{false};
+
+  static bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+  }
+
+public:
+  explicit response_file_tokenizer(std::string_view input)
+      : input(input), is_nul_separated(!input.empty() && input.back() == '\0') {}
+
+  std::optional<std::string_view> next(scratch_deque<std::string> &unquoted) {
+    if (is_nul_separated) {
+      if (position == input.size()) {
+        return std::nullopt;
+      }
+      const auto end = input.find('\0', position);
+      const auto result = input.substr(position, end - position);
+      position = end + 1;
+      return result;
+    }
+
+    while (position < input.size() && is_space(input[position])) {
+      position += 1;
+    }
+    if (position == input.size()) {
+      return std::nullopt;
+    }
+
+    // Fast path: the argument is a view into the file
+    const auto start = position;
+    while (position < input.size() && !is_space(input[position])) {
+      const char c = input[position];
+      if (c == '\'' || c == '"' || c == '\\') {
+        break;
+      }
+      position += 1;
+    }
+    if (position == input.size() || is_space(input[position])) {
+      return input.substr(start, position - start);
+    }
+
+    // The argument is quoted or escaped; unquote it into its own string
+    auto &result = unquoted.emplace_back(input.substr(start, position - start));
+    char quote = '\0';
+    for (; position < input.size(); position++) {
+      const char c = input[position];
+      if (quote == '\'') {
+        if (c == '\'') {
+          quote = '\0';
+        } else {
+          result += c;
+        }
+      } else if (quote == '"') {
+        if (c == '"') {
+          quote = '\0';
+        } else if (c == '\\' && position + 1 < input.size() &&
+                   (input[position + 1] == '"' || input[position + 1] == '\\')) {
+          result += input[++position];
+        } else {
+          result += c;
+        }
+      } else if (c == '\'' || c == '"') {
+        quote = c;
+      } else if (c == '\\') {
+        if (position + 1 < input.size()) {
+          result += input[++position];
+        }
+      } else if (is_space(c)) {
+        break;
+      } else {
+        result += c;
+      }
+    }
+    // an unterminated quote ends with the file
+    return std::string_view(result);
+  }
+};
+
+} // namespace details
+
+} // namespace structopt
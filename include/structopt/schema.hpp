@@ -0,0 +1,270 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <optional>
+#include <queue>
+#include <set>
+#include <stack>
+#include <string_view>
+#include <structopt/is_specialization.hpp>
+#include <structopt/option_index.hpp>
+#include <structopt/third_party/visit_struct/visit_struct.hpp>
+#include <type_traits>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace structopt {
+
+namespace details {
+
+enum class field_kind : std::uint8_t { positional, optional, flag, nested_struct };
+
+// A field of a STRUCTOPT struct, as seen from the command line
+struct field_schema {
+  const char *name;
+  field_kind kind;
+  bool is_container; // a positional container can be happy without any arguments
+};
+
+// std::optional<bool> is a flag, any other std::optional is an option,
+// a nested struct is a sub-command, and everything else is positional
+template <typename T> constexpr field_kind kind_of() {
+  if constexpr (structopt::is_specialization<T, std::optional>::value) {
+    return std::is_same<typename T::value_type, bool>::value ? field_kind::flag
+                                                              : field_kind::optional;
+  } else if constexpr (visit_struct::traits::is_visitable<T>::value) {
+    return field_kind::nested_struct;
+  } else {
+    return field_kind::positional;
+  }
+}
+
+template <typename T> constexpr bool is_container_field() {
+  return structopt::is_specialization<T, std::deque>::value ||
+         structopt::is_specialization<T, std::list>::value ||
+         structopt::is_specialization<T, std::vector>::value ||
+         structopt::is_specialization<T, std::set>::value ||
+         structopt::is_specialization<T, std::multiset>::value ||
+         structopt::is_specialization<T, std::unordered_set>::value ||
+         structopt::is_specialization<T, std::unordered_multiset>::value ||
+         structopt::is_specialization<T, std::queue>::value ||
+         structopt::is_specialization<T, std::stack>::value ||
+         structopt::is_specialization<T, std::priority_queue>::value;
+}
+
+// Writes the help for `fields` that follows `USAGE: <name> `, or only
+// counts its characters if `out` is nullptr
+//
+// Field names are known at compile time, and so is the help; see help_of.
+template <std::size_t N>
+constexpr std::size_t render_help(const std::array<field_schema, N> &fields, char *out) {
+  std::size_t size = 0;
+  const auto put = [&size, out](char c) {
+    if (out) {
+      out[size] = c;
+    }
+    size += 1;
+  };
+  const auto write = [&put](const char *text) {
+    for (; *text; ++text) {
+      put(*text);
+    }
+  };
+  // e.g., `    -l, --log-level <log_level>`; the first `_` is shown as `-`
+  const auto write_option = [&put, &write](const char *name) {
+    write("    -");
+    put(name[0]);
+    write(", --");
+    bool is_kebab = false;
+    for (auto c = name; *c; ++c) {
+      put(*c == '_' && !is_kebab ? '-' : *c);
+      is_kebab = is_kebab || *c == '_';
+    }
+    write(" <");
+    write(name);
+    write(">\n");
+  };
+  const auto has = [&fields](field_kind kind) {
+    for (const auto &field : fields) {
+      if (field.kind == kind) {
+        return true;
+      }
+    }
+    return false;
+  };
+
+  const bool has_flags = has(field_kind::flag);
+  const bool has_sub_commands = has(field_kind::nested_struct);
+  const bool has_positional = has(field_kind::positional);
+
+  if (has_flags) {
+    write("[FLAGS] ");
+  }
+  write("[OPTIONS] ");
+  if (has_sub_commands) {
+    write("[SUBCOMMANDS] ");
+  }
+  for (const auto &field : fields) {
+    if (field.kind == field_kind::positional) {
+      write(field.name);
+      put(' ');
+    }
+  }
+
+  if (has_flags) {
+    write("\n\nFLAGS:\n");
+    for (const auto &field : fields) {
+      if (field.kind == field_kind::flag) {
+        write("    -");
+        put(field.name[0]);
+        write(", --");
+        write(field.name);
+        put('\n');
+      }
+    }
+  } else {
+    put('\n');
+  }
+
+  write("\nOPTIONS:\n");
+  for (const auto &field : fields) {
+    if (field.kind == field_kind::optional) {
+      write_option(field.name);
+    }
+  }
+  write_option("help");
+  write_option("version");
+
+  if (has_sub_commands) {
+    write("\nSUBCOMMANDS:\n");
+    for (const auto &field : fields) {
+      if (field.kind == field_kind::nested_struct) {
+        write("    ");
+        write(field.name);
+        put('\n');
+      }
+    }
+  }
+
+  if (has_positional) {
+    write("\nARGS:\n");
+    for (const auto &field : fields) {
+      if (field.kind == field_kind::positional) {
+        write("    ");
+        write(field.name);
+        put('\n');
+      }
+    }
+  }
+  return size;
+}
+
+// The help for the fields of `Table`, rendered at compile time into a
+// buffer that is written as a whole
+template <typename Table> struct help_of {
+  static constexpr std::size_t length = render_help(Table::fields, nullptr);
+
+  static constexpr std::array<char, length> text = [] {
+    std::array<char, length> result{};
+    render_help(Table::fields, result.data());
+    return result;
+  }();
+
+  static constexpr std::string_view view() { return {text.data(), length}; }
+};
+
+// The fields of a STRUCTOPT struct, in declaration order, and the order in
+// which positional fields take their values. Known at compile time.
+template <typename T> struct schema_table {
+  static constexpr std::size_t field_count = visit_struct::field_count<T>();
+
+  template <std::size_t... I>
+  static constexpr std::array<field_schema, field_count>
+  make_fields(std::index_sequence<I...>) {
+    return {{field_schema{visit_struct::get_name<I, T>(),
+                          kind_of<visit_struct::type_at<I, T>>(),
+                          is_container_field<visit_struct::type_at<I, T>>()}...}};
+  }
+
+  static constexpr std::array<field_schema, field_count> fields =
+      make_fields(std::make_index_sequence<field_count>{});
+
+  static constexpr std::size_t positional_count = [] {
+    std::size_t result = 0;
+    for (std::size_t i = 0; i < field_count; i++) {
+      result += fields[i].kind == field_kind::positional ? 1 : 0;
+    }
+    return result;
+  }();
+
+  static constexpr std::array<std::size_t, positional_count> positional_fields = [] {
+    std::array<std::size_t, positional_count> result{};
+    std::size_t j = 0;
+    for (std::size_t i = 0; i < field_count; i++) {
+      if (fields[i].kind == field_kind::positional) {
+        result[j++] = i;
+      }
+    }
+    return result;
+  }();
+};
+
+// The description of a STRUCTOPT struct used by the parser and the help
+//
+// Fields come from the compile-time schema_table. The name indices are
+// built once per type, the first time the type is parsed.
+struct schema {
+  const field_schema *fields{nullptr};
+  std::size_t field_count{0};
+  const std::size_t *positional_fields{nullptr}; // positions in `fields`
+  std::size_t positional_count{0};
+  option_index field_index;        // every field
+  option_index option_field_index; // optional and flag fields, then `help` and `version`
+  std::string_view help{"\n"}; // after `USAGE: <name> `
+
+  std::size_t help_field() const { return field_count; }
+
+  std::size_t version_field() const { return field_count + 1; }
+
+  bool is_option_field(std::size_t field) const {
+    return field < field_count && (fields[field].kind == field_kind::optional ||
+                                   fields[field].kind == field_kind::flag);
+  }
+};
+
+template <typename T> const schema &schema_of() {
+  using table = schema_table<T>;
+  static const schema result = [] {
+    schema s;
+    s.fields = table::fields.data();
+    s.field_count = table::field_count;
+    s.positional_fields = table::positional_fields.data();
+    s.positional_count = table::positional_count;
+    s.help = help_of<table>::view();
+
+    // Optional and flag fields keep their position in the struct so that
+    // a lookup yields the field to visit. The other fields are left unnamed.
+    std::vector<std::string_view> field_names, option_names;
+    for (const auto &field : table::fields) {
+      field_names.push_back(field.name);
+      option_names.push_back(field.kind == field_kind::optional ||
+                                     field.kind == field_kind::flag
+                                 ? field.name
+                                 : "");
+    }
+    option_names.push_back("help");
+    option_names.push_back("version");
+    s.field_index = option_index(field_names);
+    s.option_field_index = option_index(option_names);
+    return s;
+  }();
+  return result;
+}
+
+} // namespace details
+
+} // namespace structopt
@@ -1,17 +1,27 @@
 
 #pragma once
-#include <string>
+#include <cstddef>
+#include <string_view>
 
 namespace structopt {
 
 namespace details {
 
-static inline bool string_replace(std::string &str, const std::string &from,
-                                  const std::string &to) {
-  size_t start_pos = str.find(from);
-  if (start_pos == std::string::npos)
+// Locale-independent, unlike std::tolower
+constexpr char to_lower_ascii(char c) {
+  return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+// e.g., "True" and "TRUE" are equal to "true"
+constexpr bool is_case_insensitive_equal(std::string_view lhs, std::string_view rhs) {
+  if (lhs.size() != rhs.size()) {
     return false;
-  str.replace(start_pos, from.length(), to);
+  }
+  for (std::size_t i = 0; i < lhs.size(); i++) {
+    if (to_lower_ascii(lhs[i]) != to_lower_ascii(rhs[i])) {
+      return false;
+    }
+  }
   return true;
 }
 
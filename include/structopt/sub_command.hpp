@@ -1,22 +1,23 @@
-
 #pragma once
-#include <optional>
-#include <structopt/visitor.hpp>
 
 namespace structopt {
 
 namespace details {
 struct parser;
-}
+} // namespace details
 
+// Base of sub-command structs
+//
+// Kept to a flag, as every sub-command field carries it whether it is
+// invoked or not. The schema of a sub-command is shared by all instances of
+// its type, see details::schema_of.
 class sub_command {
-  std::optional<bool> invoked_;
-  details::visitor visitor_;
+  bool invoked_{false};
 
   friend struct structopt::details::parser;
 
 public:
-  bool has_value() const { return invoked_.has_value(); }
+  bool has_value() const { return invoked_; }
 };
 
-} // namespace structopt
\ No newline at end of file
+} // namespace structopt
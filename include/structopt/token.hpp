@@ -0,0 +1,220 @@
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <structopt/memory_resource.hpp>
+#include <structopt/response_file.hpp>
+#include <utility>
+#include <vector>
+
+namespace structopt {
+
+namespace details {
+
+enum class token_kind : std::uint8_t {
+  value,            // e.g., `foo.csv`, `-5`, or anything after `--`
+  double_dash,      // the first `--`, i.e., the end of optional arguments
+  option,           // e.g., `-v`, `--verbose`, `-log-level`
+  delimited_option, // e.g., `-std=c++17`, `--output:main`
+  combined_flags,   // e.g., `-abc`, where each letter is the short form of a field
+  unknown_option    // looks like an option but does not name any field
+};
+
+// A command-line argument, classified once by the parser
+struct token {
+  static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+  token_kind kind{token_kind::value};
+
+  // `option` and `delimited_option`: position of the field named by the
+  // argument (or by the part before the delimiter), see parser::classify
+  std::size_t field{npos};
+
+  // `delimited_option`: position of the delimiter, `=` or `:`, in the
+  // argument. The value starts right after it.
+  std::size_t delimiter{0};
+};
+
+// The command-line arguments of a parse, shared by the parser and the
+// parsers of its sub-commands, which continue at their own position in
+// the same list rather than on a copy of the remaining arguments
+//
+// Arguments are addressed by their position on the command line. A list
+// read from a `source` holds only the arguments that were read and not yet
+// released, starting at `offset`, see release.
+struct argument_list {
+  // views over argv, or over the strings passed to app::parse
+  // The parser replaces an argument in place with the part it still has to
+  // parse, e.g., `bar` for `--foo=bar`, so the list is never shifted
+  scratch_vector<std::string_view> arguments;
+
+  // tokens[i] classifies arguments[i], see parser::token_at
+  scratch_vector<token> tokens;
+
+  // position of arguments[0] on the command line
+  std::size_t offset{0};
+
+  // reads the next argument into its parameter, returns false at the end
+  // The arguments are read on demand, as the parser gets to them.
+  std::function<bool(std::string &)> source;
+
+  // the arguments read from `source`, which `arguments` point into
+  scratch_deque<std::string> streamed;
+
+  // response files that arguments point into, and the arguments of those
+  // files that had to be unquoted, see expand_response_files
+  std::vector<mapped_file> files;
+  scratch_deque<std::string> unquoted;
+
+  // where the lists above take their memory from
+  memory_resource *resource;
+
+  explicit argument_list(memory_resource *resource = default_memory_resource())
+      : arguments(make_value<scratch_vector<std::string_view>>(resource)),
+        tokens(make_value<scratch_vector<token>>(resource)),
+        streamed(make_value<scratch_deque<std::string>>(resource)),
+        unquoted(make_value<scratch_deque<std::string>>(resource)), resource(resource) {}
+
+  template <typename Iterator>
+  argument_list(Iterator first, Iterator last,
+                memory_resource *resource = default_memory_resource())
+      : argument_list(resource) {
+    assign(first, last);
+  }
+
+  // Starts over with the arguments in [first, last), keeping the memory of
+  // `arguments` and `tokens` for them
+  template <typename Iterator> void assign(Iterator first, Iterator last) {
+    clear();
+    arguments.reserve(static_cast<std::size_t>(std::distance(first, last)));
+    for (; first != last; ++first) {
+      arguments.emplace_back(*first);
+    }
+  }
+
+  void clear() {
+    arguments.clear();
+    tokens.clear();
+    offset = 0;
+    source = nullptr;
+    streamed.clear();
+    files.clear();
+    unquoted.clear();
+  }
+
+  bool is_streamed() const { return static_cast<bool>(source) || !streamed.empty(); }
+
+  // checks if there is an argument at `index`, reading from `source` up to it
+  bool has(std::size_t index) {
+    while (index - offset >= arguments.size()) {
+      if (!source) {
+        return false;
+      }
+      auto &next = streamed.emplace_back();
+      if (!source(next)) {
+        streamed.pop_back();
+        source = nullptr;
+        return false;
+      }
+      arguments.emplace_back(next);
+    }
+    return true;
+  }
+
+  std::string_view operator[](std::size_t index) const {
+    return arguments[index - offset];
+  }
+
+  // Replaces the argument at `index`, e.g., with its value, which is then
+  // classified anew
+  void replace(std::size_t index, std::string_view argument) {
+    arguments[index - offset] = argument;
+    reclassify(index);
+  }
+
+  // Forgets the tokens from `index` on, so that the arguments are classified
+  // again the next time they are asked for
+  void reclassify(std::size_t index) {
+    if (tokens.size() > index - offset) {
+      tokens.resize(index - offset);
+    }
+  }
+
+  // Releases the arguments before `index`, which the parser is done with
+  //
+  // A list read from `source` drops them once they make up half of it, so
+  // that a long run of values, e.g., the elements of a std::vector field,
+  // takes no more memory than the field it is parsed into. Other lists keep
+  // their arguments.
+  void release(std::size_t index) {
+    if (streamed.empty()) {
+      return;
+    }
+    const auto count = index - offset;
+    if (count < 1024 || count * 2 < arguments.size()) {
+      return;
+    }
+    arguments.erase(arguments.begin(), arguments.begin() + count);
+    tokens.erase(tokens.begin(), tokens.begin() + std::min(count, tokens.size()));
+    streamed.erase(streamed.begin(), streamed.begin() + count);
+    offset = index;
+  }
+
+  // Replaces every `@path` argument with the arguments in the file at `path`
+  //
+  // The program name and the arguments after `--` are left as they are, and
+  // so is `@path` if there is no file to read at `path`. Arguments in a
+  // response file, or read from a `source`, are not expanded.
+  void expand_response_files() {
+    std::size_t first = 1;
+    while (first < arguments.size() && !is_response_file(arguments[first])) {
+      if (arguments[first] == "--") {
+        return;
+      }
+      first += 1;
+    }
+    if (first >= arguments.size()) {
+      return;
+    }
+
+    auto expanded = make_value<scratch_vector<std::string_view>>(resource);
+    expanded.assign(arguments.begin(), arguments.begin() + first);
+    bool is_after_double_dash = false;
+    for (auto i = first; i < arguments.size(); i++) {
+      const auto argument = arguments[i];
+      is_after_double_dash = is_after_double_dash || argument == "--";
+      if (is_after_double_dash || !is_response_file(argument)) {
+        expanded.push_back(argument);
+        continue;
+      }
+
+      auto file = mapped_file::open(std::string(argument.substr(1)));
+      if (!file) {
+        expanded.push_back(argument);
+        continue;
+      }
+      // the views stay valid when `files` grows; the mapping does not move
+      response_file_tokenizer tokenizer(file->contents());
+      files.push_back(std::move(*file));
+      while (auto next = tokenizer.next(unquoted)) {
+        expanded.push_back(*next);
+      }
+    }
+    arguments = std::move(expanded);
+  }
+
+private:
+  static bool is_response_file(std::string_view argument) {
+    return argument.size() > 1 && argument[0] == '@';
+  }
+};
+
+} // namespace details
+
+} // namespace structopt
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <structopt/third_party/visit_struct/visit_struct.hpp>
+#include <utility>
+
+namespace structopt {
+
+namespace details {
+
+template <typename T, typename F, std::size_t... I>
+void visit_field(T &argument_struct, std::size_t field, F &visitor,
+                 std::index_sequence<I...>) {
+  using handler = void (*)(T &, F &);
+  static constexpr handler handlers[] = {[](T &s, F &v) {
+    v(visit_struct::get_name<I, T>(), visit_struct::get<I>(s));
+  }...};
+  handlers[field](argument_struct, visitor);
+}
+
+// Call `visitor(name, value)` for the field at position `field` of a
+// visitable struct. Unlike visit_struct::for_each, this is a single
+// indirect call no matter how many fields the struct has.
+template <typename T, typename F>
+void visit_field(T &argument_struct, std::size_t field, F &visitor) {
+  constexpr std::size_t field_count = visit_struct::field_count<T>();
+  if constexpr (field_count > 0) {
+    if (field < field_count) {
+      visit_field(argument_struct, field, visitor,
+                  std::make_index_sequence<field_count>{});
+    }
+  }
+}
+
+} // namespace details
+
+} // namespace structopt
@@ -1755,558 +1755,2640 @@ template <typename T> struct is_stl_container {
 } // namespace structopt
 
 #pragma once
-#include <string>
+#include <cstddef>
+#include <string_view>
 
 namespace structopt {
 
 namespace details {
 
-static inline bool string_replace(std::string &str, const std::string &from,
-                                  const std::string &to) {
-  size_t start_pos = str.find(from);
-  if (start_pos == std::string::npos)
+// Locale-independent, unlike std::tolower
+constexpr char to_lower_ascii(char c) {
+  return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+// e.g., "True" and "TRUE" are equal to "true"
+constexpr bool is_case_insensitive_equal(std::string_view lhs, std::string_view rhs) {
+  if (lhs.size() != rhs.size()) {
     return false;
-  str.replace(start_pos, from.length(), to);
+  }
+  for (std::size_t i = 0; i < lhs.size(); i++) {
+    if (to_lower_ascii(lhs[i]) != to_lower_ascii(rhs[i])) {
+      return false;
+    }
+  }
   return true;
 }
 
 } // namespace details
 
-} // namespace structopt
-#pragma once
-#include <string>
+} // namespace structopt#pragma once
+#include <optional>
+#include <string_view>
+// #include <structopt/string.hpp>
 
 namespace structopt {
 
-namespace details {
-
-static inline bool is_binary_notation(std::string const &input) {
-  return input.compare(0, 2, "0b") == 0 && input.size() > 2 &&
-         input.find_first_not_of("01", 2) == std::string::npos;
-}
+// The spellings of boolean values, matched regardless of case
+//
+// Specialize to accept other spellings, e.g.,
+//
+//   template <> struct structopt::bool_literals<> {
+//     static constexpr std::string_view true_literals[] = {"true", "enabled"};
+//     static constexpr std::string_view false_literals[] = {"false", "disabled"};
+//   };
+template <typename = void> struct bool_literals {
+  static constexpr std::string_view true_literals[] = {"on", "yes", "1", "true"};
+  static constexpr std::string_view false_literals[] = {"off", "no", "0", "false"};
+};
 
-static inline bool is_hex_notation(std::string const &input) {
-  return input.compare(0, 2, "0x") == 0 && input.size() > 2 &&
-         input.find_first_not_of("0123456789abcdefABCDEF", 2) == std::string::npos;
-}
+namespace details {
 
-static inline bool is_octal_notation(std::string const &input) {
-  return input.compare(0, 1, "0") == 0 && input.size() > 1 &&
-         input.find_first_not_of("01234567", 1) == std::string::npos;
+// Convert a boolean argument without copying or allocating, e.g., YES => true
+//
+// A template, so that bool_literals<> is only looked into where a boolean
+// is parsed, after any specialization of it
+template <typename Literals = bool_literals<>>
+constexpr std::optional<bool> parse_bool(std::string_view input) {
+  for (auto literal : Literals::true_literals) {
+    if (is_case_insensitive_equal(input, literal)) {
+      return true;
+    }
+  }
+  for (auto literal : Literals::false_literals) {
+    if (is_case_insensitive_equal(input, literal)) {
+      return false;
+    }
+  }
+  return std::nullopt;
 }
 
-static inline bool is_valid_number(const std::string &input) {
-  if (is_binary_notation(input) || is_hex_notation(input) || is_octal_notation(input)) {
-    return true;
-  }
+} // namespace details
 
-  if (input.empty()) {
-    return false;
-  }
+} // namespace structopt
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
 
-  std::size_t i = 0, j = input.length() - 1;
+namespace structopt {
 
-  // Handling whitespaces
-  while (i < input.length() && input[i] == ' ')
-    i++;
-  while (input[j] == ' ')
-    j--;
+namespace details {
 
-  if (i > j)
-    return false;
+enum class number_notation : std::uint8_t {
+  none,           // not a number, e.g., -v or foo.csv
+  decimal,        // e.g., 5, -10, +3
+  floating_point, // e.g., 3.14, -.5, 1e-3
+  hex,            // e.g., 0x5B, -0x5B
+  octal,          // e.g., 071
+  binary          // e.g., 0b0101
+};
 
-  // if string is of length 1 and the only
-  // character is not a digit
-  if (i == j && !(input[i] >= '0' && input[i] <= '9'))
-    return false;
+// The shape of a command-line argument, found in a single scan
+struct argument_shape {
+  static constexpr std::size_t npos = std::string_view::npos;
 
-  // If the 1st char is not '+', '-', '.' or digit
-  if (input[i] != '.' && input[i] != '+' && input[i] != '-' &&
-      !(input[i] >= '0' && input[i] <= '9'))
-    return false;
+  number_notation notation{number_notation::none};
 
-  // To check if a '.' or 'e' is found in given
-  // string. We use this flag to make sure that
-  // either of them appear only once.
-  bool dot_or_exp = false;
+  // `hex`, `octal`, and `binary`: where the digits start, after the sign
+  // and the notation prefix, e.g., 3 for -0x5B
+  std::size_t digits{0};
 
-  for (; i <= j; i++) {
-    // If any of the char does not belong to
-    // {digit, +, -, ., e}
-    if (input[i] != 'e' && input[i] != '.' && input[i] != '+' && input[i] != '-' &&
-        !(input[i] >= '0' && input[i] <= '9'))
-      return false;
+  bool negative{false}; // a number with a leading '-'
 
-    if (input[i] == '.') {
-      // checks if the char 'e' has already
-      // occurred before '.' If yes, return false;.
-      if (dot_or_exp == true)
-        return false;
+  // position of the first '=' or ':', e.g., 3 for -o=main
+  std::size_t delimiter{npos};
 
-      // If '.' is the last character.
-      if (i + 1 > input.length())
-        return false;
+  // the part before the delimiter is a number, e.g., -5 in -5=x
+  bool key_is_number{false};
+};
 
-      // if '.' is not followed by a digit.
-      if (!(input[i + 1] >= '0' && input[i + 1] <= '9'))
-        return false;
+// Scan an argument once, character by character
+//
+// A number is an optional sign followed by
+// * 0x and hex digits, or 0b and binary digits
+// * 0 and octal digits
+// * decimal digits with an optional fraction and exponent, e.g., 1.5e-3
+constexpr argument_shape scan_argument(std::string_view input) {
+  enum class state : std::uint8_t {
+    start,
+    sign,            // after '+' or '-'
+    zero,            // a leading 0, e.g., 0 in 071 or 0x5B
+    prefix,          // after 0x or 0b, before the first digit
+    prefixed_digits, // hex or binary digits
+    integer,         // decimal digits
+    dot,             // '.' before the fraction digits
+    fraction,        // digits after '.'
+    exponent,        // after 'e' or 'E'
+    exponent_sign,   // after the sign of the exponent
+    exponent_digits,
+    invalid
+  };
+
+  argument_shape result;
+  auto s = state::start;
+  auto notation = number_notation::decimal;
+  bool is_octal = true; // every digit after the leading 0 is an octal digit
+
+  const auto is_number = [&]() {
+    switch (s) {
+    case state::zero:
+    case state::prefixed_digits:
+    case state::integer:
+    case state::fraction:
+    case state::exponent_digits:
+      return true;
+    default:
+      return false;
+    }
+  };
+
+  for (std::size_t i = 0; i < input.size(); i++) {
+    const char c = input[i];
+    if (c == '=' || c == ':') {
+      result.delimiter = i;
+      result.key_is_number = is_number();
+      return result;
     }
 
-    else if (input[i] == 'e') {
-      // set dot_or_exp = 1 when e is encountered.
-      dot_or_exp = true;
+    const bool is_digit = c >= '0' && c <= '9';
+    switch (s) {
+    case state::start:
+      if (c == '+' || c == '-') {
+        result.negative = c == '-';
+        s = state::sign;
+      } else if (c == '0') {
+        s = state::zero;
+      } else if (is_digit) {
+        s = state::integer;
+      } else if (c == '.') {
+        s = state::dot;
+      } else {
+        s = state::invalid;
+      }
+      break;
+    case state::sign:
+      if (c == '0') {
+        s = state::zero;
+      } else if (is_digit) {
+        s = state::integer;
+      } else if (c == '.') {
+        s = state::dot;
+      } else {
+        s = state::invalid;
+      }
+      break;
+    case state::zero:
+      if (c == 'x' || c == 'b') {
+        notation = c == 'x' ? number_notation::hex : number_notation::binary;
+        result.digits = i + 1;
+        s = state::prefix;
+      } else if (is_digit) {
+        is_octal = is_octal && c <= '7';
+        notation = number_notation::octal;
+        result.digits = i;
+        s = state::integer;
+      } else if (c == '.') {
+        s = state::dot;
+      } else if (c == 'e' || c == 'E') {
+        s = state::exponent;
+      } else {
+        s = state::invalid;
+      }
+      break;
+    case state::prefix:
+    case state::prefixed_digits:
+      if ((notation == number_notation::binary && (c == '0' || c == '1')) ||
+          (notation == number_notation::hex &&
+           (is_digit || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F')))) {
+        s = state::prefixed_digits;
+      } else {
+        s = state::invalid;
+      }
+      break;
+    case state::integer:
+      if (is_digit) {
+        is_octal = is_octal && c <= '7';
+      } else if (c == '.') {
+        s = state::dot;
+      } else if (c == 'e' || c == 'E') {
+        s = state::exponent;
+      } else {
+        s = state::invalid;
+      }
+      break;
+    case state::dot:
+      s = is_digit ? state::fraction : state::invalid;
+      break;
+    case state::fraction:
+      if (c == 'e' || c == 'E') {
+        s = state::exponent;
+      } else if (!is_digit) {
+        s = state::invalid;
+      }
+      break;
+    case state::exponent:
+      if (c == '+' || c == '-') {
+        s = state::exponent_sign;
+      } else {
+        s = is_digit ? state::exponent_digits : state::invalid;
+      }
+      break;
+    case state::exponent_sign:
+    case state::exponent_digits:
+      s = is_digit ? state::exponent_digits : state::invalid;
+      break;
+    case state::invalid:
+      break;
+    }
 
-      // if there is no digit before 'e'.
-      if (!(input[i - 1] >= '0' && input[i - 1] <= '9'))
-        return false;
+    if (s == state::invalid) {
+      // not a number; only the delimiter is left to find
+      const auto delimiter = input.find_first_of("=:", i + 1);
+      if (delimiter != std::string_view::npos) {
+        result.delimiter = delimiter;
+      }
+      result.negative = false;
+      return result;
+    }
+  }
 
-      // If 'e' is the last Character
-      if (i + 1 > input.length())
-        return false;
+  if (!is_number()) {
+    result.negative = false;
+    return result;
+  }
 
-      // if e is not followed either by
-      // '+', '-' or a digit
-      if (input[i + 1] != '+' && input[i + 1] != '-' &&
-          (input[i + 1] >= '0' && input[i] <= '9'))
-        return false;
-    }
+  if (s == state::fraction || s == state::exponent_digits) {
+    result.notation = number_notation::floating_point;
+  } else if (notation == number_notation::octal && !is_octal) {
+    // e.g., 089
+    result.notation = number_notation::decimal;
+  } else {
+    result.notation = notation;
   }
+  if (result.notation == number_notation::decimal) {
+    result.digits = 0;
+  }
+  return result;
+}
 
-  /* If the string skips all above cases, then
-  it is numeric*/
-  return true;
+constexpr bool is_valid_number(std::string_view input) {
+  return scan_argument(input).notation != number_notation::none;
 }
 
 } // namespace details
 
 } // namespace structopt
-
 #pragma once
-#include <algorithm>
-#include <iostream>
-#include <optional>
-#include <queue>
-#include <string>
-// #include <structopt/is_specialization.hpp>
-// #include <structopt/string.hpp>
-// #include <structopt/third_party/visit_struct/visit_struct.hpp>
+#include <charconv>
+#include <cmath>
+#include <limits>
+#include <string_view>
+// #include <structopt/is_number.hpp>
+#include <system_error>
 #include <type_traits>
-#include <vector>
 
 namespace structopt {
 
-class app;
-
 namespace details {
 
-struct visitor {
-  std::string name;
-  std::string version;
-  std::vector<std::string> field_names;
-  std::deque<std::string> positional_field_names; // mutated by parser
-  std::deque<std::string> positional_field_names_for_help;
-  std::deque<std::string> vector_like_positional_field_names;
-  std::deque<std::string> flag_field_names;
-  std::deque<std::string> optional_field_names;
-  std::deque<std::string> nested_struct_field_names;
-
-  visitor() = default;
-
-  explicit visitor(const std::string &name, const std::string &version)
-      : name(name), version(version) {}
-
-  // Visitor function for std::optional - could be an option or a flag
-  template <typename T>
-  inline typename std::enable_if<structopt::is_specialization<T, std::optional>::value,
-                                 void>::type
-  operator()(const char *name, T &) {
-    field_names.push_back(name);
-    if constexpr (std::is_same<typename T::value_type, bool>::value) {
-      flag_field_names.push_back(name);
-    } else {
-      optional_field_names.push_back(name);
+// Integral and floating point types are converted with std::from_chars
+// Character types are read as characters, e.g., `std::optional<char> c`
+template <typename T>
+struct is_from_chars_number
+    : std::integral_constant<bool, (std::is_integral<T>::value &&
+                                    !std::is_same<T, bool>::value &&
+                                    !std::is_same<T, char>::value &&
+                                    !std::is_same<T, signed char>::value &&
+                                    !std::is_same<T, unsigned char>::value &&
+                                    !std::is_same<T, wchar_t>::value &&
+                                    !std::is_same<T, char16_t>::value &&
+                                    !std::is_same<T, char32_t>::value) ||
+                                       std::is_floating_point<T>::value> {};
+
+// Convert a decimal number with a fraction or an exponent to an integer,
+// truncated toward zero, e.g., -1.9 => -1 and 1.5e1 => 15
+template <typename T> std::errc parse_integral_part(std::string_view input, T &result) {
+  if (input.find_first_of("eE") == std::string_view::npos) {
+    // e.g., -1.1: the digits before the point are converted exactly, and
+    // the ones after it have to be digits
+    const auto point = input.find('.');
+    for (auto c : input.substr(point + 1)) {
+      if (c < '0' || c > '9') {
+        return std::errc::invalid_argument;
+      }
     }
+    const auto integral = input.substr(0, point);
+    if (integral.empty() || integral == "-") {
+      result = 0; // e.g., .5 or -.5
+      return std::errc{};
+    }
+    T value{};
+    const auto [end, error] =
+        std::from_chars(integral.data(), integral.data() + integral.size(), value);
+    if (error != std::errc{}) {
+      return error;
+    } else if (end != integral.data() + integral.size()) {
+      return std::errc::invalid_argument;
+    }
+    result = value;
+    return std::errc{};
   }
 
-  // Visitor function for any positional field (not std::optional)
-  template <typename T>
-  inline typename std::enable_if<!structopt::is_specialization<T, std::optional>::value &&
-                                     !visit_struct::traits::is_visitable<T>::value,
-                                 void>::type
-  operator()(const char *name, T &) {
-    field_names.push_back(name);
-    positional_field_names.push_back(name);
-    positional_field_names_for_help.push_back(name);
-    if constexpr (structopt::is_specialization<T, std::deque>::value ||
-                  structopt::is_specialization<T, std::list>::value ||
-                  structopt::is_specialization<T, std::vector>::value ||
-                  structopt::is_specialization<T, std::set>::value ||
-                  structopt::is_specialization<T, std::multiset>::value ||
-                  structopt::is_specialization<T, std::unordered_set>::value ||
-                  structopt::is_specialization<T, std::unordered_multiset>::value ||
-                  structopt::is_specialization<T, std::queue>::value ||
-                  structopt::is_specialization<T, std::stack>::value ||
-                  structopt::is_specialization<T, std::priority_queue>::value) {
-      // keep track of vector-like fields as these (even though positional)
-      // can be happy without any arguments
-      vector_like_positional_field_names.push_back(name);
-    }
-  }
-
-  // Visitor function for nested structs
-  template <typename T>
-  inline typename std::enable_if<visit_struct::traits::is_visitable<T>::value, void>::type
-  operator()(const char *name, T &) {
-    field_names.push_back(name);
-    nested_struct_field_names.push_back(name);
+  // e.g., -1e3 or 1.5e1: the value is computed as a double, which has to be
+  // in the range of `T` once truncated
+  const auto last = input.data() + input.size();
+  double value{};
+  const auto [end, error] = std::from_chars(input.data(), last, value);
+  if (error != std::errc{}) {
+    return error;
+  } else if (end != last) {
+    return std::errc::invalid_argument;
   }
-
-  bool is_field_name(const std::string &field_name) {
-    return std::find(field_names.begin(), field_names.end(), field_name) !=
-           field_names.end();
+  const auto integral = std::trunc(value);
+  const auto bound = std::ldexp(1.0, std::numeric_limits<T>::digits); // max() + 1
+  const auto lowest = std::is_signed<T>::value ? -bound : 0.0;
+  if (integral < lowest || integral >= bound) {
+    return std::errc::result_out_of_range;
   }
+  result = static_cast<T>(integral);
+  return std::errc{};
+}
 
-  void print_help(std::ostream &os) const {
-    os << "\nUSAGE: " << name << " ";
-
-    if (flag_field_names.empty() == false) {
-      os << "[FLAGS] ";
-    }
-
-    if (optional_field_names.empty() == false) {
-      os << "[OPTIONS] ";
-    }
-
-    if (nested_struct_field_names.empty() == false) {
-      os << "[SUBCOMMANDS] ";
-    }
-
-    for (auto &field : positional_field_names_for_help) {
-      os << field << " ";
+// Convert a numeric argument without locales or allocations
+//
+// Integers can be written in binary, hex, or octal notation, e.g., 0b0101,
+// -0x5B, or 071. The whole argument has to be a number: trailing characters
+// are reported as std::errc::invalid_argument and values that do not fit
+// into `T` as std::errc::result_out_of_range. Decimal fractions are
+// truncated when converted to an integer, e.g., -1.1 => -1, and exponents
+// are applied, e.g., -1e3 => -1000.
+template <typename T> std::errc parse_number(std::string_view input, T &result) {
+  const auto shape = scan_argument(input);
+  const auto last = input.data() + input.size();
+
+  // std::from_chars accepts a leading '-' but not a leading '+'
+  const auto first =
+      input.data() + (shape.notation != number_notation::none && input[0] == '+' ? 1 : 0);
+
+  if constexpr (std::is_integral<T>::value) {
+    int base = 10;
+    switch (shape.notation) {
+    case number_notation::none:
+      return std::errc::invalid_argument;
+    case number_notation::decimal:
+      break;
+    case number_notation::floating_point:
+      return parse_integral_part(std::string_view(first, last - first), result);
+    case number_notation::hex:
+      base = 16;
+      break;
+    case number_notation::octal:
+      base = 8;
+      break;
+    case number_notation::binary:
+      base = 2;
+      break;
     }
 
-    if (flag_field_names.empty() == false) {
-      os << "\n\nFLAGS:\n";
-      for (auto &flag : flag_field_names) {
-        os << "    -" << flag[0] << ", --" << flag << "\n";
+    if (base == 10 || !shape.negative) {
+      // the digits follow the sign and the notation prefix, e.g., +0x
+      const auto digits = base == 10 ? first : input.data() + shape.digits;
+      const auto [end, error] = std::from_chars(digits, last, result, base);
+      if (error == std::errc{} && end != last) {
+        return std::errc::invalid_argument;
       }
-    } else {
-      os << "\n";
+      return error;
     }
 
-    if (optional_field_names.empty() == false) {
-      os << "\nOPTIONS:\n";
-      for (auto &option : optional_field_names) {
-
-        // Generate kebab case and present as option
-        auto kebab_case = option;
-        details::string_replace(kebab_case, "_", "-");
-        std::string long_form = "";
-        if (kebab_case != option) {
-          long_form = kebab_case;
-        } else {
-          long_form = option;
-        }
-
-        os << "    -" << option[0] << ", --" << long_form << " <" << option << ">"
-           << "\n";
+    // e.g., -0x5B; the sign comes before the notation prefix, where
+    // std::from_chars does not expect it
+    if constexpr (std::is_signed<T>::value) {
+      using magnitude_type = typename std::make_unsigned<T>::type;
+      magnitude_type magnitude{};
+      const auto digits = input.data() + shape.digits;
+      const auto [end, error] = std::from_chars(digits, last, magnitude, base);
+      if (error != std::errc{}) {
+        return error;
+      } else if (end != last) {
+        return std::errc::invalid_argument;
       }
-    }
 
-    if (nested_struct_field_names.empty() == false) {
-      os << "\nSUBCOMMANDS:\n";
-      for (auto &sc : nested_struct_field_names) {
-        os << "    " << sc << "\n";
+      const auto limit = static_cast<magnitude_type>(
+          static_cast<magnitude_type>(std::numeric_limits<T>::max()) + 1);
+      if (magnitude > limit) {
+        return std::errc::result_out_of_range;
       }
+      result = magnitude == limit ? std::numeric_limits<T>::min()
+                                  : static_cast<T>(-static_cast<T>(magnitude));
+      return std::errc{};
+    } else {
+      return std::errc::invalid_argument;
     }
-
-    if (positional_field_names_for_help.empty() == false) {
-      os << "\nARGS:\n";
-      for (auto &arg : positional_field_names_for_help) {
-        os << "    " << arg << "\n";
-      }
+  } else {
+    const auto [end, error] = std::from_chars(first, last, result);
+    if (error == std::errc{} && end != last) {
+      return std::errc::invalid_argument;
     }
+    return error;
   }
-};
+}
 
 } // namespace details
 
 } // namespace structopt
-
 #pragma once
-#include <exception>
-#include <sstream>
-#include <string>
-// #include <structopt/visitor.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
 
 namespace structopt {
 
-class exception : public std::exception {
-  std::string what_{""};
-  std::string help_{""};
-  details::visitor visitor_;
+namespace details {
+
+// FNV-1a, 64 bits wide on every platform, e.g., the same on Win32 as on x64
+class fnv1a {
+  std::uint64_t state_{14695981039346656037ull};
 
 public:
-  exception(const std::string &what, const details::visitor &visitor)
-      : what_(what), help_(""), visitor_(visitor) {
-    std::stringstream os;
-    visitor_.print_help(os);
-    help_ = os.str();
+  constexpr fnv1a &add(char c) {
+    state_ ^= static_cast<unsigned char>(c);
+    state_ *= 1099511628211ull;
+    return *this;
   }
 
-  const char *what() const throw() { return what_.c_str(); }
+  // Hashes `text` as `map` spells it, e.g., with `-` for `_`
+  template <typename Map> constexpr fnv1a &add(std::string_view text, Map map) {
+    for (auto c : text) {
+      add(map(c));
+    }
+    return *this;
+  }
 
-  const char *help() const throw() { return help_.c_str(); }
+  constexpr std::size_t value() const { return static_cast<std::size_t>(state_); }
 };
 
-} // namespace structopt
-#pragma once
-#include <optional>
-// #include <structopt/visitor.hpp>
-
-namespace structopt {
-
-namespace details {
-struct parser;
+// The number of slots of an open addressing table for `count` keys: a power
+// of two, at least 8, and at least twice `count`, so the table is at most
+// half full
+constexpr std::size_t hash_table_capacity(std::size_t count) {
+  std::size_t result = 8;
+  while (result < count * 2) {
+    result *= 2;
+  }
+  return result;
 }
 
-class sub_command {
-  std::optional<bool> invoked_;
-  details::visitor visitor_;
-
-  friend struct structopt::details::parser;
+// Walks the open addressing table `slots` from the slot of `hash`, and
+// returns the position of the first slot that is empty or that `matches`.
+// The table is never full, so the walk ends.
+template <typename Slots, typename IsEmpty, typename Matches>
+constexpr std::size_t hash_table_probe(const Slots &slots, std::size_t hash,
+                                       IsEmpty is_empty, Matches matches) {
+  const auto mask = slots.size() - 1;
+  auto i = hash & mask;
+  while (!is_empty(slots[i]) && !matches(slots[i])) {
+    i = (i + 1) & mask;
+  }
+  return i;
+}
 
-public:
-  bool has_value() const { return invoked_.has_value(); }
-};
+} // namespace details
 
 } // namespace structopt
 #pragma once
-#include <algorithm>
 #include <array>
-#include <cctype>
-#include <iostream>
-#include <iterator>
-#include <set>
-#include <sstream>
-#include <string>
-// #include <structopt/array_size.hpp>
-// #include <structopt/exception.hpp>
-// #include <structopt/is_number.hpp>
-// #include <structopt/is_specialization.hpp>
-// #include <structopt/sub_command.hpp>
+#include <cstddef>
+#include <limits>
+#include <optional>
+#include <string_view>
+// #include <structopt/hash_table.hpp>
+// #include <structopt/string.hpp>
 // #include <structopt/third_party/magic_enum/magic_enum.hpp>
-// #include <structopt/third_party/visit_struct/visit_struct.hpp>
-#include <tuple>
 #include <type_traits>
-#include <utility>
-#include <vector>
 
 namespace structopt {
 
-namespace details {
+// Specialize to match the names of an enum regardless of case, e.g.,
+//
+//   template <> struct structopt::case_insensitive_enum<Codec> : std::true_type {};
+template <typename T> struct case_insensitive_enum : std::false_type {};
 
-struct parser {
-  structopt::details::visitor visitor;
-  std::vector<std::string> arguments;
-  std::size_t current_index{1};
-  std::size_t next_index{1};
-  bool double_dash_encountered{false}; // "--" option-argument delimiter
-  bool sub_command_invoked{false};
-  std::string already_invoked_subcommand_name{""};
+namespace details {
 
-  bool is_optional(const std::string &name) {
-    if (double_dash_encountered) {
-      return false;
-    } else if (name == "--") {
-      double_dash_encountered = true;
-      return false;
-    } else if (is_valid_number(name)) {
+constexpr bool is_enum_name_equal(std::string_view lhs, std::string_view rhs,
+                                  bool ignore_case) {
+  if (lhs.size() != rhs.size()) {
+    return false;
+  }
+  for (std::size_t i = 0; i < lhs.size(); i++) {
+    const auto l = ignore_case ? to_lower_ascii(lhs[i]) : lhs[i];
+    const auto r = ignore_case ? to_lower_ascii(rhs[i]) : rhs[i];
+    if (l != r) {
       return false;
     }
+  }
+  return true;
+}
 
-    bool result = false;
-    if (name.size() >= 2) {
-      // e.g., -b, -v
-      if (name[0] == '-') {
-        result = true;
-        // e.g., --verbose
-        if (name[1] == '-') {
-          result = true;
-        }
-      }
+constexpr std::size_t enum_name_hash(std::string_view name, bool ignore_case) {
+  return fnv1a()
+      .add(name, [ignore_case](char c) { return ignore_case ? to_lower_ascii(c) : c; })
+      .value();
+}
+
+// Maps the names of an enum to their values
+//
+// The table is an open addressing hash table, built at compile time from
+// magic_enum::enum_names<T>() and at most half full, so a lookup costs the
+// same no matter how many values the enum has.
+template <typename T> struct enum_index {
+  static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+  static constexpr std::size_t count = magic_enum::enum_count<T>();
+  static constexpr bool ignore_case = case_insensitive_enum<T>::value;
+
+  static constexpr std::size_t capacity = hash_table_capacity(count);
+
+  static constexpr bool is_empty(std::size_t slot) { return slot == npos; }
+
+  // position of the name in magic_enum::enum_names<T>(), or npos
+  static constexpr std::array<std::size_t, capacity> slots = [] {
+    std::array<std::size_t, capacity> result{};
+    for (auto &slot : result) {
+      slot = npos;
+    }
+    constexpr auto names = magic_enum::enum_names<T>();
+    for (std::size_t i = 0; i < count; i++) {
+      // the names of an enum are unique
+      result[hash_table_probe(result, enum_name_hash(names[i], ignore_case), is_empty,
+                              [](std::size_t) { return false; })] = i;
     }
     return result;
-  }
+  }();
 
-  bool is_kebab_case(const std::string &next, const std::string &field_name) {
-    bool result = false;
-    auto maybe_kebab_case = next;
-    if (maybe_kebab_case.size() > 1 && maybe_kebab_case[0] == '-') {
-      // remove first dash
-      maybe_kebab_case.erase(0, 1);
-      if (maybe_kebab_case[0] == '-') {
-        // there is a second leading dash
-        // remove it
-        maybe_kebab_case.erase(0, 1);
+  // The names, separated by ", ", e.g., "red, blue, green"
+  static constexpr std::size_t allowed_names_size = [] {
+    std::size_t result = 0;
+    for (auto name : magic_enum::enum_names<T>()) {
+      result += name.size() + 2;
+    }
+    return result < 2 ? 0 : result - 2; // an enum can have no enumerators
+  }();
+
+  static constexpr std::array<char, allowed_names_size> allowed_names_buffer = [] {
+    std::array<char, allowed_names_size> result{};
+    std::size_t k = 0;
+    for (auto name : magic_enum::enum_names<T>()) {
+      if (k > 0) {
+        result[k++] = ',';
+        result[k++] = ' ';
       }
-      std::replace(maybe_kebab_case.begin(), maybe_kebab_case.end(), '-', '_');
-      if (maybe_kebab_case == field_name) {
-        result = true;
+      for (auto c : name) {
+        result[k++] = c;
       }
     }
     return result;
-  }
+  }();
 
-  bool is_optional_field(const std::string &next, const std::string &field_name) {
-    bool result = false;
-    if (next == "-" + field_name || next == "--" + field_name ||
-        next == "-" + std::string(1, field_name[0]) || is_kebab_case(next, field_name)) {
-      // okay `next` matches _a_ field name (which is an optional field)
-      result = true;
-    }
-    return result;
+  static constexpr std::string_view allowed_names() {
+    return {allowed_names_buffer.data(), allowed_names_buffer.size()};
   }
 
-  bool is_optional_field(const std::string &next) {
-    if (!is_optional(next)) {
-      return false;
-    }
-
-    bool result = false;
-    for (auto &field_name : visitor.field_names) {
-      result = is_optional_field(next, field_name);
-      if (result) {
-        break;
-      }
+  static std::optional<T> find(std::string_view name) {
+    constexpr auto names = magic_enum::enum_names<T>();
+    const auto matches = [&names, name](std::size_t i) {
+      return is_enum_name_equal(names[i], name, ignore_case);
+    };
+    const auto hash = enum_name_hash(name, ignore_case);
+    const auto slot = slots[hash_table_probe(slots, hash, is_empty, matches)];
+    if (is_empty(slot)) {
+      return std::nullopt;
     }
-    return result;
+    return magic_enum::enum_value<T>(slot);
   }
+};
 
-  // checks if the next argument is a delimited optional field
-  // e.g., -std=c++17, where std matches a field name
-  // and it is delimited by one of the two allowed delimiters: `=` and `:`
-  //
-  // if true, the return value includes the delimiter that was used
-  std::pair<bool, char> is_delimited_optional_argument(const std::string &next) {
-    bool success = false;
-    char delimiter = '\0';
+} // namespace details
+
+} // namespace structopt
+#pragma once
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <string_view>
+// #include <structopt/hash_table.hpp>
+#include <vector>
+
+namespace structopt {
+
+namespace details {
+
+// `-` and `_` are interchangeable in option names, e.g., `--bind-address`
+// and `--bind_address` both name the field `bind_address`
+static inline char normalize_option_char(char c) { return c == '-' ? '_' : c; }
+
+static inline bool is_kebab_case_equal(std::string_view lhs, std::string_view rhs) {
+  if (lhs.size() != rhs.size()) {
+    return false;
+  }
+  for (std::size_t i = 0; i < lhs.size(); i++) {
+    if (normalize_option_char(lhs[i]) != normalize_option_char(rhs[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Strip up to two leading dashes from an optional argument
+// e.g., --verbose => verbose
+// e.g., -log-level => log-level
+static inline std::string_view strip_option_dashes(std::string_view next) {
+  if (next.size() > 1 && next[0] == '-') {
+    next.remove_prefix(1);
+    if (next[0] == '-') {
+      next.remove_prefix(1);
+    }
+  }
+  return next;
+}
+
+// The short option for a letter, e.g., 'v' => -v
+// The views point into a static table, so no string is ever allocated
+static inline std::string_view short_option(char c) {
+  static const auto options = [] {
+    std::array<char, 512> result{};
+    for (std::size_t i = 0; i < 256; i++) {
+      result[2 * i] = '-';
+      result[2 * i + 1] = static_cast<char>(i);
+    }
+    return result;
+  }();
+  return {options.data() + 2 * static_cast<unsigned char>(c), 2};
+}
+
+// Maps every spelling of an option (long name, kebab-case alias and short
+// letter) to the position of the field in the list it was built from.
+//
+// The index is built once per parser. Lookups never allocate: names are
+// stored back to back in a single buffer and probed with an open addressing
+// table that treats `-` and `_` as the same character.
+class option_index {
+  struct slot {
+    std::uint32_t offset{0};
+    std::uint32_t length{0};
+    std::size_t field{npos};
+  };
+
+  std::string names_;
+  std::vector<slot> slots_;
+  std::array<std::size_t, 256> short_names_;
+
+  static std::size_t hash(std::string_view name) {
+    return fnv1a().add(name, normalize_option_char).value();
+  }
+
+  static bool is_empty(const slot &s) { return s.field == npos; }
+
+public:
+  static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+  option_index() { short_names_.fill(npos); }
+
+  template <typename Container> explicit option_index(const Container &field_names) {
+    short_names_.fill(npos);
+
+    slots_.resize(hash_table_capacity(field_names.size()));
+
+    std::size_t field = 0;
+    for (auto &field_name : field_names) {
+      if (field_name.empty()) {
+        // placeholder, e.g., for a field that cannot be named on the command line
+        field += 1;
+        continue;
+      }
+
+      const auto offset = names_.size();
+      names_ += field_name;
+
+      // the first field with a given initial owns the short form
+      auto &short_name = short_names_[static_cast<unsigned char>(field_name[0])];
+      if (short_name == npos) {
+        short_name = field;
+      }
+
+      // a duplicate name keeps the first field
+      const auto i = hash_table_probe(slots_, hash(field_name), is_empty,
+                                      [this, &field_name](const slot &s) {
+                                        return name_of(s) == field_name;
+                                      });
+      if (is_empty(slots_[i])) {
+        slots_[i] = {static_cast<std::uint32_t>(offset),
+                     static_cast<std::uint32_t>(field_name.size()), field};
+      }
+      field += 1;
+    }
+  }
+
+  // Look up a name without leading dashes, e.g., `bind-address`
+  std::size_t find_long(std::string_view name) const {
+    if (slots_.empty()) {
+      return npos;
+    }
+    const auto i = hash_table_probe(slots_, hash(name), is_empty,
+                                    [this, name](const slot &other) {
+                                      return is_kebab_case_equal(name_of(other), name);
+                                    });
+    return slots_[i].field;
+  }
+
+  // Look up the short form of an option, e.g., `v` for `-v`
+  std::size_t find_short(char c) const {
+    return short_names_[static_cast<unsigned char>(c)];
+  }
+
+  // Look up a command-line token that looks like an option
+  // e.g., `-v`, `--verbose`, `-log-level`
+  std::size_t find(std::string_view next) const {
+    if (next.size() < 2 || next[0] != '-') {
+      return npos;
+    }
+    if (next.size() == 2) {
+      const auto result = find_short(next[1]);
+      if (result != npos) {
+        return result;
+      }
+    }
+    return find_long(strip_option_dashes(next));
+  }
+
+private:
+  std::string_view name_of(const slot &s) const {
+    return std::string_view(names_).substr(s.offset, s.length);
+  }
+};
+
+} // namespace details
+
+} // namespace structopt
+#pragma once
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <new>
+#include <optional>
+// #include <structopt/is_specialization.hpp>
+// #include <structopt/third_party/visit_struct/visit_struct.hpp>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined(__has_include)
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+#define STRUCTOPT_HAS_MEMORY_RESOURCE
+#endif
+#endif
+
+namespace structopt {
+
+namespace details {
+
+#ifdef STRUCTOPT_HAS_MEMORY_RESOURCE
+
+using memory_resource = std::pmr::memory_resource;
+
+// The lists a parse works with, e.g., the arguments and their tokens, take
+// their memory from the resource passed to app::memory_resource
+template <typename T> using scratch_vector = std::pmr::vector<T>;
+template <typename T> using scratch_deque = std::pmr::deque<T>;
+
+inline memory_resource *default_memory_resource() {
+  return std::pmr::get_default_resource();
+}
+
+// Types that take their memory from a memory resource, e.g.,
+// std::pmr::vector<int> or std::pmr::string, but not std::tuple, which only
+// passes an allocator on to its elements
+template <typename T>
+struct uses_memory_resource
+    : std::conjunction<
+          std::uses_allocator<T, std::pmr::polymorphic_allocator<std::byte>>,
+          std::is_constructible<T, std::pmr::polymorphic_allocator<std::byte>>> {};
+
+// An empty `T`, which takes its memory from `resource` if it can
+template <typename T> T make_value(memory_resource *resource) {
+  if constexpr (uses_memory_resource<T>::value) {
+    // converts to the allocator of any std::pmr container or adapter
+    return T(std::pmr::polymorphic_allocator<std::byte>(resource));
+  } else {
+    return T();
+  }
+}
+
+#else
+
+// <memory_resource> is missing, e.g., from older versions of libc++; every
+// parse then uses the global allocator
+struct memory_resource;
+
+template <typename T> using scratch_vector = std::vector<T>;
+template <typename T> using scratch_deque = std::deque<T>;
+
+inline memory_resource *default_memory_resource() { return nullptr; }
+
+template <typename T> struct uses_memory_resource : std::false_type {};
+
+template <typename T> T make_value(memory_resource *) { return T(); }
+
+#endif
+
+template <typename T> constexpr bool has_memory_resource();
+
+template <typename T, std::size_t... I>
+constexpr bool has_memory_resource_field(std::index_sequence<I...>) {
+  return (has_memory_resource<visit_struct::type_at<I, T>>() || ...);
+}
+
+// Whether `T` takes its memory from a memory resource, or holds something
+// that does, e.g., a nested struct with a std::pmr::vector field
+template <typename T> constexpr bool has_memory_resource() {
+  if constexpr (uses_memory_resource<T>::value) {
+    return true;
+  } else if constexpr (structopt::is_specialization<T, std::optional>::value) {
+    return has_memory_resource<typename T::value_type>();
+  } else if constexpr (visit_struct::traits::is_visitable<T>::value) {
+    return has_memory_resource_field<T>(
+        std::make_index_sequence<visit_struct::field_count<T>()>{});
+  } else {
+    return false;
+  }
+}
+
+// Destroys `field` and constructs it anew from `value`
+//
+// Unlike an assignment, this keeps the memory resource of `value`, e.g., of
+// a std::pmr::vector, or of the std::pmr containers of a nested struct.
+// The move constructor of `T` must not throw, or `field` would be left
+// destroyed.
+template <typename T> void replace_field(T &field, T &&value) {
+  static_assert(std::is_nothrow_move_constructible<T>::value);
+  field.~T();
+  ::new (static_cast<void *>(std::addressof(field))) T(std::move(value));
+}
+
+// Moves `value` into `field`, keeping the memory resource of `value`
+//
+// Types whose move constructor can throw, e.g., std::pmr::deque with
+// libstdc++, are assigned, and their values move into the memory of
+// `field`.
+template <typename T> void assign_field(T &field, T &&value) {
+  if constexpr (structopt::is_specialization<T, std::optional>::value) {
+    if constexpr (has_memory_resource<typename T::value_type>()) {
+      // an empty optional takes the value as it is
+      field.reset();
+    }
+    field = std::move(value);
+  } else if constexpr (has_memory_resource<T>() &&
+                       std::is_nothrow_move_constructible<T>::value) {
+    replace_field(field, std::move(value));
+  } else {
+    field = std::move(value);
+  }
+}
+
+} // namespace details
+
+} // namespace structopt
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <optional>
+#include <string>
+#include <string_view>
+// #include <structopt/hash_table.hpp>
+#include <vector>
+
+#if defined(_WIN32)
+#include <stdlib.h> // _environ
+#elif defined(__APPLE__)
+#include <crt_externs.h> // _NSGetEnviron
+#else
+extern "C" {
+extern char **environ; // not declared by every <unistd.h>
+}
+#endif
+
+namespace structopt {
+
+namespace details {
+
+// The variables of the environment of this process, as NAME=value strings
+inline char **environment_variables() {
+#if defined(_WIN32)
+  return _environ;
+#elif defined(__APPLE__)
+  return *_NSGetEnviron();
+#else
+  return environ;
+#endif
+}
+
+// Names of environment variables are upper case, with `_` for `-` and `.`,
+// e.g., the field log-level falls back to LOG_LEVEL
+constexpr char to_environment_char(char c) {
+  if (c == '-' || c == '.') {
+    return '_';
+  }
+  return (c >= 'a' && c <= 'z') ? static_cast<char>(c - 'a' + 'A') : c;
+}
+
+// The environment variables whose names start with a prefix, e.g., APP_,
+// indexed by the rest of their names, e.g., LOG_LEVEL
+//
+// The environment is scanned once, when the index is built; later changes
+// to it are not seen. Names and values are copied back to back into a
+// single buffer and probed with an open addressing table, so a lookup costs
+// the same no matter how many variables there are.
+class environment_index {
+  struct slot {
+    std::uint32_t offset{0}; // of the name in `text_`; the value follows it
+    std::uint32_t name_length{0};
+    std::uint32_t value_length{0};
+    bool is_used{false};
+  };
+
+  std::string prefix_;
+  std::string text_;
+  std::vector<slot> slots_;
+
+  // The hash of the name of the variable for `scope` and `field` together
+  static std::size_t hash(std::string_view scope, std::string_view field) {
+    fnv1a result;
+    result.add(scope, to_environment_char).add(field, to_environment_char);
+    return result.value();
+  }
+
+  static bool is_empty(const slot &s) { return !s.is_used; }
+
+  static bool is_name_equal(std::string_view name, std::string_view scope,
+                            std::string_view field) {
+    if (name.size() != scope.size() + field.size()) {
+      return false;
+    }
+    for (std::size_t i = 0; i < scope.size(); i++) {
+      if (name[i] != to_environment_char(scope[i])) {
+        return false;
+      }
+    }
+    for (std::size_t i = 0; i < field.size(); i++) {
+      if (name[scope.size() + i] != to_environment_char(field[i])) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+public:
+  // `prefix` is the name of the program, e.g., APP, and is followed by `_`
+  // in the names of its variables. Without a prefix, every variable is
+  // indexed.
+  explicit environment_index(std::string_view prefix,
+                             char **variables = environment_variables()) {
+    for (auto c : prefix) {
+      prefix_ += to_environment_char(c);
+    }
+    if (!prefix_.empty() && prefix_.back() != '_') {
+      prefix_ += '_';
+    }
+
+    std::vector<std::string_view> names, values;
+    for (auto variable = variables; variable && *variable; ++variable) {
+      const std::string_view entry(*variable);
+      const auto delimiter = entry.find('=');
+      if (delimiter == std::string_view::npos ||
+          entry.substr(0, delimiter).substr(0, prefix_.size()) != prefix_ ||
+          delimiter == prefix_.size()) {
+        continue;
+      }
+      names.push_back(entry.substr(prefix_.size(), delimiter - prefix_.size()));
+      values.push_back(entry.substr(delimiter + 1));
+    }
+
+    slots_.resize(hash_table_capacity(names.size()));
+
+    for (std::size_t k = 0; k < names.size(); k++) {
+      // a duplicate name keeps the first variable, like getenv
+      const auto i = hash_table_probe(slots_, hash(names[k], {}), is_empty,
+                                      [this, &names, k](const slot &s) {
+                                        return name(s) == names[k];
+                                      });
+      if (is_empty(slots_[i])) {
+        slots_[i] = {static_cast<std::uint32_t>(text_.size()),
+                     static_cast<std::uint32_t>(names[k].size()),
+                     static_cast<std::uint32_t>(values[k].size()), true};
+        text_ += names[k];
+        text_ += values[k];
+      }
+    }
+  }
+
+  // The name of the variable for a field, e.g., APP_BUILD_LOG_LEVEL for
+  // the field log-level of the sub-command build, whose scope is `build.`
+  std::string name(std::string_view scope, std::string_view field) const {
+    auto result = prefix_;
+    for (auto part : {scope, field}) {
+      for (auto c : part) {
+        result += to_environment_char(c);
+      }
+    }
+    return result;
+  }
+
+  // The value of the variable for a field, or std::nullopt if it is not set
+  std::optional<std::string_view> find(std::string_view scope,
+                                       std::string_view field) const {
+    const auto i = hash_table_probe(slots_, hash(scope, field), is_empty,
+                                    [this, scope, field](const slot &s) {
+                                      return is_name_equal(name(s), scope, field);
+                                    });
+    const auto &s = slots_[i];
+    if (is_empty(s)) {
+      return std::nullopt;
+    }
+    return std::string_view(text_).substr(s.offset + s.name_length, s.value_length);
+  }
+
+private:
+  std::string_view name(const slot &s) const {
+    return std::string_view(text_).substr(s.offset, s.name_length);
+  }
+};
+
+} // namespace details
+
+} // namespace structopt
+#pragma once
+#include <cstddef>
+#include <deque>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <string_view>
+// #include <structopt/memory_resource.hpp>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define STRUCTOPT_HAS_MMAP
+#endif
+
+namespace structopt {
+
+namespace details {
+
+// The contents of a response file, memory-mapped where the platform allows
+// it, read into a buffer otherwise
+class mapped_file {
+  const char *data_{nullptr};
+  std::size_t size_{0};
+  bool is_mapped_{false};
+  std::vector<char> buffer_; // when the file could not be mapped
+
+public:
+  mapped_file() = default;
+
+  mapped_file(const mapped_file &) = delete;
+  mapped_file &operator=(const mapped_file &) = delete;
+
+  mapped_file(mapped_file &&other) noexcept
+      : data_(other.data_), size_(other.size_), is_mapped_(other.is_mapped_),
+        buffer_(std::move(other.buffer_)) {
+    other.data_ = nullptr;
+    other.size_ = 0;
+    other.is_mapped_ = false;
+  }
+
+  mapped_file &operator=(mapped_file &&other) noexcept {
+    if (this != &other) {
+      unmap();
+      data_ = other.data_;
+      size_ = other.size_;
+      is_mapped_ = other.is_mapped_;
+      buffer_ = std::move(other.buffer_);
+      other.data_ = nullptr;
+      other.size_ = 0;
+      other.is_mapped_ = false;
+    }
+    return *this;
+  }
+
+  ~mapped_file() { unmap(); }
+
+  // Returns std::nullopt if the file cannot be opened
+  static std::optional<mapped_file> open(const std::string &path) {
+    mapped_file result;
+#ifdef STRUCTOPT_HAS_MMAP
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      return std::nullopt;
+    }
+    struct stat status {};
+    if (::fstat(fd, &status) != 0 || !S_ISREG(status.st_mode)) {
+      ::close(fd);
+      return std::nullopt;
+    }
+    result.size_ = static_cast<std::size_t>(status.st_size);
+    if (result.size_ > 0) {
+      void *data = ::mmap(nullptr, result.size_, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (data != MAP_FAILED) {
+        // the tokenizer reads the file once, front to back
+        ::madvise(data, result.size_, MADV_SEQUENTIAL);
+        result.data_ = static_cast<const char *>(data);
+        result.is_mapped_ = true;
+      }
+    }
+    ::close(fd);
+    if (result.size_ == 0 || result.is_mapped_) {
+      return result;
+    }
+#endif
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+      return std::nullopt;
+    }
+    result.buffer_.assign(std::istreambuf_iterator<char>(file),
+                          std::istreambuf_iterator<char>());
+    result.data_ = result.buffer_.data();
+    result.size_ = result.buffer_.size();
+    return result;
+  }
+
+  std::string_view contents() const { return {data_, size_}; }
+
+private:
+  void unmap() {
+#ifdef STRUCTOPT_HAS_MMAP
+    if (is_mapped_) {
+      ::munmap(const_cast<char *>(data_), size_);
+    }
+#endif
+    is_mapped_ = false;
+  }
+};
+
+// Splits the contents of a response file into arguments, one at a time
+//
+// A file that ends with a NUL byte, e.g., the output of `find -print0`, is
+// split at every NUL byte and nothing is unquoted. Any other file is split
+// at whitespace, like a shell would:
+// * 'single quotes' keep everything up to the next single quote
+// * "double quotes" keep everything up to the next double quote, where a
+//   backslash keeps a double quote or a backslash after it
+// * outside of quotes, a backslash keeps the character after it
+//
+// An argument that is written without quotes or backslashes is a view into
+// the file. Only an argument that has to be unquoted is copied, into
+// `unquoted`.
+class response_file_tokenizer {
+  std::string_view input;
+  std::size_t position{0};
+  bool is_nul_separated{false};
+
+  static bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+  }
+
+public:
+  explicit response_file_tokenizer(std::string_view input)
+      : input(input), is_nul_separated(!input.empty() && input.back() == '\0') {}
+
+  std::optional<std::string_view> next(scratch_deque<std::string> &unquoted) {
+    if (is_nul_separated) {
+      if (position == input.size()) {
+        return std::nullopt;
+      }
+      const auto end = input.find('\0', position);
+      const auto result = input.substr(position, end - position);
+      position = end + 1;
+      return result;
+    }
+
+    while (position < input.size() && is_space(input[position])) {
+      position += 1;
+    }
+    if (position == input.size()) {
+      return std::nullopt;
+    }
+
+    // Fast path: the argument is a view into the file
+    const auto start = position;
+    while (position < input.size() && !is_space(input[position])) {
+      const char c = input[position];
+      if (c == '\'' || c == '"' || c == '\\') {
+        break;
+      }
+      position += 1;
+    }
+    if (position == input.size() || is_space(input[position])) {
+      return input.substr(start, position - start);
+    }
+
+    // The argument is quoted or escaped; unquote it into its own string
+    auto &result = unquoted.emplace_back(input.substr(start, position - start));
+    char quote = '\0';
+    for (; position < input.size(); position++) {
+      const char c = input[position];
+      if (quote == '\'') {
+        if (c == '\'') {
+          quote = '\0';
+        } else {
+          result += c;
+        }
+      } else if (quote == '"') {
+        if (c == '"') {
+          quote = '\0';
+        } else if (c == '\\' && position + 1 < input.size() &&
+                   (input[position + 1] == '"' || input[position + 1] == '\\')) {
+          result += input[++position];
+        } else {
+          result += c;
+        }
+      } else if (c == '\'' || c == '"') {
+        quote = c;
+      } else if (c == '\\') {
+        if (position + 1 < input.size()) {
+          result += input[++position];
+        }
+      } else if (is_space(c)) {
+        break;
+      } else {
+        result += c;
+      }
+    }
+    // an unterminated quote ends with the file
+    return std::string_view(result);
+  }
+};
+
+} // namespace details
+
+} // namespace structopt
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+// #include <structopt/hash_table.hpp>
+// #include <structopt/option_index.hpp>
+// #include <structopt/response_file.hpp>
+#include <utility>
+#include <vector>
+
+namespace structopt {
+
+namespace details {
+
+// The options in a configuration file, indexed by section and name
+//
+// The file is an INI file, or a list of key=value lines:
+//
+//   # a comment; so is a line that starts with ;
+//   log-level = debug
+//   verbose
+//   [build]
+//   target = "release"
+//
+// A key names an optional or flag field; `-` and `_` are interchangeable,
+// as they are on the command line. A key without a value is `true`, and a
+// value in quotes is taken without them. The keys in a section name the
+// fields of the sub-command with that name, e.g., [build.test] for the
+// sub-command test of the sub-command build.
+//
+// Keys and values are views into the memory-mapped file; nothing is copied.
+// A key that is set more than once keeps its last value.
+class config_file {
+public:
+  struct entry {
+    std::string_view section;
+    std::string_view key;
+    std::string_view value;
+    std::size_t line{0};
+  };
+
+private:
+  std::string path_;
+  mapped_file file_;
+  std::vector<entry> entries_;
+  std::vector<std::uint32_t> slots_; // 1 + the position in `entries_`; 0 is empty
+
+  static bool is_blank(char c) { return c == ' ' || c == '\t' || c == '\r'; }
+
+  static std::string_view trim(std::string_view text) {
+    while (!text.empty() && is_blank(text.front())) {
+      text.remove_prefix(1);
+    }
+    while (!text.empty() && is_blank(text.back())) {
+      text.remove_suffix(1);
+    }
+    return text;
+  }
+
+  // The hash of `scope` and `name`, where `scope` is empty or a section
+  // followed by `.`, e.g., `build.`
+  static std::size_t hash(std::string_view section, bool has_dot, std::string_view name) {
+    fnv1a result;
+    result.add(section, normalize_option_char);
+    if (has_dot) {
+      result.add('.');
+    }
+    return result.add(name, normalize_option_char).value();
+  }
+
+  static bool is_empty(std::uint32_t slot) { return slot == 0; }
+
+  static bool is_scope_equal(std::string_view section, std::string_view scope) {
+    if (section.empty() || scope.empty()) {
+      return section.empty() && scope.empty();
+    }
+    return scope.back() == '.' &&
+           is_kebab_case_equal(section, scope.substr(0, scope.size() - 1));
+  }
+
+  void index(std::string_view contents) {
+    // at most one entry per line
+    const auto lines = std::count(contents.begin(), contents.end(), '\n');
+    entries_.reserve(static_cast<std::size_t>(lines) + 1);
+
+    std::string_view section;
+    std::size_t line = 0;
+    while (!contents.empty()) {
+      line += 1;
+      const auto end = contents.find('\n');
+      auto text = trim(contents.substr(0, end));
+      contents.remove_prefix(end == std::string_view::npos ? contents.size() : end + 1);
+
+      if (text.empty() || text[0] == '#' || text[0] == ';') {
+        continue;
+      } else if (text[0] == '[') {
+        const auto close = text.find(']');
+        section = trim(text.substr(1, close == std::string_view::npos ? text.npos
+                                                                       : close - 1));
+        continue;
+      }
+
+      const auto delimiter = text.find('=');
+      const auto key = trim(text.substr(0, delimiter));
+      auto value = delimiter == std::string_view::npos
+                       ? std::string_view("true")
+                       : trim(text.substr(delimiter + 1));
+      if (value.size() >= 2 && (value[0] == '"' || value[0] == '\'') &&
+          value.back() == value[0]) {
+        value = value.substr(1, value.size() - 2);
+      }
+      if (!key.empty()) {
+        entries_.push_back({section, key, value, line});
+      }
+    }
+
+    slots_.assign(hash_table_capacity(entries_.size()), 0);
+    for (std::size_t k = 0; k < entries_.size(); k++) {
+      const auto &e = entries_[k];
+      // the later value replaces the earlier one
+      const auto is_same_key = [this, &e](std::uint32_t slot) {
+        const auto &other = entries_[slot - 1];
+        return is_kebab_case_equal(other.section, e.section) &&
+               is_kebab_case_equal(other.key, e.key);
+      };
+      const auto i = hash_table_probe(slots_, hash(e.section, !e.section.empty(), e.key),
+                                      is_empty, is_same_key);
+      slots_[i] = static_cast<std::uint32_t>(k + 1);
+    }
+  }
+
+public:
+  // Indexes `contents`, which has to outlive the index
+  explicit config_file(std::string_view contents, std::string path = "")
+      : path_(std::move(path)) {
+    index(contents);
+  }
+
+  config_file(const config_file &) = delete;
+  config_file &operator=(const config_file &) = delete;
+
+  // Returns std::nullopt if the file cannot be opened
+  static std::optional<config_file> open(const std::string &path) {
+    auto file = mapped_file::open(path);
+    if (!file) {
+      return std::nullopt;
+    }
+    std::optional<config_file> result(std::in_place, std::string_view{}, path);
+    // the views stay valid when the file is moved; the mapping does not move
+    result->file_ = std::move(*file);
+    result->index(result->file_.contents());
+    return result;
+  }
+
+  config_file(config_file &&) = default;
+  config_file &operator=(config_file &&) = default;
+
+  const std::string &path() const { return path_; }
+
+  // The entry for a field, e.g., `target` in the scope `build.`, or nullptr
+  const entry *find(std::string_view scope, std::string_view field) const {
+    const auto has_dot = !scope.empty();
+    const auto section = has_dot ? scope.substr(0, scope.size() - 1) : scope;
+    const auto i = hash_table_probe(slots_, hash(section, has_dot, field), is_empty,
+                                    [this, scope, field](std::uint32_t slot) {
+                                      const auto &e = entries_[slot - 1];
+                                      return is_kebab_case_equal(e.key, field) &&
+                                             is_scope_equal(e.section, scope);
+                                    });
+    return is_empty(slots_[i]) ? nullptr : &entries_[slots_[i] - 1];
+  }
+};
+
+} // namespace details
+
+} // namespace structopt
+#pragma once
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <string>
+#include <string_view>
+// #include <structopt/memory_resource.hpp>
+// #include <structopt/response_file.hpp>
+#include <utility>
+#include <vector>
+
+namespace structopt {
+
+namespace details {
+
+enum class token_kind : std::uint8_t {
+  value,            // e.g., `foo.csv`, `-5`, or anything after `--`
+  double_dash,      // the first `--`, i.e., the end of optional arguments
+  option,           // e.g., `-v`, `--verbose`, `-log-level`
+  delimited_option, // e.g., `-std=c++17`, `--output:main`
+  combined_flags,   // e.g., `-abc`, where each letter is the short form of a field
+  unknown_option    // looks like an option but does not name any field
+};
+
+// A command-line argument, classified once by the parser
+struct token {
+  static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+  token_kind kind{token_kind::value};
+
+  // `option` and `delimited_option`: position of the field named by the
+  // argument (or by the part before the delimiter), see parser::classify
+  std::size_t field{npos};
+
+  // `delimited_option`: position of the delimiter, `=` or `:`, in the
+  // argument. The value starts right after it.
+  std::size_t delimiter{0};
+};
+
+// The command-line arguments of a parse, shared by the parser and the
+// parsers of its sub-commands, which continue at their own position in
+// the same list rather than on a copy of the remaining arguments
+//
+// Arguments are addressed by their position on the command line. A list
+// read from a `source` holds only the arguments that were read and not yet
+// released, starting at `offset`, see release.
+struct argument_list {
+  // views over argv, or over the strings passed to app::parse
+  // The parser replaces an argument in place with the part it still has to
+  // parse, e.g., `bar` for `--foo=bar`, so the list is never shifted
+  scratch_vector<std::string_view> arguments;
+
+  // tokens[i] classifies arguments[i], see parser::token_at
+  scratch_vector<token> tokens;
+
+  // position of arguments[0] on the command line
+  std::size_t offset{0};
+
+  // reads the next argument into its parameter, returns false at the end
+  // The arguments are read on demand, as the parser gets to them.
+  std::function<bool(std::string &)> source;
+
+  // the arguments read from `source`, which `arguments` point into
+  scratch_deque<std::string> streamed;
+
+  // response files that arguments point into, and the arguments of those
+  // files that had to be unquoted, see expand_response_files
+  std::vector<mapped_file> files;
+  scratch_deque<std::string> unquoted;
+
+  // where the lists above take their memory from
+  memory_resource *resource;
+
+  explicit argument_list(memory_resource *resource = default_memory_resource())
+      : arguments(make_value<scratch_vector<std::string_view>>(resource)),
+        tokens(make_value<scratch_vector<token>>(resource)),
+        streamed(make_value<scratch_deque<std::string>>(resource)),
+        unquoted(make_value<scratch_deque<std::string>>(resource)), resource(resource) {}
+
+  template <typename Iterator>
+  argument_list(Iterator first, Iterator last,
+                memory_resource *resource = default_memory_resource())
+      : argument_list(resource) {
+    assign(first, last);
+  }
+
+  // Starts over with the arguments in [first, last), keeping the memory of
+  // `arguments` and `tokens` for them
+  template <typename Iterator> void assign(Iterator first, Iterator last) {
+    clear();
+    arguments.reserve(static_cast<std::size_t>(std::distance(first, last)));
+    for (; first != last; ++first) {
+      arguments.emplace_back(*first);
+    }
+  }
+
+  void clear() {
+    arguments.clear();
+    tokens.clear();
+    offset = 0;
+    source = nullptr;
+    streamed.clear();
+    files.clear();
+    unquoted.clear();
+  }
+
+  bool is_streamed() const { return static_cast<bool>(source) || !streamed.empty(); }
+
+  // checks if there is an argument at `index`, reading from `source` up to it
+  bool has(std::size_t index) {
+    while (index - offset >= arguments.size()) {
+      if (!source) {
+        return false;
+      }
+      auto &next = streamed.emplace_back();
+      if (!source(next)) {
+        streamed.pop_back();
+        source = nullptr;
+        return false;
+      }
+      arguments.emplace_back(next);
+    }
+    return true;
+  }
+
+  std::string_view operator[](std::size_t index) const {
+    return arguments[index - offset];
+  }
+
+  // Replaces the argument at `index`, e.g., with its value, which is then
+  // classified anew
+  void replace(std::size_t index, std::string_view argument) {
+    arguments[index - offset] = argument;
+    reclassify(index);
+  }
+
+  // Forgets the tokens from `index` on, so that the arguments are classified
+  // again the next time they are asked for
+  void reclassify(std::size_t index) {
+    if (tokens.size() > index - offset) {
+      tokens.resize(index - offset);
+    }
+  }
+
+  // Releases the arguments before `index`, which the parser is done with
+  //
+  // A list read from `source` drops them once they make up half of it, so
+  // that a long run of values, e.g., the elements of a std::vector field,
+  // takes no more memory than the field it is parsed into. Other lists keep
+  // their arguments.
+  void release(std::size_t index) {
+    if (streamed.empty()) {
+      return;
+    }
+    const auto count = index - offset;
+    if (count < 1024 || count * 2 < arguments.size()) {
+      return;
+    }
+    arguments.erase(arguments.begin(), arguments.begin() + count);
+    tokens.erase(tokens.begin(), tokens.begin() + std::min(count, tokens.size()));
+    streamed.erase(streamed.begin(), streamed.begin() + count);
+    offset = index;
+  }
+
+  // Replaces every `@path` argument with the arguments in the file at `path`
+  //
+  // The program name and the arguments after `--` are left as they are, and
+  // so is `@path` if there is no file to read at `path`. Arguments in a
+  // response file, or read from a `source`, are not expanded.
+  void expand_response_files() {
+    std::size_t first = 1;
+    while (first < arguments.size() && !is_response_file(arguments[first])) {
+      if (arguments[first] == "--") {
+        return;
+      }
+      first += 1;
+    }
+    if (first >= arguments.size()) {
+      return;
+    }
+
+    auto expanded = make_value<scratch_vector<std::string_view>>(resource);
+    expanded.assign(arguments.begin(), arguments.begin() + first);
+    bool is_after_double_dash = false;
+    for (auto i = first; i < arguments.size(); i++) {
+      const auto argument = arguments[i];
+      is_after_double_dash = is_after_double_dash || argument == "--";
+      if (is_after_double_dash || !is_response_file(argument)) {
+        expanded.push_back(argument);
+        continue;
+      }
+
+      auto file = mapped_file::open(std::string(argument.substr(1)));
+      if (!file) {
+        expanded.push_back(argument);
+        continue;
+      }
+      // the views stay valid when `files` grows; the mapping does not move
+      response_file_tokenizer tokenizer(file->contents());
+      files.push_back(std::move(*file));
+      while (auto next = tokenizer.next(unquoted)) {
+        expanded.push_back(*next);
+      }
+    }
+    arguments = std::move(expanded);
+  }
+
+private:
+  static bool is_response_file(std::string_view argument) {
+    return argument.size() > 1 && argument[0] == '@';
+  }
+};
+
+} // namespace details
+
+} // namespace structopt
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <optional>
+#include <queue>
+#include <set>
+#include <stack>
+#include <string_view>
+// #include <structopt/is_specialization.hpp>
+// #include <structopt/option_index.hpp>
+// #include <structopt/third_party/visit_struct/visit_struct.hpp>
+#include <type_traits>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace structopt {
+
+namespace details {
+
+enum class field_kind : std::uint8_t { positional, optional, flag, nested_struct };
+
+// A field of a STRUCTOPT struct, as seen from the command line
+struct field_schema {
+  const char *name;
+  field_kind kind;
+  bool is_container; // a positional container can be happy without any arguments
+};
+
+// std::optional<bool> is a flag, any other std::optional is an option,
+// a nested struct is a sub-command, and everything else is positional
+template <typename T> constexpr field_kind kind_of() {
+  if constexpr (structopt::is_specialization<T, std::optional>::value) {
+    return std::is_same<typename T::value_type, bool>::value ? field_kind::flag
+                                                              : field_kind::optional;
+  } else if constexpr (visit_struct::traits::is_visitable<T>::value) {
+    return field_kind::nested_struct;
+  } else {
+    return field_kind::positional;
+  }
+}
+
+template <typename T> constexpr bool is_container_field() {
+  return structopt::is_specialization<T, std::deque>::value ||
+         structopt::is_specialization<T, std::list>::value ||
+         structopt::is_specialization<T, std::vector>::value ||
+         structopt::is_specialization<T, std::set>::value ||
+         structopt::is_specialization<T, std::multiset>::value ||
+         structopt::is_specialization<T, std::unordered_set>::value ||
+         structopt::is_specialization<T, std::unordered_multiset>::value ||
+         structopt::is_specialization<T, std::queue>::value ||
+         structopt::is_specialization<T, std::stack>::value ||
+         structopt::is_specialization<T, std::priority_queue>::value;
+}
+
+// Writes the help for `fields` that follows `USAGE: <name> `, or only
+// counts its characters if `out` is nullptr
+//
+// Field names are known at compile time, and so is the help; see help_of.
+template <std::size_t N>
+constexpr std::size_t render_help(const std::array<field_schema, N> &fields, char *out) {
+  std::size_t size = 0;
+  const auto put = [&size, out](char c) {
+    if (out) {
+      out[size] = c;
+    }
+    size += 1;
+  };
+  const auto write = [&put](const char *text) {
+    for (; *text; ++text) {
+      put(*text);
+    }
+  };
+  // e.g., `    -l, --log-level <log_level>`; the first `_` is shown as `-`
+  const auto write_option = [&put, &write](const char *name) {
+    write("    -");
+    put(name[0]);
+    write(", --");
+    bool is_kebab = false;
+    for (auto c = name; *c; ++c) {
+      put(*c == '_' && !is_kebab ? '-' : *c);
+      is_kebab = is_kebab || *c == '_';
+    }
+    write(" <");
+    write(name);
+    write(">\n");
+  };
+  const auto has = [&fields](field_kind kind) {
+    for (const auto &field : fields) {
+      if (field.kind == kind) {
+        return true;
+      }
+    }
+    return false;
+  };
+
+  const bool has_flags = has(field_kind::flag);
+  const bool has_sub_commands = has(field_kind::nested_struct);
+  const bool has_positional = has(field_kind::positional);
+
+  if (has_flags) {
+    write("[FLAGS] ");
+  }
+  write("[OPTIONS] ");
+  if (has_sub_commands) {
+    write("[SUBCOMMANDS] ");
+  }
+  for (const auto &field : fields) {
+    if (field.kind == field_kind::positional) {
+      write(field.name);
+      put(' ');
+    }
+  }
+
+  if (has_flags) {
+    write("\n\nFLAGS:\n");
+    for (const auto &field : fields) {
+      if (field.kind == field_kind::flag) {
+        write("    -");
+        put(field.name[0]);
+        write(", --");
+        write(field.name);
+        put('\n');
+      }
+    }
+  } else {
+    put('\n');
+  }
+
+  write("\nOPTIONS:\n");
+  for (const auto &field : fields) {
+    if (field.kind == field_kind::optional) {
+      write_option(field.name);
+    }
+  }
+  write_option("help");
+  write_option("version");
+
+  if (has_sub_commands) {
+    write("\nSUBCOMMANDS:\n");
+    for (const auto &field : fields) {
+      if (field.kind == field_kind::nested_struct) {
+        write("    ");
+        write(field.name);
+        put('\n');
+      }
+    }
+  }
+
+  if (has_positional) {
+    write("\nARGS:\n");
+    for (const auto &field : fields) {
+      if (field.kind == field_kind::positional) {
+        write("    ");
+        write(field.name);
+        put('\n');
+      }
+    }
+  }
+  return size;
+}
+
+// The help for the fields of `Table`, rendered at compile time into a
+// buffer that is written as a whole
+template <typename Table> struct help_of {
+  static constexpr std::size_t length = render_help(Table::fields, nullptr);
+
+  static constexpr std::array<char, length> text = [] {
+    std::array<char, length> result{};
+    render_help(Table::fields, result.data());
+    return result;
+  }();
+
+  static constexpr std::string_view view() { return {text.data(), length}; }
+};
+
+// The fields of a STRUCTOPT struct, in declaration order, and the order in
+// which positional fields take their values. Known at compile time.
+template <typename T> struct schema_table {
+  static constexpr std::size_t field_count = visit_struct::field_count<T>();
+
+  template <std::size_t... I>
+  static constexpr std::array<field_schema, field_count>
+  make_fields(std::index_sequence<I...>) {
+    return {{field_schema{visit_struct::get_name<I, T>(),
+                          kind_of<visit_struct::type_at<I, T>>(),
+                          is_container_field<visit_struct::type_at<I, T>>()}...}};
+  }
+
+  static constexpr std::array<field_schema, field_count> fields =
+      make_fields(std::make_index_sequence<field_count>{});
+
+  static constexpr std::size_t positional_count = [] {
+    std::size_t result = 0;
+    for (std::size_t i = 0; i < field_count; i++) {
+      result += fields[i].kind == field_kind::positional ? 1 : 0;
+    }
+    return result;
+  }();
+
+  static constexpr std::array<std::size_t, positional_count> positional_fields = [] {
+    std::array<std::size_t, positional_count> result{};
+    std::size_t j = 0;
+    for (std::size_t i = 0; i < field_count; i++) {
+      if (fields[i].kind == field_kind::positional) {
+        result[j++] = i;
+      }
+    }
+    return result;
+  }();
+};
+
+// The description of a STRUCTOPT struct used by the parser and the help
+//
+// Fields come from the compile-time schema_table. The name indices are
+// built once per type, the first time the type is parsed.
+struct schema {
+  const field_schema *fields{nullptr};
+  std::size_t field_count{0};
+  const std::size_t *positional_fields{nullptr}; // positions in `fields`
+  std::size_t positional_count{0};
+  option_index field_index;        // every field
+  option_index option_field_index; // optional and flag fields, then `help` and `version`
+  std::string_view help{"\n"}; // after `USAGE: <name> `
+
+  std::size_t help_field() const { return field_count; }
+
+  std::size_t version_field() const { return field_count + 1; }
+
+  bool is_option_field(std::size_t field) const {
+    return field < field_count && (fields[field].kind == field_kind::optional ||
+                                   fields[field].kind == field_kind::flag);
+  }
+};
+
+template <typename T> const schema &schema_of() {
+  using table = schema_table<T>;
+  static const schema result = [] {
+    schema s;
+    s.fields = table::fields.data();
+    s.field_count = table::field_count;
+    s.positional_fields = table::positional_fields.data();
+    s.positional_count = table::positional_count;
+    s.help = help_of<table>::view();
+
+    // Optional and flag fields keep their position in the struct so that
+    // a lookup yields the field to visit. The other fields are left unnamed.
+    std::vector<std::string_view> field_names, option_names;
+    for (const auto &field : table::fields) {
+      field_names.push_back(field.name);
+      option_names.push_back(field.kind == field_kind::optional ||
+                                     field.kind == field_kind::flag
+                                 ? field.name
+                                 : "");
+    }
+    option_names.push_back("help");
+    option_names.push_back("version");
+    s.field_index = option_index(field_names);
+    s.option_field_index = option_index(option_names);
+    return s;
+  }();
+  return result;
+}
+
+} // namespace details
+
+} // namespace structopt
+#pragma once
+#include <cstddef>
+// #include <structopt/third_party/visit_struct/visit_struct.hpp>
+#include <utility>
+
+namespace structopt {
+
+namespace details {
+
+template <typename T, typename F, std::size_t... I>
+void visit_field(T &argument_struct, std::size_t field, F &visitor,
+                 std::index_sequence<I...>) {
+  using handler = void (*)(T &, F &);
+  static constexpr handler handlers[] = {[](T &s, F &v) {
+    v(visit_struct::get_name<I, T>(), visit_struct::get<I>(s));
+  }...};
+  handlers[field](argument_struct, visitor);
+}
+
+// Call `visitor(name, value)` for the field at position `field` of a
+// visitable struct. Unlike visit_struct::for_each, this is a single
+// indirect call no matter how many fields the struct has.
+template <typename T, typename F>
+void visit_field(T &argument_struct, std::size_t field, F &visitor) {
+  constexpr std::size_t field_count = visit_struct::field_count<T>();
+  if constexpr (field_count > 0) {
+    if (field < field_count) {
+      visit_field(argument_struct, field, visitor,
+                  std::make_index_sequence<field_count>{});
+    }
+  }
+}
+
+} // namespace details
+
+} // namespace structopt
+
+#pragma once
+#include <ostream>
+#include <string>
+// #include <structopt/schema.hpp>
+
+namespace structopt {
+
+class app;
+
+namespace details {
+
+// The name, version and schema of the struct being parsed, for the parser
+// and the help message
+struct visitor {
+  std::string name;
+  std::string version;
+  const details::schema *schema{nullptr};
+
+  visitor() = default;
+
+  explicit visitor(const std::string &name, const std::string &version)
+      : name(name), version(version) {}
+
+  // The help is rendered at compile time, after `USAGE: <name> `; only the
+  // name is added to it. Before a parse, no fields are known, and the help is
+  // the usage line alone.
+  std::string help() const {
+    const std::string_view body = schema ? schema->help : "\n";
+    std::string result;
+    result.reserve(8 + name.size() + 1 + body.size());
+    result += "\nUSAGE: ";
+    result += name;
+    result += ' ';
+    result += body;
+    return result;
+  }
+
+  void print_help(std::ostream &os) const {
+    const auto text = help();
+    os.write(text.data(), static_cast<std::streamsize>(text.size()));
+  }
+};
+
+} // namespace details
+
+} // namespace structopt
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <limits>
+#include <string>
+// #include <structopt/visitor.hpp>
+
+// app::parse reports errors with exceptions, and app::try_parse without
+// them; a program built without exceptions can still use try_parse
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS) || defined(_CPPUNWIND)
+#define STRUCTOPT_HAS_EXCEPTIONS
+#endif
+
+namespace structopt {
+
+// What went wrong, for callers that handle errors without parsing what()
+enum class error_code : std::uint8_t {
+  invalid_value,        // e.g., `abc` for an int, or an unknown enum value
+  missing_value,        // e.g., `--log-level` at the end of the arguments
+  out_of_range,         // e.g., `40000` for a std::int16_t
+  combined_flag_value,  // e.g., `-ab 5` where `-a` takes a value
+  duplicate_sub_command // a different sub-command was already invoked
+};
+
+class exception : public std::exception {
+  std::string what_{""};
+  std::string help_{""};
+  error_code code_{error_code::invalid_value};
+  std::size_t index_{npos};
+
+public:
+  static constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+  exception(const std::string &what, const details::visitor &visitor,
+            error_code code = error_code::invalid_value, std::size_t index = npos)
+      : what_(what), help_(visitor.help()), code_(code), index_(index) {}
+
+  const char *what() const throw() { return what_.c_str(); }
+
+  // The help is rendered at compile time, so building it here only adds the
+  // name of the program to it
+  const char *help() const throw() { return help_.c_str(); }
+
+  error_code code() const { return code_; }
+
+  // The position of the offending argument in argv, or npos if the
+  // arguments ended before a value was found
+  std::size_t index() const { return index_; }
+};
+
+} // namespace structopt
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+// #include <structopt/exception.hpp>
+#include <utility>
+
+namespace structopt {
+
+enum class parse_status : std::uint8_t {
+  success,
+  error,                // see code(), index(), and message()
+  help_requested,       // -h or --help; message() is the help
+  version_requested,    // -v or --version; message() is the version
+  completion_requested  // __complete or --structopt-completion in argv;
+                        // message() is the output, to be printed as it is
+};
+
+namespace details {
+
+// Why app::try_parse stopped before the end of the arguments
+struct parse_stop {
+  parse_status status{parse_status::error};
+  error_code code{error_code::invalid_value};
+  std::size_t index{exception::npos};
+  std::string message;
+};
+
+} // namespace details
+
+// The outcome of app::try_parse: the parsed struct, an error, or a request
+// for the help, the version or a completion
+template <typename T> class parse_result {
+  T value_{};
+  details::parse_stop stop_{parse_status::success, error_code::invalid_value,
+                            exception::npos, {}};
+
+public:
+  explicit parse_result(T value) : value_(std::move(value)) {}
+
+  explicit parse_result(details::parse_stop stop) : stop_(std::move(stop)) {}
+
+  parse_status status() const { return stop_.status; }
+
+  bool has_value() const { return stop_.status == parse_status::success; }
+
+  explicit operator bool() const { return has_value(); }
+
+  // The parsed struct, or a default-constructed one if there is no value
+  T &value() & { return value_; }
+  const T &value() const & { return value_; }
+  T &&value() && { return std::move(value_); }
+
+  T &operator*() & { return value_; }
+  const T &operator*() const & { return value_; }
+
+  T *operator->() { return &value_; }
+  const T *operator->() const { return &value_; }
+
+  // `error`: what went wrong, see structopt::exception
+  error_code code() const { return stop_.code; }
+
+  // `error`: the position of the offending argument in argv, or
+  // exception::npos if the arguments ended before a value was found
+  std::size_t index() const { return stop_.index; }
+
+  // `error`: the error message, `help_requested`: the help,
+  // `version_requested`: the version, and `completion_requested`: the
+  // completion script or candidates
+  const std::string &message() const { return stop_.message; }
+};
+
+} // namespace structopt
+#pragma once
+
+namespace structopt {
+
+namespace details {
+struct parser;
+} // namespace details
+
+// Base of sub-command structs
+//
+// Kept to a flag, as every sub-command field carries it whether it is
+// invoked or not. The schema of a sub-command is shared by all instances of
+// its type, see details::schema_of.
+class sub_command {
+  bool invoked_{false};
+
+  friend struct structopt::details::parser;
+
+public:
+  bool has_value() const { return invoked_; }
+};
+
+} // namespace structopt
+
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <string_view>
+// #include <structopt/array_size.hpp>
+// #include <structopt/bool_literals.hpp>
+// #include <structopt/config_file.hpp>
+// #include <structopt/enum_index.hpp>
+// #include <structopt/environment.hpp>
+// #include <structopt/exception.hpp>
+// #include <structopt/is_number.hpp>
+// #include <structopt/is_specialization.hpp>
+// #include <structopt/memory_resource.hpp>
+// #include <structopt/option_index.hpp>
+// #include <structopt/parse_number.hpp>
+// #include <structopt/parse_result.hpp>
+// #include <structopt/schema.hpp>
+// #include <structopt/sub_command.hpp>
+// #include <structopt/token.hpp>
+// #include <structopt/visit_field.hpp>
+// #include <structopt/third_party/magic_enum/magic_enum.hpp>
+// #include <structopt/third_party/visit_struct/visit_struct.hpp>
+#include <system_error>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace structopt {
+
+namespace details {
+
+struct parser {
+  structopt::details::visitor visitor;
+  const details::schema *schema{nullptr}; // visitor.schema
+  argument_list *arguments{nullptr};      // shared with the parsers of sub-commands
+  std::size_t current_index{1};
+  std::size_t next_index{1};
+  std::size_t positional_index{0}; // the next positional field to take a value
+  bool double_dash_encountered{false}; // "--" option-argument delimiter
+  bool sub_command_invoked{false};
+  std::string already_invoked_subcommand_name{""};
+  bool help_requested{false};
+  bool version_requested{false};
+
+  // numeric std::vector and std::deque fields with at least this many values
+  // are converted on several threads; 0 converts every field on this thread
+  std::size_t parallel_threshold{0};
+  std::size_t parallel_threads{0}; // at most; 0 is one per core
+
+  // std::pmr containers and strings in the parsed struct take their memory
+  // from here, see app::memory_resource
+  memory_resource *resource{default_memory_resource()};
+
+  // optional and flag fields that are not named on the command line fall
+  // back to the environment, see app::environment, and then to the
+  // configuration files, the last one first, see app::config_file
+  const environment_index *environment{nullptr};
+  const std::vector<std::shared_ptr<const config_file>> *config_files{nullptr};
+  std::vector<bool> given_fields; // named on the command line
+
+  // the sub-commands that lead to this parser, e.g., `build.` for the
+  // fallbacks APP_BUILD_TARGET and [build] target
+  std::string fallback_scope;
+
+  // app::try_parse: errors, and requests for the help or the version, are
+  // kept in `stop` instead of being thrown or handled here. The first one
+  // stops the parse; the parser then acts as if the arguments had ended.
+  bool throws{true};
+  std::optional<parse_stop> stop;
+
+  parser() = default;
+
+  parser(const structopt::details::visitor &visitor, argument_list &arguments)
+      : visitor(visitor), schema(visitor.schema), arguments(&arguments) {}
+
+  std::string_view argument(std::size_t index) const { return (*arguments)[index]; }
+
+  // checks if there is an argument at `index`
+  // Arguments read from a stream are read up to `index`, not further.
+  bool has_argument(std::size_t index) { return !stop && arguments->has(index); }
+
+  // Report an error: throw it, or keep it if it is the first one, see `stop`
+  // `visitor` is only used for the exception, so it is unused without them
+  void fail(const std::string &what, [[maybe_unused]] const details::visitor &visitor,
+            error_code code = error_code::invalid_value,
+            std::size_t index = exception::npos) {
+    if (throws) {
+#ifdef STRUCTOPT_HAS_EXCEPTIONS
+      throw structopt::exception(what, visitor, code, index);
+#else
+      // app::parse needs exceptions; see app::try_parse
+      std::cerr << what << "\n";
+      std::abort();
+#endif
+    } else if (!stop) {
+      stop = parse_stop{parse_status::error, code, index, what};
+    }
+  }
+
+  std::size_t help_field() const { return schema->help_field(); }
+
+  std::size_t version_field() const { return schema->version_field(); }
+
+  bool is_option_field(std::size_t field) const { return schema->is_option_field(field); }
+
+  // Find the field named by an optional argument, e.g., -v, --verbose
+  // Optional and flag fields take precedence over other fields with the same initial
+  std::size_t find_field(std::string_view next) const {
+    auto result = schema->option_field_index.find(next);
+    if (result == option_index::npos) {
+      result = schema->field_index.find(next);
+    }
+    return result;
+  }
+
+  // Classify a command-line argument
+  // This is done once per argument; all later checks look at the token
+  token classify(std::string_view next) {
+    token result;
+
+    if (double_dash_encountered) {
+      // everything after `--` is a value
+      return result;
+    } else if (next == "--") {
+      double_dash_encountered = true;
+      result.kind = token_kind::double_dash;
+      return result;
+    } else if (next.size() < 2 || next[0] != '-') {
+      // e.g., foo.csv, 0x5B
+      return result;
+    }
+
+    // a single scan tells numbers from options and finds the delimiter
+    const auto shape = scan_argument(next);
+    if (shape.notation != number_notation::none) {
+      // e.g., -5, -0x5B, -.5e3
+      return result;
+    }
+
+    // e.g., -v, --verbose, -log-level
+    result.field = find_field(next);
+    if (result.field != token::npos) {
+      result.kind = token_kind::option;
+      return result;
+    }
+
+    // maybe this is an optional argument that is delimited with '=' or ':'
+    // e.g., -std=c++17 or --output:main
+    const auto delimiter = shape.delimiter;
+    if (delimiter != argument_shape::npos) {
+      const auto key = next.substr(0, delimiter);
+      if (key.size() >= 2 && !shape.key_is_number) {
+        result.field = find_field(key);
+        if (result.field != token::npos) {
+          result.kind = token_kind::delimited_option;
+          result.delimiter = delimiter;
+          return result;
+        }
+      }
+    }
+
+    // maybe this is a combined argument
+    // e.g., -abc => -a, -b, and -c where each letter is the short form of a field
+    result.kind = token_kind::combined_flags;
+    if (next[1] == '-') {
+      result.kind = token_kind::unknown_option;
+    }
+    for (std::size_t i = 1; i < next.size() && result.kind == token_kind::combined_flags;
+         i++) {
+      if (std::isdigit(static_cast<unsigned char>(next[i])) ||
+          schema->field_index.find_short(next[i]) == option_index::npos) {
+        result.kind = token_kind::unknown_option;
+      }
+    }
+    return result;
+  }
+
+  // Arguments are classified lazily, in order, so that the parser of a
+  // sub-command classifies the arguments it consumes with its own fields.
+  // Arguments that were consumed as values, e.g., `bar` in `--foo bar`,
+  // are never classified.
+  const token &token_at(std::size_t index) {
+    auto &tokens = arguments->tokens;
+    const auto position = index - arguments->offset;
+    if (tokens.size() <= position) {
+      tokens.resize(position);
+      tokens.push_back(classify(argument(index)));
+    }
+    return tokens[position];
+  }
+
+  // checks if the argument at `index` marks the end of a container
+  // argument, i.e., it names a field, it is a delimited optional argument,
+  // or it is `--`
+  bool ends_container(std::size_t index) {
+    const auto next = argument(index);
+    if (next.size() < 2 || next[0] != '-') {
+      // e.g., foo.csv or 5; a value, whatever the fields
+      return false;
+    }
+    const auto &token = token_at(index);
+    return token.kind == token_kind::double_dash ||
+           ((token.kind == token_kind::option ||
+             token.kind == token_kind::delimited_option) &&
+            token.field < schema->field_count);
+  }
 
-    auto equal_pos = next.find('=');
-    auto colon_pos = next.find(':');
+  // checks if the argument at `next_index` marks the end of a container
+  // argument, and gets past it if it is `--`
+  bool is_end_of_container() {
+    if (!ends_container(next_index)) {
+      return false;
+    }
+    if (token_at(next_index).kind == token_kind::double_dash) {
+      next_index += 1;
+    }
+    return true;
+  }
 
-    if (equal_pos == std::string::npos && colon_pos == std::string::npos) {
-      // not delimited
-      return {success, delimiter};
-    } else {
-      // assume `=` comes first
-      char c = '=';
-
-      if (colon_pos < equal_pos) {
-        // confirmed: `:` comes first
-        c = ':';
-      }
-
-      // split `next` into key and value
-      // check if key is an optional field
-      std::string key;
-      bool delimiter_found = false;
-      for (size_t i = 0; i < next.size(); i++) {
-        if (next[i] == c && !delimiter_found) {
-          delimiter = c;
-          delimiter_found = true;
-        } else {
-          if (!delimiter_found) {
-            key += next[i];
-          }
-        }
+  // The field that takes the value at `current_index`: the next positional
+  // field, or the sub-command with that name if it comes first in the struct
+  std::size_t value_field() {
+    std::size_t result = token::npos;
+    if (positional_index < schema->positional_count) {
+      result = schema->positional_fields[positional_index];
+    }
+
+    const auto next = argument(current_index);
+    const auto sub_command = schema->field_index.find_long(next);
+    if (sub_command < result &&
+        schema->fields[sub_command].kind == field_kind::nested_struct &&
+        schema->fields[sub_command].name == next) {
+      result = sub_command;
+    }
+    return result;
+  }
+
+  // Parse a combined argument flag by flag, e.g., -abc => -a, -b, and -c
+  //
+  // Each flag in turn takes the place of the combined argument and is parsed
+  // like any other optional argument, so the argument list is never shifted.
+  // Only the last flag can take values, e.g., "./main -ac 3.14 2.718"
+  template <typename T> void parse_combined_flags(T &argument_struct) {
+    // a copy; the values of the last flag may release the argument
+    const std::string next{argument(current_index)};
+
+    bool names_option = false;
+    for (std::size_t i = 1; i < next.size(); i++) {
+      if (schema->option_field_index.find_short(next[i]) != option_index::npos) {
+        names_option = true;
       }
+    }
+    if (!names_option) {
+      return;
+    }
 
-      // check if `key` is a valid optional field
-      if (delimiter_found && is_optional_field(key)) {
-        success = true;
+    for (std::size_t i = 1; i < next.size(); i++) {
+      arguments->replace(current_index, short_option(next[i]));
+      next_index = current_index;
+      parse_token(argument_struct);
+      if (i + 1 < next.size() && next_index > current_index + 1) {
+        fail("Error: failed to correctly parse combined argument `" + next +
+                 "`. Only its last flag `-" + std::string(1, next.back()) +
+                 "` can take a value.",
+             visitor, error_code::combined_flag_value, current_index);
+        return;
       }
     }
-    return {success, delimiter};
+
+    // get past the combined argument, and any values of its last flag
+    next_index = std::max(next_index, current_index + 1);
   }
 
-  std::pair<std::string, std::string> split_delimited_argument(char delimiter,
-                                                               const std::string &next) {
-    std::string key, value;
-    bool delimiter_found = false;
-    for (size_t i = 0; i < next.size(); i++) {
-      if (next[i] == delimiter && !delimiter_found) {
-        delimiter_found = true;
-      } else {
-        if (!delimiter_found) {
-          key += next[i];
-        } else {
-          value += next[i];
+  // Parse the argument at `current_index` into whichever field it belongs to
+  template <typename T> void parse_token(T &argument_struct) {
+    const auto next = token_at(current_index);
+    switch (next.kind) {
+    case token_kind::double_dash:
+      next_index += 1;
+      break;
+    case token_kind::option:
+    case token_kind::delimited_option:
+      if (next.field == help_field()) {
+        help_requested = true;
+        next_index += 1;
+      } else if (next.field == version_field()) {
+        version_requested = true;
+        next_index += 1;
+      } else if (is_option_field(next.field)) {
+        if (has_fallbacks()) {
+          given_fields[next.field] = true;
         }
+        visit_field(argument_struct, next.field, *this);
+      } else if (next.kind == token_kind::delimited_option) {
+        // e.g., --foo=bar where `foo` is not an optional field
+        next_index += 1;
       }
+      break;
+    case token_kind::combined_flags:
+      parse_combined_flags(argument_struct);
+      break;
+    case token_kind::unknown_option:
+      break;
+    case token_kind::value:
+      visit_field(argument_struct, value_field(), *this);
+      break;
     }
-    return {key, value};
   }
 
-  // Strip the initial dashes on the left of an optional argument
-  // e.g., --verbose => verbose
-  // e.g., -log-level => log-level
-  std::string lstrip_dashes(const std::string& next) {
-    std::string result;
-    bool prefix_dashes_ended = false;
-    for (auto& c : next) {
-      if (prefix_dashes_ended == false && c != '-') {
-        prefix_dashes_ended = true;
-      }
-      if (prefix_dashes_ended) {
-        result += c;
+  // Parse the arguments from `current_index` on into `argument_struct`
+  //
+  // Each argument is visited once and handed to the field it belongs to.
+  // Arguments that no field takes are skipped. Afterwards, `next_index`
+  // is the end of the last argument that was consumed.
+  template <typename T> void parse_fields(T &argument_struct) {
+    if (has_fallbacks()) {
+      given_fields.assign(schema->field_count, false);
+    }
+
+    while (has_argument(current_index)) {
+      const auto last_index = next_index;
+      next_index = current_index;
+      parse_token(argument_struct);
+      if (next_index > current_index) {
+        current_index = next_index;
+      } else {
+        next_index = last_index;
+        current_index += 1;
       }
     }
-    return result;
-  }
 
-  // Get the optional field name if any from 
-  // e.g., `-v` => `verbose`
-  // e.g., `-log-level` => `log_level`
-  std::optional<std::string> get_full_optional_field_name(const std::string& next) {
-    std::optional<std::string> result;
+    if (stop) {
+      return;
+    } else if (!throws && (help_requested || version_requested)) {
+      // try_parse leaves printing the help or the version to its caller
+      stop = parse_stop{help_requested ? parse_status::help_requested
+                                       : parse_status::version_requested,
+                        error_code::invalid_value, exception::npos,
+                        help_requested ? visitor.help() : visitor.version};
+      return;
+    } else if (help_requested) {
+      // if help is requested, print help and exit
+      visitor.print_help(std::cout);
+      exit(EXIT_SUCCESS);
+    } else if (version_requested) {
+      // if version is requested, print version and exit
+      std::cout << visitor.version << "\n";
+      exit(EXIT_SUCCESS);
+    }
 
-    if (next.size() == 2 && next[0] == '-') {
-      // short form of optional argument
-      for (auto& oarg : visitor.optional_field_names) {
-        if (oarg[0] == next[1]) {
-          // second character of next matches first character of some optional field_name
-          result = oarg;
-          break;
-        }
+    if (has_fallbacks()) {
+      parse_fallbacks(argument_struct);
+      if (stop) {
+        return;
       }
-    } else {
-      // long form of optional argument
+    }
 
-      // strip dashes on the left
-      std::string potential_field_name = lstrip_dashes(next);
+    // if all positional arguments were provided
+    // there would be none left
+    for (auto i = positional_index; i < schema->positional_count; i++) {
+      const auto &field = schema->fields[schema->positional_fields[i]];
+      if (!field.is_container) {
+        // this positional argument is not a vector-like argument
+        // it expects value(s)
+        fail("Error: expected value for positional argument `" + std::string{field.name} +
+                 "`.",
+             visitor, error_code::missing_value);
+        return;
+      }
+    }
+  }
 
-      // replace `-` in the middle with `_`
-      std::replace(potential_field_name.begin(), potential_field_name.end(), '-', '_');
+  bool has_fallbacks() const {
+    return environment || (config_files && !config_files->empty());
+  }
 
-      // check if `potential_field_name` is in the optional field names list
-      for (auto& oarg : visitor.optional_field_names) {
-        if (oarg == potential_field_name) {
-          result = oarg;
-          break;
+  // Parse the values of the optional and flag fields that were not named on
+  // the command line from their fallbacks, e.g., APP_LOG_LEVEL=debug as if
+  // `--log-level=debug` had been provided
+  template <typename T> void parse_fallbacks(T &argument_struct) {
+    // each value is the only argument of a parser of its own, which keeps
+    // its errors so that they can name the source instead of an index
+    argument_list list(resource);
+    parser value_parser(visitor, list);
+    value_parser.throws = false;
+    value_parser.resource = resource;
+
+    for (std::size_t field = 0; field < schema->field_count && !stop; field++) {
+      if (!is_option_field(field) || given_fields[field]) {
+        continue;
+      }
+      const auto field_name = schema->fields[field].name;
+      std::optional<std::string_view> value;
+      const config_file *file = nullptr;
+      const config_file::entry *entry = nullptr;
+      if (environment) {
+        value = environment->find(fallback_scope, field_name);
+      }
+      if (!value && config_files) {
+        for (auto i = config_files->size(); i > 0 && !entry; i--) {
+          file = (*config_files)[i - 1].get();
+          entry = file->find(fallback_scope, field_name);
         }
+        if (entry) {
+          value = entry->value;
+        }
+      }
+      if (!value) {
+        continue;
       }
 
+      list.assign(&*value, &*value + 1);
+      value_parser.next_index = 0;
+      auto parse_value = [&value_parser](const char *name, auto &result) {
+        using field_type = std::decay_t<decltype(result)>;
+        if constexpr (structopt::is_specialization<field_type, std::optional>::value) {
+          assign_field(result,
+                       value_parser.parse_optional_value<typename field_type::value_type>(
+                           name));
+        }
+      };
+      visit_field(argument_struct, field, parse_value);
+
+      if (value_parser.stop) {
+        const auto source =
+            entry ? "`" + file->path() + "`, line " + std::to_string(entry->line)
+                  : "the environment variable `" +
+                        environment->name(fallback_scope, field_name) + "`";
+        fail(value_parser.stop->message + " The value is from " + source + ".", visitor,
+             value_parser.stop->code);
+      }
     }
-
-    return result;
   }
 
   template <typename T> std::pair<T, bool> parse_argument(const char *name) {
-    if (next_index >= arguments.size()) {
+    if (!has_argument(next_index)) {
       return {T(), false};
     }
-    T result;
+    T result = make_value<T>(resource);
     bool success = true;
     if constexpr (visit_struct::traits::is_visitable<T>::value) {
       result = parse_nested_struct<T>(name);
@@ -2340,56 +4422,79 @@ struct parser {
     } else {
       success = false;
     }
-    return {result, success};
+    return {std::move(result), success};
   }
 
+  // Parse the value(s) that follow an optional argument, e.g., `bar` in `--foo bar`
   template <typename T> std::optional<T> parse_optional_argument(const char *name) {
     next_index += 1;
+    return parse_optional_value<T>(name);
+  }
+
+  // Parse the value(s) of an optional argument, starting at `next_index`
+  template <typename T> std::optional<T> parse_optional_value(const char *name) {
     std::optional<T> result;
-    if (next_index < arguments.size()) {
+    if (has_argument(next_index)) {
       auto [value, success] = parse_argument<T>(name);
       if (success) {
-        result = value;
+        result = std::move(value);
       } else {
-        throw structopt::exception(
-            "Error: failed to correctly parse optional argument `" + std::string{name} +
-                "`.",
-            visitor);
+        fail("Error: failed to correctly parse optional argument `" + std::string{name} +
+                 "`.",
+             visitor, error_code::invalid_value, next_index);
       }
     } else {
-      throw structopt::exception("Error: expected value for optional argument `" +
-                                     std::string{name} + "`.",
-                                 visitor);
+      fail("Error: expected value for optional argument `" + std::string{name} + "`.",
+           visitor, error_code::missing_value);
     }
     return result;
   }
 
-  // Any field that can be constructed using std::stringstream
+  // Any field that can be converted with std::from_chars or constructed
+  // using std::stringstream
   // Not container type
   // Not a visitable type, i.e., a nested struct
   template <typename T>
   inline typename std::enable_if<!visit_struct::traits::is_visitable<T>::value, T>::type
-  parse_single_argument(const char *) {
-    std::string argument = arguments[next_index];
-    std::istringstream ss(argument);
-    T result;
-
-    if constexpr (std::is_integral<T>::value) {
-      if (is_hex_notation(argument)) {
-        ss >> std::hex >> result;
-      } else if (is_octal_notation(argument)) {
-        ss >> std::oct >> result;
-      } else if (is_binary_notation(argument)) {
-        argument.erase(0, 2); // remove "0b"
-        result = static_cast<T>(std::stoi(argument, nullptr, 2));
-      } else {
-        ss >> std::dec >> result;
+  parse_single_argument(const char *name) {
+    if constexpr (is_from_chars_number<T>::value) {
+      T result{};
+      const auto error = parse_number(argument(next_index), result);
+      if (error == std::errc::result_out_of_range) {
+        fail("Error: value `" + std::string{argument(next_index)} +
+                 "` is out of range for argument `" + std::string{name} + "`.",
+             visitor, error_code::out_of_range, next_index);
+      } else if (error != std::errc{}) {
+        fail("Error: failed to correctly parse argument `" + std::string{name} + "`. `" +
+                 std::string{argument(next_index)} + "` is not a number.",
+             visitor, error_code::invalid_value, next_index);
+      }
+      return result;
+    } else if constexpr (uses_memory_resource<T>::value &&
+                         structopt::is_specialization<T, std::basic_string>::value) {
+      // e.g., std::pmr::string
+      return T(argument(next_index), typename T::allocator_type(resource));
+    } else if constexpr (std::is_same<T, bool>::value) {
+      // yes, YES, on, 1, true, TRUE, etc. = true
+      // no, NO, off, 0, false, FALSE, etc. = false
+      // see structopt::bool_literals
+      if (!has_argument(next_index)) {
+        return false;
+      }
+      const auto result = parse_bool(argument(next_index));
+      if (!result.has_value()) {
+        fail("Error: failed to parse boolean argument `" + std::string{name} + "`." + " `" +
+                 std::string{argument(next_index)} + "`" + " is invalid.",
+             visitor, error_code::invalid_value, next_index);
+        return false;
       }
+      return result.value();
     } else {
+      std::istringstream ss(std::string{argument(next_index)});
+      T result;
       ss >> result;
+      return result;
     }
-
-    return result;
   }
 
   // Nested visitable struct
@@ -2399,82 +4504,49 @@ struct parser {
 
     T argument_struct;
 
+    // sub-command name; not the program
+    structopt::details::visitor sub_command_visitor(name, visitor.version);
+    sub_command_visitor.schema = &schema_of<T>();
+
     if constexpr (std::is_base_of<structopt::sub_command, T>::value) {
       argument_struct.invoked_ = true;
     }
 
-    // Save struct field names
-    argument_struct.visitor_.name = name; // sub-command name; not the program
-    argument_struct.visitor_.version = visitor.version;
-    visit_struct::for_each(argument_struct, argument_struct.visitor_);
-
-    // add `help` and `version` optional arguments
-    argument_struct.visitor_.optional_field_names.push_back("help");
-    argument_struct.visitor_.optional_field_names.push_back("version");
-
     if (!sub_command_invoked) {
       sub_command_invoked = true;
       already_invoked_subcommand_name = name;
     } else {
       // a sub-command has already been invoked
-      throw structopt::exception(
-          "Error: failed to invoke sub-command `" + std::string{name} +
-              "` because a different sub-command, `" + already_invoked_subcommand_name +
-              "`, has already been invoked.",
-          argument_struct.visitor_);
+      fail("Error: failed to invoke sub-command `" + std::string{name} +
+               "` because a different sub-command, `" + already_invoked_subcommand_name +
+               "`, has already been invoked.",
+           sub_command_visitor, error_code::duplicate_sub_command, current_index);
+      return argument_struct;
     }
 
-    structopt::details::parser parser;
-    parser.next_index = 0;
-    parser.current_index = 0;
+    // the sub-command continues from here, in the same argument list
+    structopt::details::parser parser(sub_command_visitor, *arguments);
+    parser.next_index = next_index;
+    parser.current_index = next_index;
     parser.double_dash_encountered = double_dash_encountered;
-    parser.visitor = argument_struct.visitor_;
-
-    std::copy(arguments.begin() + next_index, arguments.end(),
-              std::back_inserter(parser.arguments));
-
-    for (std::size_t i = 0; i < parser.arguments.size(); i++) {
-      parser.current_index = i;
-      visit_struct::for_each(argument_struct, parser);
-    }
-
-    // directly call the parser to check for `help` and `version` flags
-    std::optional<bool> help = false, version = false;
-    for (std::size_t i = 0; i < parser.arguments.size(); i++) {
-      parser.operator()("help", help);
-      parser.operator()("version", version);
-
-      if (help == true) {
-        // if help is requested, print help and exit
-        argument_struct.visitor_.print_help(std::cout);
-        exit(EXIT_SUCCESS);
-      } else if (version == true) {
-        // if version is requested, print version and exit
-        std::cout << argument_struct.visitor_.version << "\n";
-        exit(EXIT_SUCCESS);
-      }
+    parser.parallel_threshold = parallel_threshold;
+    parser.parallel_threads = parallel_threads;
+    parser.throws = throws;
+    parser.resource = resource;
+    if (has_fallbacks()) {
+      parser.environment = environment;
+      parser.config_files = config_files;
+      parser.fallback_scope = fallback_scope + name + ".";
     }
 
-    // if all positional arguments were provided
-    // this list would be empty
-    if (!parser.visitor.positional_field_names.empty()) {
-      for (auto &field_name : parser.visitor.positional_field_names) {
-        if (std::find(parser.visitor.vector_like_positional_field_names.begin(),
-                      parser.visitor.vector_like_positional_field_names.end(),
-                      field_name) ==
-            parser.visitor.vector_like_positional_field_names.end()) {
-          // this positional argument is not a vector-like argument
-          // it expects value(s)
-          throw structopt::exception("Error: expected value for positional argument `" +
-                                         field_name + "`.",
-                                     argument_struct.visitor_);
-        }
-      }
-    }
+    parser.parse_fields(argument_struct);
+    stop = std::move(parser.stop);
 
-    // update current and next
-    current_index += parser.next_index;
-    next_index += parser.next_index;
+    // continue after the last argument consumed by the sub-command
+    // arguments after that are classified again, with the fields of this struct
+    next_index = parser.next_index;
+    double_dash_encountered = parser.double_dash_encountered;
+    arguments->reclassify(next_index);
 
     return argument_struct;
   }
@@ -2487,20 +4559,19 @@ struct parser {
       // Pair first
       auto [value, success] = parse_argument<T1>(name);
       if (success) {
-        result.first = value;
+        assign_field(result.first, std::move(value));
       } else {
-        if (next_index == arguments.size()) {
+        if (!has_argument(next_index)) {
           // end of arguments list
           // first argument not provided
-          throw structopt::exception("Error: failed to correctly parse the pair `" +
-                                         std::string{name} +
-                                         "`. Expected 2 arguments, 0 provided.",
-                                     visitor);
+          fail("Error: failed to correctly parse the pair `" + std::string{name} +
+                   "`. Expected 2 arguments, 0 provided.",
+               visitor, error_code::missing_value);
         } else {
-          throw structopt::exception(
+          fail(
               "Error: failed to correctly parse first element of pair `" +
                   std::string{name} + "`",
-              visitor);
+              visitor, error_code::invalid_value, next_index);
         }
       }
     }
@@ -2508,20 +4579,19 @@ struct parser {
       // Pair second
       auto [value, success] = parse_argument<T2>(name);
       if (success) {
-        result.second = value;
+        assign_field(result.second, std::move(value));
       } else {
-        if (next_index == arguments.size()) {
+        if (!has_argument(next_index)) {
           // end of arguments list
           // second argument not provided
-          throw structopt::exception("Error: failed to correctly parse the pair `" +
-                                         std::string{name} +
-                                         "`. Expected 2 arguments, only 1 provided.",
-                                     visitor);
+          fail("Error: failed to correctly parse the pair `" + std::string{name} +
+                   "`. Expected 2 arguments, only 1 provided.",
+               visitor, error_code::missing_value);
         } else {
-          throw structopt::exception(
+          fail(
               "Error: failed to correctly parse second element of pair `" +
                   std::string{name} + "`",
-              visitor);
+              visitor, error_code::invalid_value, next_index);
         }
       }
     }
@@ -2533,19 +4603,21 @@ struct parser {
   std::array<T, N> parse_array_argument(const char *name) {
     std::array<T, N> result{};
 
-    const auto arguments_left = arguments.size() - next_index;
+    std::size_t arguments_left = 0;
+    while (arguments_left < N && has_argument(next_index + arguments_left)) {
+      arguments_left += 1;
+    }
     if (arguments_left == 0 || arguments_left < N) {
-      throw structopt::exception("Error: expected " + std::to_string(N) +
-                                     " values for std::array argument `" + name +
-                                     "` - instead got only " +
-                                     std::to_string(arguments_left) + " arguments.",
-                                 visitor);
+      fail("Error: expected " + std::to_string(N) + " values for std::array argument `" +
+               name + "` - instead got only " + std::to_string(arguments_left) +
+               " arguments.",
+           visitor, error_code::missing_value);
     }
 
     for (std::size_t i = 0; i < N; i++) {
       auto [value, success] = parse_argument<T>(name);
       if (success) {
-        result[i] = value;
+        assign_field(result[i], std::move(value));
       }
     }
     return result;
@@ -2570,22 +4642,20 @@ struct parser {
                            T &&result) {
     auto [value, success] = parse_argument<typename std::remove_reference<T>::type>(name);
     if (success) {
-      result = value;
+      assign_field(result, std::move(value));
     } else {
-      if (next_index == arguments.size()) {
+      if (!has_argument(next_index)) {
         // end of arguments list
         // failed to parse tuple <>. expected `size` arguments, `index` provided
-        throw structopt::exception("Error: failed to correctly parse tuple `" +
-                                       std::string{name} + "`. Expected " +
-                                       std::to_string(size) + " arguments, " +
-                                       std::to_string(index) + " provided.",
-                                   visitor);
+        fail("Error: failed to correctly parse tuple `" + std::string{name} +
+                 "`. Expected " + std::to_string(size) + " arguments, " +
+                 std::to_string(index) + " provided.",
+             visitor, error_code::missing_value);
       } else {
-        throw structopt::exception("Error: failed to correctly parse tuple `" +
-                                       std::string{name} +
-                                       "` {size = " + std::to_string(size) +
-                                       "} at index " + std::to_string(index) + ".",
-                                   visitor);
+        fail("Error: failed to correctly parse tuple `" + std::string{name} +
+                 "` {size = " + std::to_string(size) + "} at index " +
+                 std::to_string(index) + ".",
+             visitor, error_code::invalid_value, next_index);
       }
     }
   }
@@ -2602,358 +4672,790 @@ struct parser {
     return result;
   }
 
-  // Vector, deque, list
-  template <typename T> T parse_vector_like_argument(const char *name) {
-    T result;
+  // Vector, deque, list
+  template <typename T> T parse_vector_like_argument(const char *name) {
+    auto result = make_value<T>(resource);
+
+    if constexpr (is_from_chars_number<typename T::value_type>::value) {
+      if (!arguments->is_streamed()) {
+        // Numbers: find the end of the values first, then convert them
+        // without classifying each one
+        auto end = next_index;
+        while (has_argument(end) && !ends_container(end)) {
+          end += 1;
+        }
+        if constexpr (structopt::is_specialization<T, std::vector>::value ||
+                      structopt::is_specialization<T, std::deque>::value) {
+          if (parallel_threshold > 0 && end - next_index >= parallel_threshold) {
+            // leaves nothing for the loop below
+            convert_numbers_in_parallel(result, end, name);
+          }
+        }
+        if constexpr (structopt::is_specialization<T, std::vector>::value) {
+          result.reserve(end - next_index);
+        }
+        for (; next_index < end && !stop; next_index++) {
+          result.push_back(parse_single_argument<typename T::value_type>(name));
+        }
+        if (has_argument(next_index)) {
+          // get past `--`, if that is what ends the values
+          is_end_of_container();
+        }
+        return result;
+      }
+    }
+
+    // Parse from current till end
+    // Values read from a stream are parsed as they are read
+    while (has_argument(next_index)) {
+      if (is_end_of_container()) {
+        // this marks the end of the container (break here)
+        break;
+      }
+      auto [value, success] = parse_argument<typename T::value_type>(name);
+      if (success) {
+        result.push_back(std::move(value));
+      }
+      arguments->release(next_index);
+    }
+    return result;
+  }
+
+  // Convert the numbers from `next_index` up to `last` into `result`, one
+  // slice of the values per thread
+  //
+  // Every value is written to its own position, so the result does not
+  // depend on the number of threads. If some values do not convert, the
+  // first of them is converted again on this thread, which reports the
+  // same error as a conversion on a single thread would.
+  template <typename T>
+  void convert_numbers_in_parallel(T &result, std::size_t last, const char *name) {
+    constexpr std::size_t minimum_slice = 4096; // values per thread
+    const auto first = next_index;
+    const auto count = last - first;
+    const std::size_t available_threads =
+        parallel_threads > 0 ? parallel_threads : std::thread::hardware_concurrency();
+    const auto thread_count =
+        std::max<std::size_t>(1, std::min(available_threads, count / minimum_slice));
+
+    result.resize(count);
+    std::vector<std::size_t> failed(thread_count, last); // first failure per slice
+    const auto convert = [&](std::size_t slice) {
+      const auto begin = first + count * slice / thread_count;
+      const auto end = first + count * (slice + 1) / thread_count;
+      for (auto i = begin; i < end; i++) {
+        if (parse_number(argument(i), result[i - first]) != std::errc{}) {
+          failed[slice] = i;
+          return;
+        }
+      }
+    };
+
+    std::vector<std::thread> threads;
+    for (std::size_t slice = 1; slice < thread_count; slice++) {
+#ifdef STRUCTOPT_HAS_EXCEPTIONS
+      try {
+        threads.emplace_back(convert, slice);
+      } catch (const std::system_error &) {
+        // no thread to spare
+        convert(slice);
+      }
+#else
+      threads.emplace_back(convert, slice);
+#endif
+    }
+    convert(0);
+    for (auto &thread : threads) {
+      thread.join();
+    }
+
+    next_index = *std::min_element(failed.begin(), failed.end());
+    if (next_index < last) {
+      parse_single_argument<typename T::value_type>(name); // fails
+      next_index = last;
+    }
+  }
+
+  // stack, queue, priority_queue
+  template <typename T> T parse_container_adapter_argument(const char *name) {
+    auto result = make_value<T>(resource);
+    // Parse from current till end
+    while (has_argument(next_index)) {
+      if (is_end_of_container()) {
+        // this marks the end of the container (break here)
+        break;
+      }
+      auto [value, success] = parse_argument<typename T::value_type>(name);
+      if (success) {
+        result.push(std::move(value));
+      }
+      arguments->release(next_index);
+    }
+    return result;
+  }
+
+  // Set, multiset, unordered_set, unordered_multiset
+  template <typename T> T parse_set_argument(const char *name) {
+    auto result = make_value<T>(resource);
+    // Parse from current till end
+    while (has_argument(next_index)) {
+      if (is_end_of_container()) {
+        // this marks the end of the container (break here)
+        break;
+      }
+      auto [value, success] = parse_argument<typename T::value_type>(name);
+      if (success) {
+        result.insert(std::move(value));
+      }
+      arguments->release(next_index);
+    }
+    return result;
+  }
+
+  // Enum class
+  template <typename T> T parse_enum_argument(const char *name) {
+    const auto maybe_enum_value = enum_index<T>::find(argument(next_index));
+    if (!maybe_enum_value.has_value()) {
+      fail("Error: unexpected input `" + std::string{argument(next_index)} +
+               "` provided for enum argument `" + std::string{name} +
+               "`. Allowed values are {" + std::string{enum_index<T>::allowed_names()} +
+               "}",
+           visitor, error_code::invalid_value, next_index);
+      return T{};
+    }
+    return maybe_enum_value.value();
+  }
+
+  // Visitor function for nested struct
+  // `arguments[current_index]` is the name of this sub-command
+  template <typename T>
+  inline typename std::enable_if<visit_struct::traits::is_visitable<T>::value, void>::type
+  operator()(const char *name, T &value) {
+    next_index += 1;
+    // its std::pmr fields keep the memory resource they were parsed with
+    assign_field(value, parse_nested_struct<T>(name));
+  }
+
+  // Visitor function for any positional field (not std::optional)
+  // `arguments[current_index]` is the (first) value of this field
+  template <typename T>
+  inline typename std::enable_if<!structopt::is_specialization<T, std::optional>::value &&
+                                     !visit_struct::traits::is_visitable<T>::value,
+                                 void>::type
+  operator()(const char *name, T &result) {
+    auto [value, success] = parse_argument<T>(name);
+    if (success) {
+      assign_field(result, std::move(value));
+      // the next positional field takes the next value
+      positional_index += 1;
+    }
+  }
+
+  // Visitor function for std::optional field
+  // `arguments[current_index]` names this field, e.g., -v, --verbose, --foo=bar
+  template <typename T>
+  inline typename std::enable_if<structopt::is_specialization<T, std::optional>::value,
+                                 void>::type
+  operator()(const char *name, T &value) {
+    const auto next = token_at(current_index);
+
+    if (next.kind == token_kind::delimited_option) {
+      // e.g., --foo=bar or --foo:bar
+      // the value takes the place of the argument and is parsed as if
+      // `--foo bar` had been provided
+      const auto delimited = argument(current_index).substr(next.delimiter + 1);
+      arguments->replace(current_index, delimited);
+      assign_field(value, parse_optional_value<typename T::value_type>(name));
+      return;
+    }
+
+    if constexpr (std::is_same<typename T::value_type, bool>::value) {
+      // It is a boolean optional argument
+      // Does it have a default value?
+      // If yes, this is a FLAG argument, e.g,, "--verbose" will set it to true if the
+      // default value is false No need to write "--verbose true"
+      if (value.has_value()) {
+        // The field already has a default value!
+        value = !value.value(); // simply toggle it
+        next_index += 1;
+        return;
+      }
+    }
+
+    // Parse the argument type <T>
+    // this includes a boolean optional argument without a default value
+    assign_field(value, parse_optional_argument<typename T::value_type>(name));
+  }
+};
+
+// Specialization for std::string
+template <> inline std::string parser::parse_single_argument<std::string>(const char *) {
+  return std::string{argument(next_index)};
+}
+
+} // namespace details
+
+} // namespace structopt
+#pragma once
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <optional>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+// #include <structopt/is_specialization.hpp>
+// #include <structopt/option_index.hpp>
+// #include <structopt/schema.hpp>
+// #include <structopt/third_party/magic_enum/magic_enum.hpp>
+// #include <structopt/third_party/visit_struct/visit_struct.hpp>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace structopt {
+
+enum class completion_shell { bash, zsh, fish };
+
+// The values a field can take, computed when the shell asks for them, e.g.,
+// the branches of a repository; `prefix` is the word at the cursor so far
+using completer = std::function<std::vector<std::string>(std::string_view prefix)>;
+
+namespace details {
+
+inline std::optional<completion_shell> completion_shell_named(std::string_view name) {
+  if (name == "bash") {
+    return completion_shell::bash;
+  } else if (name == "zsh") {
+    return completion_shell::zsh;
+  } else if (name == "fish") {
+    return completion_shell::fish;
+  }
+  return std::nullopt;
+}
+
+// An optional or flag argument, as offered by a completion script
+struct completion_option {
+  std::string name;     // the long form, in kebab case, e.g., log-level
+  char short_name{0};   // 0 if the initial belongs to an earlier field
+  bool takes_value{true};
+  std::vector<std::string_view> values; // the names of an enum, if any
+};
+
+// A command, or a sub-command, as offered by a completion script
+struct completion_command {
+  std::string path; // e.g., `build.test` for the sub-command test of build
+  std::string name;
+  std::vector<completion_option> options;
+  std::vector<std::string_view> values; // enum names that positional fields take
+  bool takes_files{false};              // a positional field takes any value
+  std::vector<completion_command> sub_commands;
+};
+
+// The names of the enum that a field, or the elements of a container field,
+// take; empty if there is no such enum
+template <typename T> std::vector<std::string_view> completion_values() {
+  if constexpr (std::is_enum<T>::value) {
+    const auto names = magic_enum::enum_names<T>();
+    return {names.begin(), names.end()};
+  } else if constexpr (structopt::is_specialization<T, std::optional>::value ||
+                       is_container_field<T>()) {
+    return completion_values<typename T::value_type>();
+  } else {
+    return {};
+  }
+}
+
+// Describe the arguments of a STRUCTOPT struct, and of its sub-commands
+template <typename T>
+completion_command describe_completion(const std::string &name, const std::string &path) {
+  completion_command result;
+  result.name = name;
+  result.path = path;
+
+  const auto &schema = schema_of<T>();
+  const auto add_option = [&](std::string_view field_name, std::size_t field,
+                              bool takes_value, std::vector<std::string_view> values) {
+    completion_option option;
+    option.name = std::string(field_name);
+    for (auto &c : option.name) {
+      c = c == '_' ? '-' : c;
+    }
+    if (schema.option_field_index.find_short(field_name[0]) == field) {
+      option.short_name = field_name[0];
+    }
+    option.takes_value = takes_value;
+    option.values = std::move(values);
+    result.options.push_back(std::move(option));
+  };
+
+  std::size_t field = 0;
+  visit_struct::visit_types<T>([&](const char *field_name, auto type) {
+    using field_type = typename decltype(type)::type;
+    switch (kind_of<field_type>()) {
+    case field_kind::flag:
+      add_option(field_name, field, false, {});
+      break;
+    case field_kind::optional:
+      add_option(field_name, field, true, completion_values<field_type>());
+      break;
+    case field_kind::positional: {
+      auto values = completion_values<field_type>();
+      if (values.empty()) {
+        result.takes_files = true;
+      }
+      result.values.insert(result.values.end(), values.begin(), values.end());
+      break;
+    }
+    case field_kind::nested_struct:
+      if constexpr (visit_struct::traits::is_visitable<field_type>::value) {
+        result.sub_commands.push_back(describe_completion<field_type>(
+            field_name, path.empty() ? field_name : path + "." + field_name));
+      }
+      break;
+    }
+    field += 1;
+  });
+  add_option("help", schema.help_field(), false, {});
+  add_option("version", schema.version_field(), false, {});
+  return result;
+}
+
+// The name a program is run by, from its path, e.g., bin/my-app.exe => my-app
+inline std::string completion_program_name(std::string_view path) {
+  const auto slash = path.find_last_of("/\\");
+  if (slash != std::string_view::npos) {
+    path.remove_prefix(slash + 1);
+  }
+  const std::string_view suffix = ".exe";
+  if (path.size() > suffix.size() && path.substr(path.size() - suffix.size()) == suffix) {
+    path.remove_suffix(suffix.size());
+  }
+  return std::string(path);
+}
+
+// A name that can be part of a shell function name, e.g., my-app => my_app
+inline std::string completion_function_name(const std::string &program) {
+  std::string result = "_";
+  for (auto c : program) {
+    const bool is_word = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+                         (c >= '0' && c <= '9') || c == '_';
+    result += is_word ? c : '_';
+  }
+  return result;
+}
+
+template <typename F>
+void for_each_command(const completion_command &command, const F &f) {
+  f(command);
+  for (const auto &sub_command : command.sub_commands) {
+    for_each_command(sub_command, f);
+  }
+}
+
+// The words offered for a command: its options and sub-commands, and the
+// names its positional fields take
+inline std::string completion_words(const completion_command &command) {
+  std::string result;
+  const auto add = [&result](std::string_view word) {
+    if (!result.empty()) {
+      result += ' ';
+    }
+    result += word;
+  };
+  for (const auto &option : command.options) {
+    add("--" + option.name);
+    if (option.short_name) {
+      add(std::string{'-', option.short_name});
+    }
+  }
+  for (const auto &sub_command : command.sub_commands) {
+    add(sub_command.name);
+  }
+  for (auto value : command.values) {
+    add(value);
+  }
+  return result;
+}
+
+inline std::string completion_values_list(const completion_option &option) {
+  std::string result;
+  for (auto value : option.values) {
+    result += result.empty() ? "" : " ";
+    result += value;
+  }
+  return result;
+}
+
+// The case patterns, e.g., `":--log-level"|":-l"`, that match an option
+// taking a value right before the cursor in `command`
+inline std::string completion_option_pattern(const completion_command &command,
+                                             const completion_option &option) {
+  auto result = "\"" + command.path + ":--" + option.name + "\"";
+  if (option.short_name) {
+    result += "|\"" + command.path + ":-" + option.short_name + "\"";
+  }
+  return result;
+}
+
+// bash and zsh share the way they find the sub-command the cursor is in:
+// each word that names a sub-command of the current one enters it
+inline void write_completion_sub_command_cases(std::ostream &os,
+                                               const completion_command &root) {
+  for_each_command(root, [&os](const completion_command &command) {
+    for (const auto &sub_command : command.sub_commands) {
+      os << "      \"" << command.path << ":" << sub_command.name << "\") command=\""
+         << sub_command.path << "\" ;;\n";
+    }
+  });
+}
 
-    // Parse from current till end
-    while (next_index < arguments.size()) {
-      const auto next = arguments[next_index];
-      if (is_optional_field(next) || std::string{next} == "--" ||
-          is_delimited_optional_argument(next).first) {
-        if (std::string{next} == "--") {
-          double_dash_encountered = true;
-          next_index += 1;
-        }
-        // this marks the end of the container (break here)
-        break;
+inline void write_bash_completion(std::ostream &os, const completion_command &root,
+                                  const std::string &program) {
+  const auto function = completion_function_name(program);
+  os << "# bash completion for " << program << ", generated by structopt\n"
+     << function << "() {\n"
+     << "  local cur=\"${COMP_WORDS[COMP_CWORD]}\"\n"
+     << "  local prev=\"${COMP_WORDS[COMP_CWORD-1]}\"\n"
+     << "  local command=\"\" i\n"
+     << "  for ((i = 1; i < COMP_CWORD; i++)); do\n"
+     << "    case \"${command}:${COMP_WORDS[i]}\" in\n";
+  write_completion_sub_command_cases(os, root);
+  os << "    esac\n"
+     << "  done\n"
+     << "  case \"${command}:${prev}\" in\n";
+  for_each_command(root, [&os](const completion_command &command) {
+    for (const auto &option : command.options) {
+      if (!option.takes_value) {
+        continue;
       }
-      auto [value, success] = parse_argument<typename T::value_type>(name);
-      if (success) {
-        result.push_back(value);
+      os << "    " << completion_option_pattern(command, option) << ")\n";
+      if (option.values.empty()) {
+        os << "      COMPREPLY=($(compgen -f -- \"${cur}\"))\n";
+      } else {
+        os << "      COMPREPLY=($(compgen -W \"" << completion_values_list(option)
+           << "\" -- \"${cur}\"))\n";
       }
+      os << "      return ;;\n";
     }
-    return result;
-  }
+  });
+  os << "  esac\n"
+     << "  case \"${command}\" in\n";
+  for_each_command(root, [&os](const completion_command &command) {
+    os << "    \"" << command.path << "\")\n"
+       << "      COMPREPLY=($(compgen -W \"" << completion_words(command)
+       << "\" -- \"${cur}\"))\n";
+    if (command.takes_files) {
+      os << "      COMPREPLY+=($(compgen -f -- \"${cur}\"))\n";
+    }
+    os << "      ;;\n";
+  });
+  os << "  esac\n"
+     << "}\n"
+     << "complete -F " << function << " " << program << "\n";
+}
 
-  // stack, queue, priority_queue
-  template <typename T> T parse_container_adapter_argument(const char *name) {
-    T result;
-    // Parse from current till end
-    while (next_index < arguments.size()) {
-      const auto next = arguments[next_index];
-      if (is_optional_field(next) || std::string{next} == "--" ||
-          is_delimited_optional_argument(next).first) {
-        if (std::string{next} == "--") {
-          double_dash_encountered = true;
-          next_index += 1;
-        }
-        // this marks the end of the container (break here)
-        break;
+inline void write_zsh_completion(std::ostream &os, const completion_command &root,
+                                 const std::string &program) {
+  const auto function = completion_function_name(program);
+  os << "#compdef " << program << "\n"
+     << "# zsh completion for " << program << ", generated by structopt\n"
+     << function << "() {\n"
+     << "  local command=\"\" i\n"
+     << "  for ((i = 2; i < CURRENT; i++)); do\n"
+     << "    case \"${command}:${words[i]}\" in\n";
+  write_completion_sub_command_cases(os, root);
+  os << "    esac\n"
+     << "  done\n"
+     << "  case \"${command}:${words[CURRENT-1]}\" in\n";
+  for_each_command(root, [&os](const completion_command &command) {
+    for (const auto &option : command.options) {
+      if (!option.takes_value) {
+        continue;
       }
-      auto [value, success] = parse_argument<typename T::value_type>(name);
-      if (success) {
-        result.push(value);
+      os << "    " << completion_option_pattern(command, option) << ")\n";
+      if (option.values.empty()) {
+        os << "      _files\n";
+      } else {
+        os << "      compadd -- " << completion_values_list(option) << "\n";
       }
+      os << "      return ;;\n";
     }
-    return result;
-  }
+  });
+  os << "  esac\n"
+     << "  case \"${command}\" in\n";
+  for_each_command(root, [&os](const completion_command &command) {
+    os << "    \"" << command.path << "\")\n"
+       << "      compadd -- " << completion_words(command) << "\n";
+    if (command.takes_files) {
+      os << "      _files\n";
+    }
+    os << "      ;;\n";
+  });
+  os << "  esac\n"
+     << "}\n"
+     << "if [[ \"${funcstack[1]}\" == \"" << function << "\" ]]; then\n"
+     << "  " << function << " \"$@\"\n"
+     << "else\n"
+     << "  compdef " << function << " " << program << "\n"
+     << "fi\n";
+}
 
-  // Set, multiset, unordered_set, unordered_multiset
-  template <typename T> T parse_set_argument(const char *name) {
-    T result;
-    // Parse from current till end
-    while (next_index < arguments.size()) {
-      const auto next = arguments[next_index];
-      if (is_optional_field(next) || std::string{next} == "--" ||
-          is_delimited_optional_argument(next).first) {
-        if (std::string{next} == "--") {
-          double_dash_encountered = true;
-          next_index += 1;
-        }
-        // this marks the end of the container (break here)
-        break;
+inline void write_fish_completion(std::ostream &os, const completion_command &root,
+                                  const std::string &program) {
+  os << "# fish completion for " << program << ", generated by structopt\n";
+  const auto write_command = [&](const completion_command &command,
+                                 const std::string &condition) {
+    const auto prefix = "complete -c " + program + " -n '" + condition + "'";
+    if (!command.takes_files) {
+      os << prefix << " -f\n";
+    }
+    for (const auto &option : command.options) {
+      os << prefix << " -l " << option.name;
+      if (option.short_name) {
+        os << " -s " << option.short_name;
       }
-      auto [value, success] = parse_argument<typename T::value_type>(name);
-      if (success) {
-        result.insert(value);
+      if (option.takes_value && option.values.empty()) {
+        os << " -r -F";
+      } else if (option.takes_value) {
+        os << " -r -f -a '" << completion_values_list(option) << "'";
       }
+      os << "\n";
     }
-    return result;
-  }
-
-  // Enum class
-  template <typename T> T parse_enum_argument(const char *name) {
-    T result;
-    auto maybe_enum_value = magic_enum::enum_cast<T>(arguments[next_index]);
-    if (maybe_enum_value.has_value()) {
-      result = maybe_enum_value.value();
-    } else {
-      constexpr auto allowed_names = magic_enum::enum_names<T>();
+    for (const auto &sub_command : command.sub_commands) {
+      os << prefix << " -f -a " << sub_command.name << "\n";
+    }
+    for (auto value : command.values) {
+      os << prefix << " -f -a " << value << "\n";
+    }
+  };
 
-      std::string allowed_names_string = "";
-      if (allowed_names.size()) {
-        for (size_t i = 0; i < allowed_names.size() - 1; i++) {
-          allowed_names_string += std::string{allowed_names[i]} + ", ";
-        }
-        allowed_names_string += allowed_names[allowed_names.size() - 1];
+  // a command is active once its name has been seen, and until the name of
+  // one of its sub-commands is
+  const auto not_in_sub_command = [](const completion_command &command) {
+    std::string result;
+    if (!command.sub_commands.empty()) {
+      result = "not __fish_seen_subcommand_from";
+      for (const auto &sub_command : command.sub_commands) {
+        result += " " + sub_command.name;
       }
-
-      throw structopt::exception(
-          "Error: unexpected input `" + std::string{arguments[next_index]} +
-              "` provided for enum argument `" + std::string{name} +
-              "`. Allowed values are {" + allowed_names_string + "}",
-          visitor);
-      // TODO: Throw error invalid enum option
     }
     return result;
+  };
+  const auto root_condition = not_in_sub_command(root);
+  write_command(root, root_condition.empty() ? "true" : root_condition);
+  for (const auto &sub_command : root.sub_commands) {
+    for_each_command(sub_command, [&](const completion_command &command) {
+      auto condition = "__fish_seen_subcommand_from " + command.name;
+      const auto rest = not_in_sub_command(command);
+      if (!rest.empty()) {
+        condition += "; and " + rest;
+      }
+      write_command(command, condition);
+    });
   }
+}
 
-  // Visitor function for nested struct
-  template <typename T>
-  inline typename std::enable_if<visit_struct::traits::is_visitable<T>::value, void>::type
-  operator()(const char *name, T &value) {
-    if (next_index > current_index) {
-      current_index = next_index;
-    }
+// A static completion script for the arguments of `T`; the shell does not
+// run the program to complete its arguments
+template <typename T>
+std::string completion_script(completion_shell shell, const std::string &program) {
+  const auto root = describe_completion<T>(program, "");
+  std::stringstream os;
+  switch (shell) {
+  case completion_shell::bash:
+    write_bash_completion(os, root, program);
+    break;
+  case completion_shell::zsh:
+    write_zsh_completion(os, root, program);
+    break;
+  case completion_shell::fish:
+    write_fish_completion(os, root, program);
+    break;
+  }
+  return os.str();
+}
 
-    if (current_index < arguments.size()) {
-      const auto next = arguments[current_index];
-      const auto field_name = std::string{name};
+// The state of `<program> __complete <words...>`, where the last word is the
+// one at the cursor, e.g., `""` right after a space
+struct completion_request {
+  const std::vector<std::string_view> &words;
+  const std::unordered_map<std::string, completer> *completers{nullptr};
+  std::string scope; // e.g., `build.` in the sub-command build
+  std::vector<std::string> candidates;
+
+  std::string_view cursor() const { return words.back(); }
+
+  // Offers `before` followed by `value`, if it completes the word at the cursor
+  void offer(std::string_view before, std::string_view value) {
+    auto word = cursor();
+    const auto common = std::min(word.size(), before.size());
+    if (word.substr(0, common) != before.substr(0, common)) {
+      return;
+    }
+    word.remove_prefix(common);
+    if (word == value.substr(0, word.size())) {
+      candidates.emplace_back(before);
+      candidates.back() += value;
+    }
+  }
 
-      // Check if `next` is the start of a subcommand
-      if (visitor.is_field_name(next) && next == field_name) {
-        next_index += 1;
-        value = parse_nested_struct<T>(name);
+  // Offers `--name`, in kebab case, if it completes the word at the cursor
+  void offer_option(std::string_view name) {
+    auto word = cursor();
+    if (word.substr(0, 2) != std::string_view("--").substr(0, word.size())) {
+      return;
+    }
+    word.remove_prefix(std::min<std::size_t>(word.size(), 2));
+    if (word.size() <= name.size() &&
+        is_kebab_case_equal(word, name.substr(0, word.size()))) {
+      auto &candidate = candidates.emplace_back("--");
+      for (auto c : name) {
+        candidate += c == '_' ? '-' : c;
       }
     }
   }
+};
 
-  // Visitor function for any positional field (not std::optional)
-  template <typename T>
-  inline typename std::enable_if<!structopt::is_specialization<T, std::optional>::value &&
-                                     !visit_struct::traits::is_visitable<T>::value,
-                                 void>::type
-  operator()(const char *name, T &result) {
-    if (next_index > current_index) {
-      current_index = next_index;
-    }
+template <typename T> void complete_words(completion_request &request, std::size_t first);
 
-    if (current_index < arguments.size()) {
-      const auto next = arguments[current_index];
+// The functions that complete the fields of a STRUCTOPT struct, by position,
+// so that a field is completed without visiting the others
+template <typename T> struct completion_table {
+  using values_function = std::vector<std::string_view> (*)();
+  using words_function = void (*)(completion_request &, std::size_t);
 
-      if (is_optional(next)) {
-        return;
-      }
+  static constexpr std::size_t field_count = visit_struct::field_count<T>();
 
-      if (visitor.positional_field_names.empty()) {
-        // We're not looking to save any more positional fields
-        // all of them already have a value
-        // TODO: Report error, unexpected argument
-        return;
-      }
+  template <typename F> static constexpr words_function words_of() {
+    if constexpr (kind_of<F>() == field_kind::nested_struct) {
+      return &complete_words<F>;
+    } else {
+      return nullptr;
+    }
+  }
 
-      const auto field_name = visitor.positional_field_names.front();
+  template <std::size_t... I>
+  static constexpr std::array<values_function, field_count>
+  make_values(std::index_sequence<I...>) {
+    return {{&completion_values<visit_struct::type_at<I, T>>...}};
+  }
 
-      // // This will be parsed as a subcommand (nested struct)
-      // if (visitor.is_field_name(next) && next == field_name) {
-      //   return;
-      // }
+  template <std::size_t... I>
+  static constexpr std::array<words_function, field_count>
+  make_sub_commands(std::index_sequence<I...>) {
+    return {{words_of<visit_struct::type_at<I, T>>()...}};
+  }
 
-      if (field_name != std::string{name}) {
-        // current field is not the one we want to parse
-        return;
-      }
+  static constexpr std::array<values_function, field_count> values =
+      make_values(std::make_index_sequence<field_count>{});
 
-      // Remove from the positional field list as it is about to be parsed
-      visitor.positional_field_names.pop_front();
+  static constexpr std::array<words_function, field_count> sub_commands =
+      make_sub_commands(std::make_index_sequence<field_count>{});
+};
 
-      auto [value, success] = parse_argument<T>(field_name.c_str());
-      if (success) {
-        result = value;
-      } else {
-        // positional field does not yet have a value
-        visitor.positional_field_names.push_front(field_name);
+// Offers the values of a field: the names of its enum, and the candidates
+// of the completer registered for it
+template <typename T>
+void complete_value(completion_request &request, std::size_t field,
+                    std::string_view before) {
+  const auto &schema = schema_of<T>();
+  for (auto value : completion_table<T>::values[field]()) {
+    request.offer(before, value);
+  }
+  if (request.completers) {
+    auto path = request.scope + schema.fields[field].name;
+    const auto completer = request.completers->find(path);
+    if (completer != request.completers->end()) {
+      const auto word = request.cursor();
+      for (const auto &value :
+           completer->second(word.substr(std::min(word.size(), before.size())))) {
+        request.offer(before, value);
       }
     }
   }
+}
 
-  // Visitor function for std::optional field
-  template <typename T>
-  inline typename std::enable_if<structopt::is_specialization<T, std::optional>::value,
-                                 void>::type
-  operator()(const char *name, T &value) {
-    if (next_index > current_index) {
-      current_index = next_index;
+// Works out the sub-command and the field at the cursor from the words
+// before it, and offers the candidates for the word at the cursor
+//
+// Values are neither converted nor validated, and no struct is constructed;
+// the words after `first` are looked at once each.
+template <typename T>
+void complete_words(completion_request &request, std::size_t first) {
+  const auto &schema = schema_of<T>();
+  const auto takes_value = [&schema](std::size_t field) {
+    return field < schema.field_count &&
+           schema.fields[field].kind == field_kind::optional;
+  };
+  const auto cursor = request.words.size() - 1;
+  std::size_t positional = 0;
+  bool only_positional = false; // after `--`
+
+  for (auto i = first; i < cursor; i++) {
+    const auto word = request.words[i];
+    if (!only_positional && word == "--") {
+      only_positional = true;
+      continue;
     }
-
-    if (current_index < arguments.size()) {
-      const auto next = arguments[current_index];
-      const auto field_name = std::string{name};
-
-      if (next == "--" && double_dash_encountered == false) {
-        double_dash_encountered = true;
-        next_index += 1;
-        return;
-      }
-
-      // if `next` looks like an optional argument
-      // i.e., starts with `-` or `--`
-      // see if you can find an optional field in the struct with a matching name
-
-      // check if the current argument looks like it could be this optional field
-      if (double_dash_encountered == false && is_optional_field(next, field_name)) {
-
-        // this is an optional argument matching the current struct field
-        if constexpr (std::is_same<typename T::value_type, bool>::value) {
-          // It is a boolean optional argument
-          // Does it have a default value?
-          // If yes, this is a FLAG argument, e.g,, "--verbose" will set it to true if the
-          // default value is false No need to write "--verbose true"
-          if (value.has_value()) {
-            // The field already has a default value!
-            value = !value.value(); // simply toggle it
-            next_index += 1;
-          } else {
-            // boolean optional argument doesn't have a default value
-            // expect one
-            value = parse_optional_argument<typename T::value_type>(name);
-          }
-        } else {
-          // Not std::optional<bool>
-          // Parse the argument type <T>
-          value = parse_optional_argument<typename T::value_type>(name);
-        }
-      } else {
-        if (double_dash_encountered == false) {
-
-          // maybe this is an optional argument that is delimited with '=' or ':'
-          // e.g., --foo=bar or --foo:BAR
-          if (next.size() > 1 && next[0] == '-') {
-            const auto [success, delimiter] = is_delimited_optional_argument(next);
-            if (success) {
-              const auto [lhs, rhs] = split_delimited_argument(delimiter, next);
-              // update next_index and return
-              // the parser will take care of the rest
-
-              // if `lhs` is an optional argument (i.e., maps to an optional field in the original struct), then insert into arguments list
-              auto potential_field_name = get_full_optional_field_name(lhs);
-              if (potential_field_name.has_value()) {
-                for (auto &arg : {rhs, lhs}) {
-                  const auto begin = arguments.begin();
-                  arguments.insert(begin + next_index + 1, arg);
-                }
-              }
-              // get past the current argument, e.g., `--foo=bar`
-              next_index += 1;
-              return;
-            }
-          }
-
-          // A direct match of optional argument with field_name has not happened
-          // This _could_ be a combined argument
-          // e.g., -abc => -a, -b, and -c where each of these is a flag argument
-
-          std::vector<std::string> potential_combined_argument;
-
-          if (is_optional_field(next) == false && next[0] == '-' &&
-              (next.size() > 1 && next[1] != '-')) {
-            for (std::size_t i = 1; i < next.size(); i++) {
-              potential_combined_argument.push_back("-" + std::string(1, next[i]));
-            }
-          }
-
-          if (!potential_combined_argument.empty()) {
-            bool is_combined_argument = true;
-            for (auto &arg : potential_combined_argument) {
-              if (!is_optional_field(arg)) {
-                is_combined_argument = false;
-                // TODO: report error unrecognized option in combined argument
-              }
-            }
-
-            if (is_combined_argument) {
-
-              // check and make sure the current field_name is
-              // in `potential_combined_argument`
-              //
-              // Let's say the argument `next` is `-abc`
-              // the current field name is `b`
-              // 1. Split `-abc` into `-a`, `-b`, and `-c`
-              // 2. Check if `-b` is in the above list
-              //    1. If yes, consider this as a combined argument
-              //       push the list of arguments (split up) into `arguments`
-              //    2. If no, nothing to do here
-              bool field_name_matched = false;
-              for (auto &arg : potential_combined_argument) {
-                if (arg == "-" + std::string(1, field_name[0])) {
-                  field_name_matched = true;
-                }
-              }
-
-              if (field_name_matched) {
-                // confirmed: this is a combined argument
-
-                // insert the individual options that make up the combined argument
-                // right after the combined argument
-                // e.g., ""./main -abc" becomes "./main -abc -a -b -c"
-                // Once this is done, increment `next_index` so that the parser loop will
-                // service
-                // `-a`, `-b` and `-c` like any other optional arguments (flags and
-                // otherwise)
-                for (std::vector<std::string>::reverse_iterator it =
-                         potential_combined_argument.rbegin();
-                     it != potential_combined_argument.rend(); ++it) {
-                  auto &arg = *it;
-                  if (next_index < arguments.size()) {
-                    auto begin = arguments.begin();
-                    arguments.insert(begin + next_index + 1, arg);
-                  } else {
-                    arguments.push_back(arg);
-                  }
-                }
-
-                // get past the current combined argument
-                next_index += 1;
-              }
-            }
-          }
+    if (!only_positional && word.size() > 1 && word[0] == '-') {
+      const auto field =
+          schema.option_field_index.find(word.substr(0, word.find('=')));
+      if (takes_value(field) && word.find('=') == std::string_view::npos) {
+        if (i + 1 == cursor) {
+          // the word at the cursor is the value of this option
+          complete_value<T>(request, field, "");
+          return;
         }
+        i += 1; // skip the value
       }
+      continue;
+    }
+    const auto field = schema.field_index.find_long(word);
+    if (!only_positional && field != option_index::npos &&
+        schema.fields[field].kind == field_kind::nested_struct) {
+      // the rest of the words are for the sub-command
+      request.scope += std::string(schema.fields[field].name) + ".";
+      completion_table<T>::sub_commands[field](request, i + 1);
+      return;
+    }
+    if (positional < schema.positional_count &&
+        !schema.fields[schema.positional_fields[positional]].is_container) {
+      positional += 1;
     }
   }
-};
-
-// Specialization for std::string
-template <> inline std::string parser::parse_single_argument<std::string>(const char *) {
-  return arguments[next_index];
-}
 
-// Specialization for bool
-// yes, YES, on, 1, true, TRUE, etc. = true
-// no, NO, off, 0, false, FALSE, etc. = false
-// Converts argument to lower case before check
-template <> inline bool parser::parse_single_argument<bool>(const char *name) {
-  if (next_index > current_index) {
-    current_index = next_index;
+  const auto word = request.cursor();
+  if (!only_positional && !word.empty() && word[0] == '-') {
+    const auto delimiter = word.find('=');
+    if (delimiter != std::string_view::npos) {
+      // e.g., --log-level=de
+      const auto field = schema.option_field_index.find(word.substr(0, delimiter));
+      if (takes_value(field)) {
+        complete_value<T>(request, field, word.substr(0, delimiter + 1));
+      }
+      return;
+    }
+    for (std::size_t field = 0; field < schema.field_count; field++) {
+      if (schema.is_option_field(field)) {
+        request.offer_option(schema.fields[field].name);
+      }
+    }
+    request.offer_option("help");
+    request.offer_option("version");
+    return;
   }
 
-  if (current_index < arguments.size()) {
-    const std::vector<std::string> true_strings{"on", "yes", "1", "true"};
-    const std::vector<std::string> false_strings{"off", "no", "0", "false"};
-    std::string current_argument = arguments[current_index];
-
-    // Convert argument to lower case
-    std::transform(current_argument.begin(), current_argument.end(),
-                   current_argument.begin(),
-                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
-
-    // Detect if argument is true or false
-    if (std::find(true_strings.begin(), true_strings.end(), current_argument) !=
-        true_strings.end()) {
-      return true;
-    } else if (std::find(false_strings.begin(), false_strings.end(), current_argument) !=
-               false_strings.end()) {
-      return false;
-    } else {
-      throw structopt::exception("Error: failed to parse boolean argument `" +
-                                     std::string{name} + "`." + " `" + current_argument +
-                                     "`" + " is invalid.",
-                                 visitor);
-      return false;
+  for (std::size_t field = 0; field < schema.field_count; field++) {
+    if (schema.fields[field].kind == field_kind::nested_struct) {
+      request.offer("", schema.fields[field].name);
     }
-  } else {
-    return false;
+  }
+  if (positional < schema.positional_count) {
+    complete_value<T>(request, schema.positional_fields[positional], "");
   }
 }
 
@@ -2962,95 +5464,444 @@ template <> inline bool parser::parse_single_argument<bool>(const char *name) {
 } // namespace structopt
 
 #pragma once
+#include <atomic>
 #include <cstdlib>
 #include <iostream>
 #include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
+// #include <structopt/completion.hpp>
 // #include <structopt/is_stl_container.hpp>
 // #include <structopt/parser.hpp>
 // #include <structopt/third_party/visit_struct/visit_struct.hpp>
 #include <type_traits>
+#include <unordered_map>
 #include <vector>
 
 #define STRUCTOPT VISITABLE_STRUCT
 
 namespace structopt {
 
+template <typename T> class parser_for;
+
+// An app can be shared by threads that parse at the same time; each parse
+// has its own parser and argument list. The app only remembers the struct
+// parsed last, for help(), and is written to when that struct changes.
 class app {
-  details::visitor visitor;
+  details::visitor visitor; // the name and the version
+  std::size_t parallel_threshold{0};
+  std::size_t parallel_threads{0};
+  bool expands_response_files{false};
+  details::memory_resource *resource{details::default_memory_resource()};
+
+  // see environment() and config_file(); shared by the copies of this app
+  std::shared_ptr<const details::environment_index> fallback_environment;
+  std::vector<std::shared_ptr<const details::config_file>> config_files;
+
+  // see completer(); by the path of a field, e.g., `build.target`
+  std::unordered_map<std::string, structopt::completer> completers;
+
+  // the schema of the struct parsed last, for help(); see make_parser
+  mutable std::atomic<const details::schema *> schema{nullptr};
+
+  template <typename T> friend class parser_for;
 
 public:
   explicit app(const std::string &name, const std::string &version = "")
       : visitor(name, version) {}
 
-  template <typename T> T parse(const std::vector<std::string> &arguments) {
-    T argument_struct = T();
+  app(const app &other)
+      : visitor(other.visitor), parallel_threshold(other.parallel_threshold),
+        parallel_threads(other.parallel_threads),
+        expands_response_files(other.expands_response_files),
+        resource(other.resource), fallback_environment(other.fallback_environment),
+        config_files(other.config_files), completers(other.completers),
+        schema(other.schema.load()) {}
+
+  app &operator=(const app &other) {
+    visitor = other.visitor;
+    parallel_threshold = other.parallel_threshold;
+    parallel_threads = other.parallel_threads;
+    expands_response_files = other.expands_response_files;
+    resource = other.resource;
+    fallback_environment = other.fallback_environment;
+    config_files = other.config_files;
+    completers = other.completers;
+    schema.store(other.schema.load());
+    return *this;
+  }
+
+  // Convert the values of numeric std::vector and std::deque fields on
+  // several threads once a field has at least `threshold` values
+  //
+  // At most `threads` threads are used, or one per core if `threads` is 0.
+  app &parallel_conversion(std::size_t threshold = 100000, std::size_t threads = 0) {
+    parallel_threshold = threshold;
+    parallel_threads = threads;
+    return *this;
+  }
 
-    // Visit the struct and save flag, optional and positional field names
-    visit_struct::for_each(argument_struct, visitor);
+  // Replace an argument of the form `@path` with the arguments in the file at
+  // `path`, e.g., for argument lists too long for the command line
+  //
+  // Off by default: with it, any `@` argument names a file that is read, so
+  // only turn it on for arguments that come from the user of the program,
+  // not, e.g., for command lines received from elsewhere.
+  app &response_files(bool enabled = true) {
+    expands_response_files = enabled;
+    return *this;
+  }
 
-    // add `help` and `version` optional arguments
-    visitor.optional_field_names.push_back("help");
-    visitor.optional_field_names.push_back("version");
+  // Optional and flag fields that are not named on the command line take
+  // their value from the environment variable with the name of the field,
+  // in upper case and after `prefix`, e.g., APP_LOG_LEVEL for log_level.
+  // The fields of a sub-command use its name too, e.g., APP_BUILD_JOBS.
+  //
+  // The environment is read once, here, and not at every parse.
+  app &environment(const std::string &prefix) {
+    fallback_environment = std::make_shared<const details::environment_index>(prefix);
+    return *this;
+  }
 
-    // Construct the argument parser
-    structopt::details::parser parser;
-    parser.visitor = visitor;
-    parser.arguments = arguments;
+  // Optional and flag fields that are neither named on the command line nor
+  // set in the environment take their value from a configuration file, an
+  // INI file or a list of key=value lines, e.g., `log-level = debug`. A file
+  // added later takes precedence over the ones before it.
+  //
+  // The file is read once, here. A file that does not exist is skipped, so
+  // that optional files, e.g., ~/.apprc, can be added unconditionally.
+  app &config_file(const std::string &path) {
+    if (auto file = details::config_file::open(path)) {
+      config_files.push_back(
+          std::make_shared<const details::config_file>(std::move(*file)));
+    }
+    return *this;
+  }
 
-    for (std::size_t i = 1; i < parser.arguments.size(); i++) {
-      parser.current_index = i;
-      visit_struct::for_each(argument_struct, parser);
+  // Offer the values `complete` returns for a field when the program is run
+  // as `<program> __complete <words...>`, e.g., by a completion script that
+  // asks for the values of `build.target`, the field target of the
+  // sub-command build. Enum fields are offered their names without one.
+  app &completer(const std::string &field, structopt::completer complete) {
+    auto path = field;
+    for (auto &c : path) {
+      c = c == '-' ? '_' : c;
     }
+    completers[path] = std::move(complete);
+    return *this;
+  }
 
-    // directly call the parser to check for `help` and `version` flags
-    std::optional<bool> help = false, version = false;
-    for (std::size_t i = 1; i < parser.arguments.size(); i++) {
-      parser.operator()("help", help);
-      parser.operator()("version", version);
+#ifdef STRUCTOPT_HAS_MEMORY_RESOURCE
+  // Take the memory of a parse from `memory_resource`, e.g., an arena:
+  // the arguments, their tokens, and every std::pmr container or string in
+  // the parsed struct. The resource has to outlive the parsed struct.
+  app &memory_resource(std::pmr::memory_resource *memory_resource) {
+    resource = memory_resource;
+    return *this;
+  }
+#endif
+
+  // The parser works on views over the arguments; they are not copied
+  template <typename T> T parse(const std::vector<std::string> &arguments) const {
+    details::argument_list list(arguments.begin(), arguments.end(), resource);
+    return parse<T>(list);
+  }
+
+  template <typename T> T parse(const std::vector<std::string_view> &arguments) const {
+    details::argument_list list(arguments.begin(), arguments.end(), resource);
+    return parse<T>(list);
+  }
+
+  // Also prints the candidates or the script and exits when the program is
+  // run as `<program> __complete <words...>`, see complete(), or with
+  // `--structopt-completion <shell> [<program>]`, see completion_script()
+  template <typename T> T parse(int argc, char *argv[]) const {
+    details::argument_list list(argv, argv + argc, resource);
+    return parse_command_line<T>(list);
+  }
 
-      if (help == true) {
-        // if help is requested, print help and exit
-        visitor.print_help(std::cout);
-        exit(EXIT_SUCCESS);
-      } else if (version == true) {
-        // if version is requested, print version and exit
-        std::cout << visitor.version << "\n";
-        exit(EXIT_SUCCESS);
+  // Parse arguments as they are read, e.g., from std::istream_iterator<std::string>
+  // Like argv, the first argument is the name of the program. Container
+  // fields take their values as they are read; the arguments they are done
+  // with are released, so the input is never held in memory as a whole.
+  template <typename T, typename InputIterator>
+  T parse(InputIterator first, InputIterator last) const {
+    details::argument_list list(resource);
+    list.source = [first, last](std::string &next) mutable {
+      if (first == last) {
+        return false;
+      }
+      next = std::string{std::string_view{*first}};
+      ++first;
+      return true;
+    };
+    return parse<T>(list);
+  }
+
+  // Parse arguments as they are returned by `next_argument`, a function
+  // that returns a std::optional of a string, or std::nullopt at the end
+  template <typename T, typename Generator,
+            typename = std::enable_if_t<std::is_invocable<Generator &>::value>>
+  T parse(Generator &&next_argument) const {
+    details::argument_list list(resource);
+    list.source = [&next_argument](std::string &next) {
+      auto result = next_argument();
+      if (!result.has_value()) {
+        return false;
+      }
+      if constexpr (std::is_same<std::decay_t<decltype(*result)>, std::string>::value) {
+        next = std::move(*result);
+      } else {
+        next = std::string{std::string_view{*result}};
       }
+      return true;
+    };
+    return parse<T>(list);
+  }
+
+  // Like parse, but errors are returned instead of thrown, and a request for
+  // the help or the version is returned instead of printed before exiting
+  template <typename T>
+  parse_result<T> try_parse(const std::vector<std::string> &arguments) const {
+    details::argument_list list(arguments.begin(), arguments.end(), resource);
+    return try_parse<T>(list);
+  }
+
+  template <typename T>
+  parse_result<T> try_parse(const std::vector<std::string_view> &arguments) const {
+    details::argument_list list(arguments.begin(), arguments.end(), resource);
+    return try_parse<T>(list);
+  }
+
+  // A completion, like the help, is returned instead of printed; see
+  // parse_status::completion_requested
+  template <typename T> parse_result<T> try_parse(int argc, char *argv[]) const {
+    details::argument_list list(argv, argv + argc, resource);
+    return try_parse_command_line<T>(list);
+  }
+
+  std::string help() const {
+    auto help_visitor = visitor;
+    help_visitor.schema = schema.load(std::memory_order_acquire);
+    return help_visitor.help();
+  }
+
+  // A static completion script for the arguments of `T`, for bash, zsh or
+  // fish; completing an argument does not run the program.
+  //
+  // The script completes the arguments of `program`, the name the program is
+  // run by, e.g., the name of its executable; by default, the name of the app.
+  //
+  // Running the program with `--structopt-completion <shell> [<program>]` as
+  // its only arguments prints the script, for the name it was run by if
+  // `program` is not given, if it parses argc and argv; see
+  // structopt_add_completion in CMake.
+  template <typename T>
+  std::string completion_script(completion_shell shell,
+                                const std::string &program = "") const {
+    return details::completion_script<T>(shell, program.empty() ? visitor.name : program);
+  }
+
+  // The candidates for the last of `words`, the word at the cursor, after
+  // the words before it; the words do not include the name of the program
+  //
+  // Only the words before the cursor are looked at, and their values are not
+  // converted. Running the program as `<program> __complete <words...>`
+  // prints the candidates, one per line, if it parses argc and argv.
+  template <typename T>
+  std::vector<std::string> complete(const std::vector<std::string_view> &words) const {
+    if (words.empty()) {
+      return complete<T>(std::vector<std::string_view>{""});
     }
+    details::completion_request request{words, &completers, "", {}};
+    details::complete_words<T>(request, 0);
+    return std::move(request.candidates);
+  }
 
-    // if all positional arguments were provided
-    // this list would be empty
-    if (!parser.visitor.positional_field_names.empty()) {
-      for (auto &field_name : parser.visitor.positional_field_names) {
-        if (std::find(parser.visitor.vector_like_positional_field_names.begin(),
-                      parser.visitor.vector_like_positional_field_names.end(),
-                      field_name) ==
-            parser.visitor.vector_like_positional_field_names.end()) {
-          // this positional argument is not a vector-like argument
-          // it expects value(s)
-          throw structopt::exception("Error: expected value for positional argument `" +
-                                         field_name + "`.",
-                                     parser.visitor);
-        }
+private:
+  // What to print for `<program> __complete <words...>` or
+  // `--structopt-completion <shell> [<program>]`, or std::nullopt for any
+  // other arguments
+  template <typename T>
+  std::optional<std::string> completion_output(details::argument_list &arguments) const {
+    if (arguments.has(1) && arguments[1] == "__complete") {
+      std::vector<std::string_view> words;
+      for (std::size_t i = 2; arguments.has(i); i++) {
+        words.push_back(arguments[i]);
+      }
+      std::string result;
+      for (const auto &candidate : complete<T>(words)) {
+        result += candidate;
+        result += '\n';
+      }
+      return result;
+    }
+    if (arguments.has(2) && !arguments.has(4) &&
+        arguments[1] == "--structopt-completion") {
+      if (auto shell = details::completion_shell_named(arguments[2])) {
+        const auto program = arguments.has(3)
+                                 ? std::string(arguments[3])
+                                 : details::completion_program_name(arguments[0]);
+        return completion_script<T>(*shell, program);
       }
     }
+    return std::nullopt;
+  }
+
+  // Only the command line of the program, its argc and argv, can ask for a
+  // completion, which is printed before the program exits. Other argument
+  // lists, e.g., command lines received from elsewhere, are always parsed.
+  template <typename T> T parse_command_line(details::argument_list &arguments) const {
+    if (auto output = completion_output<T>(arguments)) {
+      std::cout << *output;
+      exit(EXIT_SUCCESS);
+    }
+    return parse<T>(arguments);
+  }
+
+  template <typename T>
+  parse_result<T> try_parse_command_line(details::argument_list &arguments) const {
+    if (auto output = completion_output<T>(arguments)) {
+      return parse_result<T>(details::parse_stop{parse_status::completion_requested,
+                                                 error_code::invalid_value,
+                                                 exception::npos, std::move(*output)});
+    }
+    return try_parse<T>(arguments);
+  }
 
+  template <typename T> T parse(details::argument_list &arguments) const {
+    T argument_struct = T();
+    auto parser = make_parser<T>(arguments);
+    parser.parse_fields(argument_struct);
     return argument_struct;
   }
 
-  template <typename T> T parse(int argc, char *argv[]) {
-    std::vector<std::string> arguments;
-    std::copy(argv, argv + argc, std::back_inserter(arguments));
-    return parse<T>(arguments);
+  template <typename T>
+  parse_result<T> try_parse(details::argument_list &arguments) const {
+    T argument_struct = T();
+    auto parser = make_parser<T>(arguments);
+    parser.throws = false;
+    parser.parse_fields(argument_struct);
+    if (parser.stop) {
+      return parse_result<T>(std::move(*parser.stop));
+    }
+    return parse_result<T>(std::move(argument_struct));
   }
 
-  std::string help() const {
-    std::stringstream os;
-    visitor.print_help(os);
-    return os.str();
+  template <typename T>
+  details::parser make_parser(details::argument_list &arguments) const {
+    // `@path` stands for the arguments in the file at `path`
+    if (expands_response_files) {
+      arguments.expand_response_files();
+    }
+
+    // The fields of the struct are described at compile time
+    // Only the first parse of a struct writes, so that threads that share
+    // the app do not take turns at the cache line of `schema`
+    const auto &struct_schema = details::schema_of<T>();
+    if (schema.load(std::memory_order_relaxed) != &struct_schema) {
+      schema.store(&struct_schema, std::memory_order_release);
+    }
+
+    // Construct the argument parser, with its own copy of the visitor
+    structopt::details::parser parser(visitor, arguments);
+    parser.visitor.schema = &struct_schema;
+    parser.schema = &struct_schema;
+    parser.parallel_threshold = parallel_threshold;
+    parser.parallel_threads = parallel_threads;
+    parser.resource = resource;
+    parser.environment = fallback_environment.get();
+    parser.config_files = &config_files;
+    return parser;
+  }
+};
+
+// A parser for one STRUCTOPT struct, built once for programs that parse
+// many command lines, e.g., a job dispatcher
+//
+// Unlike an app, a parser_for is not shared by threads; each thread that
+// parses at the same time needs its own.
+//
+// The schema of `T` is looked up when the parser is constructed, and the
+// memory for the arguments and their tokens is kept from one parse to the
+// next, so a parse only allocates for the fields it fills.
+template <typename T> class parser_for {
+  app app_;
+  details::argument_list arguments_;
+
+public:
+  explicit parser_for(const std::string &name, const std::string &version = "")
+      : app_(name, version) {
+    app_.schema.store(&details::schema_of<T>(), std::memory_order_release);
+  }
+
+  // see app::parallel_conversion
+  parser_for &parallel_conversion(std::size_t threshold = 100000,
+                                  std::size_t threads = 0) {
+    app_.parallel_conversion(threshold, threads);
+    return *this;
+  }
+
+  // see app::response_files
+  parser_for &response_files(bool enabled = true) {
+    app_.response_files(enabled);
+    return *this;
+  }
+
+  // see app::environment
+  parser_for &environment(const std::string &prefix) {
+    app_.environment(prefix);
+    return *this;
+  }
+
+  // see app::config_file
+  parser_for &config_file(const std::string &path) {
+    app_.config_file(path);
+    return *this;
   }
+
+  // see app::completer
+  parser_for &completer(const std::string &field, structopt::completer complete) {
+    app_.completer(field, std::move(complete));
+    return *this;
+  }
+
+  T parse(const std::vector<std::string> &arguments) {
+    arguments_.assign(arguments.begin(), arguments.end());
+    return app_.parse<T>(arguments_);
+  }
+
+  T parse(const std::vector<std::string_view> &arguments) {
+    arguments_.assign(arguments.begin(), arguments.end());
+    return app_.parse<T>(arguments_);
+  }
+
+  T parse(int argc, char *argv[]) {
+    arguments_.assign(argv, argv + argc);
+    return app_.parse_command_line<T>(arguments_);
+  }
+
+  parse_result<T> try_parse(const std::vector<std::string> &arguments) {
+    arguments_.assign(arguments.begin(), arguments.end());
+    return app_.try_parse<T>(arguments_);
+  }
+
+  parse_result<T> try_parse(const std::vector<std::string_view> &arguments) {
+    arguments_.assign(arguments.begin(), arguments.end());
+    return app_.try_parse<T>(arguments_);
+  }
+
+  parse_result<T> try_parse(int argc, char *argv[]) {
+    arguments_.assign(argv, argv + argc);
+    return app_.try_parse_command_line<T>(arguments_);
+  }
+
+  // Forgets the arguments of the last parse, e.g., to release the response
+  // files it read. Their memory is kept for the next parse.
+  void reset() { arguments_.clear(); }
+
+  std::string help() const { return app_.help(); }
 };
 
 } // namespace structopt
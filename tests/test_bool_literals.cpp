@@ -0,0 +1,36 @@
+#include <doctest.hpp>
+#include <structopt/app.hpp>
+
+using doctest::test_suite;
+
+// Built on its own: the spellings of booleans are those of the whole program
+template <> struct structopt::bool_literals<> {
+  static constexpr std::string_view true_literals[] = {"true", "enabled"};
+  static constexpr std::string_view false_literals[] = {"false", "disabled"};
+};
+
+struct FeatureOptions {
+  std::optional<bool> cache;
+  bool compression = true;
+};
+STRUCTOPT(FeatureOptions, cache, compression);
+
+TEST_CASE("structopt parses the boolean spellings of a bool_literals specialization" * test_suite("bool_literals")) {
+  auto arguments = structopt::app("test").parse<FeatureOptions>(
+      std::vector<std::string>{"./main", "--cache", "Enabled", "disabled"});
+  REQUIRE(arguments.cache == true);
+  REQUIRE(arguments.compression == false);
+
+  arguments = structopt::app("test").parse<FeatureOptions>(
+      std::vector<std::string>{"./main", "--cache=FALSE", "true"});
+  REQUIRE(arguments.cache == false);
+  REQUIRE(arguments.compression == true);
+}
+
+TEST_CASE("structopt rejects the default spellings a specialization leaves out" * test_suite("bool_literals")) {
+  auto result = structopt::app("test").try_parse<FeatureOptions>(
+      std::vector<std::string>{"./main", "--cache", "yes", "true"});
+  REQUIRE(result.status() == structopt::parse_status::error);
+  REQUIRE(result.code() == structopt::error_code::invalid_value);
+  REQUIRE(result.index() == 2);
+}
@@ -52,4 +52,23 @@ TEST_CASE("structopt can parse combined optional and flag arguments" * test_suit
     REQUIRE(arguments.b == false);
     REQUIRE(arguments.c == std::array<float, 2>{3.14f, 2.718f});
   }
-}
\ No newline at end of file
+}
+
+TEST_CASE("structopt allows only the last combined flag to take a value" * test_suite("combined_optional")) {
+  {
+    auto arguments = structopt::app("test").parse<FlagAndOptionArguments>(std::vector<std::string>{"./main", "-abc", "1", "2", "-a"});
+    REQUIRE(arguments.a == false);
+    REQUIRE(arguments.b == true);
+    REQUIRE(arguments.c == std::array<float, 2>{1.0f, 2.0f});
+  }
+  {
+    bool exception_thrown = false;
+    try {
+      structopt::app("test").parse<FlagAndOptionArguments>(std::vector<std::string>{"./main", "-ca", "3.14", "2.718"});
+    }
+    catch (structopt::exception&) {
+      exception_thrown = true;
+    }
+    REQUIRE(exception_thrown == true);
+  }
+}
@@ -0,0 +1,229 @@
+#include <doctest.hpp>
+#include <structopt/app.hpp>
+
+using doctest::test_suite;
+
+struct CompletedOptions {
+  enum class Level { debug, info, warning };
+  struct Build : structopt::sub_command {
+    struct Test : structopt::sub_command {
+      std::optional<std::string> filter;
+    };
+    std::optional<Level> level;
+    std::optional<bool> release = false;
+    Test test;
+  };
+  std::optional<std::string> log_file;
+  std::optional<bool> verbose = false;
+  std::optional<bool> version_check = false;
+  std::vector<Level> levels;
+  Build build;
+};
+STRUCTOPT(CompletedOptions::Build::Test, filter);
+STRUCTOPT(CompletedOptions::Build, level, release, test);
+STRUCTOPT(CompletedOptions, log_file, verbose, version_check, levels, build);
+
+static bool contains(const std::string &script, const std::string &text) {
+  return script.find(text) != std::string::npos;
+}
+
+TEST_CASE("structopt describes the arguments to complete" * test_suite("completion")) {
+  const auto command =
+      structopt::details::describe_completion<CompletedOptions>("my-app", "");
+  REQUIRE(command.name == "my-app");
+  REQUIRE(command.options.size() == 5);
+  REQUIRE(command.options[0].name == "log-file");
+  REQUIRE(command.options[0].short_name == 'l');
+  REQUIRE(command.options[0].takes_value);
+  REQUIRE(command.options[0].values.empty());
+  REQUIRE(command.options[1].name == "verbose");
+  REQUIRE(command.options[1].short_name == 'v');
+  REQUIRE(command.options[1].takes_value == false);
+  // -v belongs to verbose
+  REQUIRE(command.options[2].name == "version-check");
+  REQUIRE(command.options[2].short_name == 0);
+  REQUIRE(command.options[3].name == "help");
+  REQUIRE(command.options[3].short_name == 'h');
+  REQUIRE(command.options[4].name == "version");
+  REQUIRE(command.options[4].short_name == 0);
+  REQUIRE(command.values == std::vector<std::string_view>{"debug", "info", "warning"});
+  REQUIRE(command.takes_files == false);
+
+  REQUIRE(command.sub_commands.size() == 1);
+  const auto &build = command.sub_commands[0];
+  REQUIRE(build.name == "build");
+  REQUIRE(build.path == "build");
+  REQUIRE(build.options[0].name == "level");
+  REQUIRE(build.options[0].values ==
+          std::vector<std::string_view>{"debug", "info", "warning"});
+  REQUIRE(build.sub_commands.size() == 1);
+  REQUIRE(build.sub_commands[0].path == "build.test");
+}
+
+TEST_CASE("structopt writes a bash completion script" * test_suite("completion")) {
+  const auto script = structopt::app("my-app").completion_script<CompletedOptions>(
+      structopt::completion_shell::bash);
+  REQUIRE(contains(script, "_my_app() {"));
+  REQUIRE(contains(script, "\":build\") command=\"build\" ;;"));
+  REQUIRE(contains(script, "\"build:test\") command=\"build.test\" ;;"));
+  REQUIRE(contains(script, "\"build:--level\"|\"build:-l\")\n"
+                           "      COMPREPLY=($(compgen -W \"debug info warning\""));
+  REQUIRE(contains(script, "\":--log-file\"|\":-l\")\n"
+                           "      COMPREPLY=($(compgen -f"));
+  REQUIRE(contains(script, "--log-file -l --verbose -v --version-check --help -h "
+                           "--version build debug info warning"));
+  REQUIRE(contains(script, "\"build.test\")"));
+  REQUIRE(contains(script, "complete -F _my_app my-app\n"));
+}
+
+TEST_CASE("structopt writes a zsh completion script" * test_suite("completion")) {
+  const auto script = structopt::app("my-app").completion_script<CompletedOptions>(
+      structopt::completion_shell::zsh);
+  REQUIRE(script.rfind("#compdef my-app\n", 0) == 0);
+  REQUIRE(contains(script, "compadd -- debug info warning"));
+  REQUIRE(contains(script, "_files"));
+  REQUIRE(contains(script, "compdef _my_app my-app"));
+}
+
+TEST_CASE("structopt writes a fish completion script" * test_suite("completion")) {
+  const auto script = structopt::app("my-app").completion_script<CompletedOptions>(
+      structopt::completion_shell::fish);
+  REQUIRE(contains(script, "complete -c my-app -n 'not __fish_seen_subcommand_from "
+                           "build' -l log-file -s l -r -F\n"));
+  REQUIRE(contains(script, "complete -c my-app -n 'not __fish_seen_subcommand_from "
+                           "build' -f -a build\n"));
+  REQUIRE(contains(script, "complete -c my-app -n '__fish_seen_subcommand_from build; "
+                           "and not __fish_seen_subcommand_from test' -l level -s l -r -f "
+                           "-a 'debug info warning'\n"));
+  REQUIRE(contains(script, "complete -c my-app -n '__fish_seen_subcommand_from test' -l "
+                           "filter -s f -r -F\n"));
+}
+
+TEST_CASE("structopt registers a completion script for the name of the program" * test_suite("completion")) {
+  const auto app = structopt::app("My App");
+  const auto bash = app.completion_script<CompletedOptions>(
+      structopt::completion_shell::bash, "enum_class_argument");
+  REQUIRE(contains(bash, "_enum_class_argument() {"));
+  REQUIRE(contains(bash, "\ncomplete -F _enum_class_argument enum_class_argument\n"));
+  REQUIRE(!contains(bash, "My App"));
+
+  const auto zsh = app.completion_script<CompletedOptions>(structopt::completion_shell::zsh,
+                                                           "enum_class_argument");
+  REQUIRE(zsh.rfind("#compdef enum_class_argument\n", 0) == 0);
+  REQUIRE(contains(zsh, "compdef _enum_class_argument enum_class_argument\n"));
+
+  const auto fish = app.completion_script<CompletedOptions>(
+      structopt::completion_shell::fish, "enum_class_argument");
+  REQUIRE(contains(fish, "\ncomplete -c enum_class_argument -n "));
+  REQUIRE(!contains(fish, "complete -c My"));
+
+  // run as --structopt-completion <shell>, a program completes the name it is run by
+  REQUIRE(structopt::details::completion_program_name("./build/bin/my-app") == "my-app");
+  REQUIRE(structopt::details::completion_program_name("C:\\tools\\my-app.exe") == "my-app");
+  REQUIRE(structopt::details::completion_program_name("my-app") == "my-app");
+}
+
+struct DeployOptions {
+  enum class Region { us_east, us_west, eu };
+  struct Rollback : structopt::sub_command {
+    std::optional<std::string> release;
+    Region region = Region::eu;
+  };
+  std::optional<Region> region;
+  std::optional<std::string> target;
+  std::optional<bool> dry_run = false;
+  int replicas = 0;
+  std::vector<std::string> hosts;
+  Rollback rollback;
+};
+STRUCTOPT(DeployOptions::Rollback, release, region);
+STRUCTOPT(DeployOptions, region, target, dry_run, replicas, hosts, rollback);
+
+using candidates = std::vector<std::string>;
+
+TEST_CASE("structopt completes the word at the cursor" * test_suite("completion")) {
+  auto app = structopt::app("deploy");
+  REQUIRE(app.complete<DeployOptions>({"--d"}) == candidates{"--dry-run"});
+  REQUIRE(app.complete<DeployOptions>({"--"}) ==
+          candidates{"--region", "--target", "--dry-run", "--help", "--version"});
+  REQUIRE(app.complete<DeployOptions>({"--region", "us"}) ==
+          candidates{"us_east", "us_west"});
+  REQUIRE(app.complete<DeployOptions>({"-r", ""}) ==
+          candidates{"us_east", "us_west", "eu"});
+  REQUIRE(app.complete<DeployOptions>({"--region=e"}) == candidates{"--region=eu"});
+  REQUIRE(app.complete<DeployOptions>({"r"}) == candidates{"rollback"});
+  REQUIRE(app.complete<DeployOptions>({}) == candidates{"rollback"});
+
+  // values before the cursor are not converted, so invalid ones do not matter
+  REQUIRE(app.complete<DeployOptions>(
+              {"--region", "moon", "not-a-number", "rollback", ""}) == candidates{"us_east", "us_west", "eu"});
+  REQUIRE(app.complete<DeployOptions>({"rollback", "eu", ""}).empty());
+  REQUIRE(app.complete<DeployOptions>({"rollback", "--"}) ==
+          candidates{"--release", "--help", "--version"});
+  // after `--`, there are only positional arguments
+  REQUIRE(app.complete<DeployOptions>({"--", "--"}).empty());
+}
+
+TEST_CASE("structopt completes values with a completer" * test_suite("completion")) {
+  std::vector<std::string> prefixes;
+  auto app = structopt::app("deploy");
+  app.completer("target", [&prefixes](std::string_view prefix) {
+       prefixes.emplace_back(prefix);
+       return candidates{"staging", "production", "preview"};
+     })
+      .completer("rollback.release", [](std::string_view) {
+        return candidates{"v1.0", "v1.1", "v2.0"};
+      });
+  REQUIRE(app.complete<DeployOptions>({"--target", "p"}) ==
+          candidates{"production", "preview"});
+  REQUIRE(app.complete<DeployOptions>({"--target=s"}) == candidates{"--target=staging"});
+  REQUIRE(prefixes == candidates{"p", "s"});
+  REQUIRE(app.complete<DeployOptions>({"rollback", "--release", "v1"}) ==
+          candidates{"v1.0", "v1.1"});
+  // an option of another command is not completed
+  REQUIRE(app.complete<DeployOptions>({"rollback", "--target", "p"}).empty());
+}
+
+TEST_CASE("structopt completes only the command line of the program" * test_suite("completion")) {
+  // a command line received from elsewhere is parsed, and the process does not exit
+  bool exception_thrown = false;
+  try {
+    structopt::app("deploy").parse<DeployOptions>(
+        std::vector<std::string>{"./main", "__complete", "--d"});
+  } catch (structopt::exception &e) {
+    exception_thrown = true;
+    REQUIRE(e.index() == 1);
+  }
+  REQUIRE(exception_thrown);
+
+  auto arguments = structopt::parser_for<DeployOptions>("deploy").parse(
+      std::vector<std::string>{"./main", "3", "__complete"});
+  REQUIRE(arguments.replicas == 3);
+  REQUIRE(arguments.hosts == std::vector<std::string>{"__complete"});
+}
+
+TEST_CASE("structopt returns a completion from try_parse of the command line" * test_suite("completion")) {
+  const auto app = structopt::app("deploy");
+  {
+    char program[] = "./bin/deploy", flag[] = "--structopt-completion", shell[] = "fish";
+    char *argv[] = {program, flag, shell};
+    const auto result = app.try_parse<DeployOptions>(3, argv);
+    REQUIRE(result.status() == structopt::parse_status::completion_requested);
+    REQUIRE(result.message() ==
+            app.completion_script<DeployOptions>(structopt::completion_shell::fish, "deploy"));
+  }
+  {
+    char program[] = "./deploy", mode[] = "__complete", word[] = "--d";
+    char *argv[] = {program, mode, word};
+    const auto result = structopt::parser_for<DeployOptions>("deploy").try_parse(3, argv);
+    REQUIRE(result.status() == structopt::parse_status::completion_requested);
+    REQUIRE(result.message() == "--dry-run\n");
+  }
+  {
+    // a command line received from elsewhere is parsed
+    const auto result = app.try_parse<DeployOptions>(
+        std::vector<std::string>{"./main", "--structopt-completion", "bash"});
+    REQUIRE(result.status() == structopt::parse_status::error);
+    REQUIRE(result.message().find("`bash`") != std::string::npos);
+  }
+}
@@ -0,0 +1,57 @@
+#include <atomic>
+#include <doctest.hpp>
+#include <structopt/app.hpp>
+#include <thread>
+
+using doctest::test_suite;
+
+enum class ConcurrentLevel { low, high };
+
+struct ConcurrentCommand {
+  struct Run : structopt::sub_command {
+    std::optional<ConcurrentLevel> level;
+    std::vector<int> jobs;
+  };
+  Run run;
+  std::optional<bool> verbose = false;
+  std::optional<std::string> name;
+};
+STRUCTOPT(ConcurrentCommand::Run, level, jobs);
+STRUCTOPT(ConcurrentCommand, run, verbose, name);
+
+TEST_CASE("structopt apps can be shared by threads that parse at the same time" * test_suite("concurrent_parse")) {
+  const structopt::app app("dispatch");
+  std::atomic<std::size_t> failures{0};
+
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; t++) {
+    threads.emplace_back([&app, &failures, t] {
+      for (int i = 0; i < 500; i++) {
+        const auto job = std::to_string(t * 1000 + i);
+        if (i % 5 == 0) {
+          // an error
+          const auto result = app.try_parse<ConcurrentCommand>(
+              std::vector<std::string>{"./main", "run", "--level", "medium"});
+          if (result || result.index() != 3) {
+            failures += 1;
+          }
+          continue;
+        }
+        const auto arguments = app.parse<ConcurrentCommand>(std::vector<std::string>{
+            "./main", "-v", "--name", job, "run", "--level", "high", job, "7"});
+        if (arguments.name != job || arguments.verbose != true ||
+            arguments.run.level != ConcurrentLevel::high ||
+            arguments.run.jobs != std::vector<int>{t * 1000 + i, 7}) {
+          failures += 1;
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  REQUIRE(failures == 0);
+  REQUIRE(app.help().find("USAGE: dispatch [FLAGS] [OPTIONS] [SUBCOMMANDS]") !=
+          std::string::npos);
+}
@@ -0,0 +1,119 @@
+#include <cstdio>
+#include <doctest.hpp>
+#include <fstream>
+#include <structopt/app.hpp>
+
+using doctest::test_suite;
+
+struct ConfiguredOptions {
+  struct Build : structopt::sub_command {
+    std::optional<std::string> target;
+    std::optional<std::vector<int>> jobs;
+  };
+  std::optional<std::string> log_level;
+  std::optional<int> retries;
+  std::optional<bool> verbose = false;
+  std::optional<std::string> name;
+  std::string input;
+  Build build;
+};
+STRUCTOPT(ConfiguredOptions::Build, target, jobs);
+STRUCTOPT(ConfiguredOptions, log_level, retries, verbose, name, input, build);
+
+static std::string write_config_file(const std::string &name, const std::string &contents) {
+  const auto path = "structopt_" + name + ".ini";
+  std::ofstream file(path, std::ios::binary);
+  file << contents;
+  return path;
+}
+
+TEST_CASE("structopt indexes the keys of a config file" * test_suite("config_file")) {
+  const std::string contents = "# comment\r\n"
+                               "; another comment\n"
+                               "  log-level =  debug  \n"
+                               "verbose\n"
+                               "name = \"my name\"\n"
+                               "retries=1\n"
+                               "retries=2\n"
+                               "\n"
+                               "[ build ]\n"
+                               "target = 'release'\n"
+                               "[build.test]\n"
+                               "filter=a=b";
+  structopt::details::config_file file(contents, "app.ini");
+  REQUIRE(file.path() == "app.ini");
+  REQUIRE(file.find("", "log_level") != nullptr);
+  REQUIRE(file.find("", "log_level")->value == "debug");
+  REQUIRE(file.find("", "log_level")->line == 3);
+  REQUIRE(file.find("", "verbose")->value == "true");
+  REQUIRE(file.find("", "name")->value == "my name");
+  REQUIRE(file.find("", "retries")->value == "2");
+  REQUIRE(file.find("", "retries")->line == 7);
+  REQUIRE(file.find("", "target") == nullptr);
+  REQUIRE(file.find("build.", "target")->value == "release");
+  REQUIRE(file.find("build.", "log-level") == nullptr);
+  REQUIRE(file.find("build.test.", "filter")->value == "a=b");
+  REQUIRE(file.find("", "comment") == nullptr);
+}
+
+TEST_CASE("structopt falls back to config files for options that are not provided" * test_suite("config_file")) {
+  const auto system = write_config_file("system", "log_level = warning\n"
+                                                  "retries = 3\n"
+                                                  "[build]\n"
+                                                  "jobs = 4\n");
+  const auto user = write_config_file("user", "log-level = info\n"
+                                              "verbose = yes\n"
+                                              "[build]\n"
+                                              "target = debug\n");
+  auto app = structopt::app("test");
+  app.config_file(system).config_file(user).config_file("structopt_missing.ini");
+  {
+    auto arguments = app.parse<ConfiguredOptions>(std::vector<std::string>{"./main", "in.csv"});
+    REQUIRE(arguments.log_level == "info");
+    REQUIRE(arguments.retries == 3);
+    REQUIRE(arguments.verbose == true);
+    REQUIRE(arguments.name.has_value() == false);
+    REQUIRE(arguments.input == "in.csv");
+    REQUIRE(arguments.build.has_value() == false);
+  }
+  {
+    auto arguments = app.parse<ConfiguredOptions>(std::vector<std::string>{
+        "./main", "--log-level", "error", "--retries=0", "in.csv", "build", "--target",
+        "release"});
+    REQUIRE(arguments.log_level == "error");
+    REQUIRE(arguments.retries == 0);
+    REQUIRE(arguments.build.has_value());
+    REQUIRE(arguments.build.target == "release");
+    REQUIRE(arguments.build.jobs == std::vector<int>{4});
+  }
+  std::remove(system.c_str());
+  std::remove(user.c_str());
+
+  // the files were read when they were added
+  auto arguments = app.parse<ConfiguredOptions>(std::vector<std::string>{"./main", "in.csv"});
+  REQUIRE(arguments.log_level == "info");
+}
+
+TEST_CASE("structopt names the config file with an invalid value" * test_suite("config_file")) {
+  const auto path = write_config_file("invalid", "log-level = debug\n\nretries = many\n");
+  auto app = structopt::app("test");
+  app.config_file(path);
+  std::remove(path.c_str());
+  {
+    auto result = app.try_parse<ConfiguredOptions>(std::vector<std::string>{"./main", "in.csv"});
+    REQUIRE(result.status() == structopt::parse_status::error);
+    REQUIRE(result.code() == structopt::error_code::invalid_value);
+  }
+  {
+    bool exception_thrown = false;
+    try {
+      app.parse<ConfiguredOptions>(std::vector<std::string>{"./main", "in.csv"});
+    } catch (structopt::exception &e) {
+      exception_thrown = true;
+      REQUIRE(std::string{e.what()} ==
+              "Error: failed to correctly parse argument `retries`. `many` is not a number. The "
+              "value is from `" + path + "`, line 3.");
+    }
+    REQUIRE(exception_thrown);
+  }
+}
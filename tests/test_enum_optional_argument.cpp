@@ -44,4 +44,36 @@ TEST_CASE("structopt can parse enum class optional argument" * test_suite("enum_
     REQUIRE(arguments.color == MultipleEnumOptionalArguments::Color::green);
     REQUIRE(arguments.text_align == MultipleEnumOptionalArguments::TextAlign::middle);
   }
-}
\ No newline at end of file
+}
+
+struct CaseInsensitiveEnumArguments {
+  enum class Codec { H264, H265, VP8, VP9, AV1, MPEG2, MPEG4, Theora, ProRes, DNxHD };
+  std::optional<Codec> codec;
+  std::optional<MultipleEnumOptionalArguments::Color> color;
+};
+STRUCTOPT(CaseInsensitiveEnumArguments, codec, color);
+
+template <> struct structopt::case_insensitive_enum<CaseInsensitiveEnumArguments::Codec> : std::true_type {};
+
+TEST_CASE("structopt can match enum names regardless of case" * test_suite("enum_optional")) {
+  {
+    auto arguments = structopt::app("test").parse<CaseInsensitiveEnumArguments>(std::vector<std::string>{"./main", "--codec", "prores", "--color", "blue"});
+    REQUIRE(arguments.codec == CaseInsensitiveEnumArguments::Codec::ProRes);
+    REQUIRE(arguments.color == MultipleEnumOptionalArguments::Color::blue);
+  }
+  {
+    auto arguments = structopt::app("test").parse<CaseInsensitiveEnumArguments>(std::vector<std::string>{"./main", "--codec", "Vp9"});
+    REQUIRE(arguments.codec == CaseInsensitiveEnumArguments::Codec::VP9);
+  }
+  {
+    // only enums that opt in ignore case
+    std::string what;
+    try {
+      structopt::app("test").parse<CaseInsensitiveEnumArguments>(std::vector<std::string>{"./main", "--color", "Blue"});
+    }
+    catch (structopt::exception& e) {
+      what = e.what();
+    }
+    REQUIRE(what == "Error: unexpected input `Blue` provided for enum argument `color`. Allowed values are {red, blue, green}");
+  }
+}
@@ -0,0 +1,128 @@
+#include <cstdlib>
+#include <doctest.hpp>
+#include <structopt/app.hpp>
+
+using doctest::test_suite;
+
+static void set_environment_variable(const char *name, const char *value) {
+#ifdef _WIN32
+  _putenv_s(name, value);
+#else
+  setenv(name, value, 1);
+#endif
+}
+
+struct ServiceOptions {
+  struct Build : structopt::sub_command {
+    std::optional<std::string> target;
+  };
+  std::optional<std::string> log_level;
+  std::optional<int> jobs;
+  std::optional<bool> verbose = false;
+  std::optional<std::string> name;
+  std::string input;
+  Build build;
+};
+STRUCTOPT(ServiceOptions::Build, target);
+STRUCTOPT(ServiceOptions, log_level, jobs, verbose, name, input, build);
+
+TEST_CASE("structopt indexes the environment variables with a prefix" * test_suite("environment")) {
+  std::string variables[] = {"APP_LOG_LEVEL=debug", "APP_JOBS=4", "OTHER=x", "APP_=y",
+                             "APP_URL=a=b", "APP_JOBS=5"};
+  char *environment[] = {variables[0].data(), variables[1].data(), variables[2].data(),
+                         variables[3].data(), variables[4].data(), variables[5].data(),
+                         nullptr};
+  structopt::details::environment_index index("app", environment);
+  REQUIRE(index.find("", "log_level") == "debug");
+  REQUIRE(index.find("", "log-level") == "debug");
+  REQUIRE(index.find("", "jobs") == "4");
+  REQUIRE(index.find("", "url") == "a=b");
+  REQUIRE(index.find("", "other").has_value() == false);
+  REQUIRE(index.find("", "").has_value() == false);
+  REQUIRE(index.find("log_", "level").has_value() == true);
+  REQUIRE(index.name("build_", "log-level") == "APP_BUILD_LOG_LEVEL");
+
+  structopt::details::environment_index everything("", environment);
+  REQUIRE(everything.find("", "other") == "x");
+  REQUIRE(everything.find("app_", "jobs") == "4");
+}
+
+TEST_CASE("structopt falls back to the environment for options that are not provided" * test_suite("environment")) {
+  set_environment_variable("STRUCTOPT_TEST_LOG_LEVEL", "debug");
+  set_environment_variable("STRUCTOPT_TEST_JOBS", "4");
+  set_environment_variable("STRUCTOPT_TEST_VERBOSE", "true");
+  set_environment_variable("STRUCTOPT_TEST_INPUT", "ignored.csv");
+  set_environment_variable("STRUCTOPT_TEST_BUILD_TARGET", "release");
+  auto app = structopt::app("test");
+  app.environment("structopt_test");
+  {
+    auto arguments = app.parse<ServiceOptions>(
+        std::vector<std::string>{"./main", "--jobs", "8", "foo.csv"});
+    REQUIRE(arguments.log_level == "debug");
+    REQUIRE(arguments.jobs == 8);
+    REQUIRE(arguments.verbose == true);
+    REQUIRE(arguments.name.has_value() == false);
+    REQUIRE(arguments.input == "foo.csv");
+    REQUIRE(arguments.build.has_value() == false);
+  }
+  {
+    auto arguments = app.parse<ServiceOptions>(std::vector<std::string>{
+        "./main", "-l", "info", "--verbose", "foo.csv", "build"});
+    REQUIRE(arguments.log_level == "info");
+    REQUIRE(arguments.jobs == 4);
+    // the flag toggles its default; the environment is not looked at
+    REQUIRE(arguments.verbose == true);
+    REQUIRE(arguments.build.has_value());
+    REQUIRE(arguments.build.target == "release");
+  }
+  {
+    auto arguments = app.parse<ServiceOptions>(std::vector<std::string>{
+        "./main", "foo.csv", "build", "--target=debug"});
+    REQUIRE(arguments.build.target == "debug");
+  }
+}
+
+TEST_CASE("structopt reads the environment once" * test_suite("environment")) {
+  set_environment_variable("STRUCTOPT_ONCE_NAME", "first");
+  auto app = structopt::app("test");
+  app.environment("STRUCTOPT_ONCE");
+  set_environment_variable("STRUCTOPT_ONCE_NAME", "second");
+  auto arguments = app.parse<ServiceOptions>(std::vector<std::string>{"./main", "foo.csv"});
+  REQUIRE(arguments.name == "first");
+
+  // without app::environment, there is no fallback
+  arguments =
+      structopt::app("test").parse<ServiceOptions>(std::vector<std::string>{"./main", "foo.csv"});
+  REQUIRE(arguments.name.has_value() == false);
+}
+
+TEST_CASE("structopt names the environment variable with an invalid value" * test_suite("environment")) {
+  set_environment_variable("STRUCTOPT_ERROR_JOBS", "many");
+  auto app = structopt::app("test");
+  app.environment("STRUCTOPT_ERROR");
+  {
+    auto result = app.try_parse<ServiceOptions>(std::vector<std::string>{"./main", "foo.csv"});
+    REQUIRE(result.status() == structopt::parse_status::error);
+    REQUIRE(result.code() == structopt::error_code::invalid_value);
+    REQUIRE(result.message().find("STRUCTOPT_ERROR_JOBS") != std::string::npos);
+  }
+  {
+    bool exception_thrown = false;
+    try {
+      app.parse<ServiceOptions>(std::vector<std::string>{"./main", "foo.csv"});
+    } catch (structopt::exception &e) {
+      exception_thrown = true;
+      REQUIRE(std::string{e.what()} ==
+              "Error: failed to correctly parse argument `jobs`. `many` is not a number. The "
+              "value is from the environment variable `STRUCTOPT_ERROR_JOBS`.");
+    }
+    REQUIRE(exception_thrown);
+  }
+  {
+    // a value on the command line takes precedence
+    auto result = app.try_parse<ServiceOptions>(
+        std::vector<std::string>{"./main", "--jobs=2", "foo.csv"});
+    REQUIRE(result.has_value());
+    REQUIRE(result->jobs == 2);
+  }
+}
@@ -0,0 +1,63 @@
+#include <doctest.hpp>
+#include <structopt/app.hpp>
+
+using doctest::test_suite;
+
+struct ExceptionArguments {
+  std::optional<std::int16_t> level;
+  std::optional<bool> a = false;
+  std::optional<std::string> b;
+  int count = 0;
+};
+STRUCTOPT(ExceptionArguments, level, a, b, count);
+
+static structopt::exception parse_error(const std::vector<std::string> &arguments) {
+  try {
+    structopt::app("test").parse<ExceptionArguments>(arguments);
+  }
+  catch (structopt::exception& e) {
+    return e;
+  }
+  FAIL("expected structopt::exception");
+  return structopt::exception("", {});
+}
+
+TEST_CASE("structopt exceptions report an error code and the offending argument" * test_suite("exception")) {
+  {
+    auto e = parse_error({"./main", "5", "--level", "40000"});
+    REQUIRE(e.code() == structopt::error_code::out_of_range);
+    REQUIRE(e.index() == 3);
+  }
+  {
+    auto e = parse_error({"./main", "five"});
+    REQUIRE(e.code() == structopt::error_code::invalid_value);
+    REQUIRE(e.index() == 1);
+  }
+  {
+    auto e = parse_error({"./main", "5", "--level"});
+    REQUIRE(e.code() == structopt::error_code::missing_value);
+    REQUIRE(e.index() == structopt::exception::npos);
+  }
+  {
+    auto e = parse_error({"./main", "-ba", "x", "5"});
+    REQUIRE(e.code() == structopt::error_code::combined_flag_value);
+    REQUIRE(e.index() == 1);
+  }
+  {
+    auto e = parse_error({"./main", "--level", "1"});
+    REQUIRE(e.code() == structopt::error_code::missing_value);
+    REQUIRE(std::string{e.what()} == "Error: expected value for positional argument `count`.");
+  }
+}
+
+TEST_CASE("structopt exceptions carry the help" * test_suite("exception")) {
+  const auto e = parse_error({"./main", "five"});
+  const std::string help = e.help();
+  REQUIRE(help.find("USAGE: test [FLAGS] [OPTIONS] count") != std::string::npos);
+  REQUIRE(help.find("-l, --level <level>") != std::string::npos);
+  REQUIRE(std::string{e.help()} == help);
+
+  // a copy, e.g., one rethrown to another thread, has the same help
+  const structopt::exception copy = e;
+  REQUIRE(std::string{copy.help()} == help);
+}
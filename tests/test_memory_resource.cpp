@@ -0,0 +1,115 @@
+#include <doctest.hpp>
+#include <structopt/app.hpp>
+
+using doctest::test_suite;
+
+#ifdef STRUCTOPT_HAS_MEMORY_RESOURCE
+
+// Counts the allocations made through it
+class counting_resource : public std::pmr::memory_resource {
+  std::pmr::memory_resource *upstream = std::pmr::new_delete_resource();
+
+  void *do_allocate(std::size_t bytes, std::size_t alignment) override {
+    allocations += 1;
+    return upstream->allocate(bytes, alignment);
+  }
+
+  void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override {
+    upstream->deallocate(p, bytes, alignment);
+  }
+
+  bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+    return this == &other;
+  }
+
+public:
+  std::size_t allocations = 0;
+};
+
+struct ArenaOptions {
+  struct Build : structopt::sub_command {
+    std::pmr::vector<std::pmr::string> targets;
+  };
+  std::pmr::string input;
+  std::optional<std::pmr::vector<int>> jobs;
+  std::optional<std::pmr::string> output;
+  Build build;
+};
+STRUCTOPT(ArenaOptions::Build, targets);
+STRUCTOPT(ArenaOptions, input, jobs, output, build);
+
+TEST_CASE("structopt fills std::pmr fields from the memory resource of the app" * test_suite("memory_resource")) {
+  counting_resource resource;
+  auto arguments = structopt::app("test").memory_resource(&resource).parse<ArenaOptions>(
+      std::vector<std::string>{"./main", "--jobs", "1", "2", "--output", "out.txt",
+                               "my input file", "build", "all", "docs"});
+  REQUIRE(arguments.input == "my input file");
+  REQUIRE(arguments.input.get_allocator().resource() == &resource);
+  REQUIRE(arguments.jobs.has_value());
+  REQUIRE(*arguments.jobs == std::pmr::vector<int>{1, 2});
+  REQUIRE(arguments.jobs->get_allocator().resource() == &resource);
+  REQUIRE(arguments.output == std::pmr::string{"out.txt"});
+  REQUIRE(arguments.output->get_allocator().resource() == &resource);
+  REQUIRE(arguments.build.has_value());
+  REQUIRE(arguments.build.targets.size() == 2);
+  REQUIRE(arguments.build.targets[0] == "all");
+  REQUIRE(arguments.build.targets[1] == "docs");
+  REQUIRE(arguments.build.targets.get_allocator().resource() == &resource);
+  REQUIRE(arguments.build.targets[1].get_allocator().resource() == &resource);
+  REQUIRE(resource.allocations > 0);
+}
+
+TEST_CASE("structopt takes the memory of the arguments from the memory resource" * test_suite("memory_resource")) {
+  counting_resource resource;
+  auto arguments = structopt::app("test").memory_resource(&resource).parse<ArenaOptions>(
+      std::vector<std::string>{"./main", "input"});
+  REQUIRE(arguments.input == "input");
+  // the list of arguments and their tokens
+  REQUIRE(resource.allocations >= 2);
+}
+
+TEST_CASE("structopt can parse into a monotonic buffer" * test_suite("memory_resource")) {
+  std::array<std::byte, 4096> buffer;
+  std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size(),
+                                            std::pmr::null_memory_resource());
+  auto result = structopt::app("test").memory_resource(&arena).try_parse<ArenaOptions>(
+      std::vector<std::string>{"./main", "in", "build", "a", "b", "c"});
+  REQUIRE(result.has_value());
+  REQUIRE(result->input == "in");
+  REQUIRE(result->build.targets ==
+          std::pmr::vector<std::pmr::string>{"a", "b", "c"});
+  REQUIRE(result->build.targets.get_allocator().resource() == &arena);
+}
+
+TEST_CASE("structopt fills std::pmr fields from the default resource unless told otherwise" * test_suite("memory_resource")) {
+  auto arguments = structopt::app("test").parse<ArenaOptions>(
+      std::vector<std::string>{"./main", "input with spaces", "--jobs", "3"});
+  REQUIRE(arguments.input == "input with spaces");
+  REQUIRE(arguments.input.get_allocator().resource() == std::pmr::get_default_resource());
+  REQUIRE(*arguments.jobs == std::pmr::vector<int>{3});
+}
+
+struct QueueOptions {
+  struct Enqueue : structopt::sub_command {
+    std::deque<std::string> jobs;
+  };
+  Enqueue enqueue;
+};
+STRUCTOPT(QueueOptions::Enqueue, jobs);
+STRUCTOPT(QueueOptions, enqueue);
+
+// only what holds std::pmr memory is replaced in place; everything else is
+// assigned, e.g., a std::deque, whose move constructor can throw
+static_assert(structopt::details::has_memory_resource<ArenaOptions::Build>());
+static_assert(structopt::details::has_memory_resource<std::optional<std::pmr::string>>());
+static_assert(!structopt::details::has_memory_resource<QueueOptions::Enqueue>());
+static_assert(!structopt::details::has_memory_resource<std::pmr::vector<int> *>());
+
+TEST_CASE("structopt assigns nested structs without std::pmr fields" * test_suite("memory_resource")) {
+  auto arguments = structopt::app("test").parse<QueueOptions>(
+      std::vector<std::string>{"./main", "enqueue", "build", "test"});
+  REQUIRE(arguments.enqueue.has_value());
+  REQUIRE(arguments.enqueue.jobs == std::deque<std::string>{"build", "test"});
+}
+
+#endif
@@ -59,6 +59,7 @@ TEST_CASE("structopt can parse multiple nested struct arguments" * test_suite("n
     bool exception_thrown = false;
     try {
       auto arguments = structopt::app("test").parse<Command>(std::vector<std::string>{"./main", "foo", "15", "3.14", "--verbose", "true", "config", "-g", "false"});
+      (void)arguments;
     }
     catch (structopt::exception&) {
       exception_thrown = true;
@@ -69,6 +70,7 @@ TEST_CASE("structopt can parse multiple nested struct arguments" * test_suite("n
     bool exception_thrown = false;
     try {
       auto arguments = structopt::app("test").parse<Command>(std::vector<std::string>{"./main", "config", "-g", "false", "foo", "15", "3.14", "--verbose", "true"});
+      (void)arguments;
     }
     catch (structopt::exception&) {
       exception_thrown = true;
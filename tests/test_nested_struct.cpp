@@ -33,4 +33,11 @@ TEST_CASE("structopt can parse nested structs" * test_suite("nested_struct")) {
     REQUIRE(arguments.foo.bar == 15);
     REQUIRE(arguments.foo.local.has_value() == true);
   }
-}
\ No newline at end of file
+}
+
+TEST_CASE("structopt sub-commands only carry an invoked flag" * test_suite("nested_struct")) {
+  REQUIRE(sizeof(structopt::sub_command) == sizeof(bool));
+
+  auto arguments = structopt::app("test").parse<TopLevelCommand>(std::vector<std::string>{"./main"});
+  REQUIRE(arguments.foo.has_value() == false);
+}
@@ -0,0 +1,100 @@
+#include <doctest.hpp>
+#include <structopt/app.hpp>
+
+using doctest::test_suite;
+
+struct NumberArguments {
+  std::optional<std::uint64_t> size;
+  std::optional<std::int16_t> offset;
+  std::optional<double> ratio;
+  std::vector<long long> values;
+};
+STRUCTOPT(NumberArguments, size, offset, ratio, values);
+
+TEST_CASE("structopt can convert numbers of any width and notation" * test_suite("number_conversion")) {
+  {
+    auto arguments = structopt::app("test").parse<NumberArguments>(std::vector<std::string>{"./main", "--size", "0b1111111111111111111111111111111111111111111111111111111111111111"});
+    REQUIRE(arguments.size == std::numeric_limits<std::uint64_t>::max());
+  }
+  {
+    auto arguments = structopt::app("test").parse<NumberArguments>(std::vector<std::string>{"./main", "--size", "0xFFFFFFFFFF", "--offset", "-0x8000"});
+    REQUIRE(arguments.size == 0xFFFFFFFFFFull);
+    REQUIRE(arguments.offset == std::numeric_limits<std::int16_t>::min());
+  }
+  {
+    auto arguments = structopt::app("test").parse<NumberArguments>(std::vector<std::string>{"./main", "--ratio", "+2.5e-3", "9223372036854775807", "-071", "0b11"});
+    REQUIRE(arguments.ratio == 2.5e-3);
+    REQUIRE(arguments.values == std::vector<long long>{9223372036854775807ll, -071, 3});
+  }
+}
+
+TEST_CASE("structopt reports numbers that are out of range or malformed" * test_suite("number_conversion")) {
+  for (const auto &arguments : std::vector<std::vector<std::string>>{
+           {"./main", "--offset", "32768"},
+           {"./main", "--offset", "-0x8001"},
+           {"./main", "--size", "-1"},
+           {"./main", "--size", "0x1FFFFFFFFFFFFFFFF"},
+           {"./main", "--size", "12abc"},
+           {"./main", "--ratio", "2.5x"},
+           {"./main", "1", "2", "two"}}) {
+    bool exception_thrown = false;
+    try {
+      structopt::app("test").parse<NumberArguments>(arguments);
+    }
+    catch (structopt::exception&) {
+      exception_thrown = true;
+    }
+    REQUIRE(exception_thrown == true);
+  }
+}
+
+using structopt::details::number_notation;
+using structopt::details::scan_argument;
+
+static_assert(scan_argument("-5").notation == number_notation::decimal);
+static_assert(scan_argument("-5").negative);
+static_assert(scan_argument("+.5e-3").notation == number_notation::floating_point);
+static_assert(scan_argument("-0x5B").notation == number_notation::hex);
+static_assert(scan_argument("-0x5B").digits == 3);
+static_assert(scan_argument("071").notation == number_notation::octal);
+static_assert(scan_argument("089").notation == number_notation::decimal);
+static_assert(scan_argument("0b0101").notation == number_notation::binary);
+static_assert(scan_argument("-v").notation == number_notation::none);
+static_assert(scan_argument("1e").notation == number_notation::none);
+static_assert(scan_argument("--std=c++17").delimiter == 5);
+static_assert(!scan_argument("--std=c++17").key_is_number);
+static_assert(scan_argument("-5:x").key_is_number);
+
+TEST_CASE("structopt tells negative numbers from options" * test_suite("number_conversion")) {
+  auto arguments = structopt::app("test").parse<NumberArguments>(std::vector<std::string>{"./main", "-0x10", "-5", "-1e3", "--offset=-0x7F"});
+  REQUIRE(arguments.values == std::vector<long long>{-16, -5, -1000});
+  REQUIRE(arguments.offset == -0x7F);
+}
+
+TEST_CASE("structopt applies the exponent of a number converted to an integer" * test_suite("number_conversion")) {
+  using structopt::details::parse_number;
+  int value = 0;
+  REQUIRE(parse_number("-1e3", value) == std::errc{});
+  REQUIRE(value == -1000);
+  REQUIRE(parse_number("1.5e1", value) == std::errc{});
+  REQUIRE(value == 15);
+  REQUIRE(parse_number("+2.9", value) == std::errc{});
+  REQUIRE(value == 2);
+  REQUIRE(parse_number("-.5", value) == std::errc{});
+  REQUIRE(value == 0);
+  REQUIRE(parse_number("1e20", value) == std::errc::result_out_of_range);
+  REQUIRE(parse_number("-3e9", value) == std::errc::result_out_of_range);
+  REQUIRE(parse_number("1.5.5", value) == std::errc::invalid_argument);
+  REQUIRE(parse_number("3000000000.5", value) == std::errc::result_out_of_range);
+
+  unsigned short small = 0;
+  REQUIRE(parse_number("6.5535e4", small) == std::errc{});
+  REQUIRE(small == 65535);
+  REQUIRE(parse_number("6.5536e4", small) == std::errc::result_out_of_range);
+  REQUIRE(parse_number("-1e0", small) == std::errc::result_out_of_range);
+
+  long long large = 0;
+  REQUIRE(parse_number("1e18", large) == std::errc{});
+  REQUIRE(large == 1000000000000000000LL);
+  REQUIRE(parse_number("1e19", large) == std::errc::result_out_of_range);
+}
@@ -0,0 +1,91 @@
+#include <doctest.hpp>
+#include <structopt/app.hpp>
+
+using doctest::test_suite;
+
+struct ParallelArguments {
+  std::vector<double> values;
+  std::optional<std::deque<int>> counts;
+  std::optional<bool> verbose = false;
+};
+STRUCTOPT(ParallelArguments, values, counts, verbose);
+
+TEST_CASE("structopt converts large containers the same in parallel" * test_suite("parallel_conversion")) {
+  std::vector<std::string> input{"./main"};
+  for (std::size_t i = 0; i < 50000; i++) {
+    input.push_back(std::to_string(i) + ".5");
+  }
+  input.push_back("--counts");
+  for (int i = 0; i < 50000; i++) {
+    input.push_back(std::to_string(i % 2 ? i : -i));
+  }
+  input.push_back("-v");
+
+  auto serial = structopt::app("test").parse<ParallelArguments>(input);
+  // 4 threads, whatever the number of cores of the machine running the test
+  auto parallel = structopt::app("test").parallel_conversion(1000, 4).parse<ParallelArguments>(input);
+  REQUIRE(parallel.values.size() == 50000);
+  REQUIRE(parallel.values == serial.values);
+  REQUIRE(parallel.counts == serial.counts);
+  REQUIRE(parallel.counts.value()[2] == -2);
+  REQUIRE(parallel.verbose == true);
+}
+
+TEST_CASE("structopt reports the first error of a parallel conversion" * test_suite("parallel_conversion")) {
+  std::vector<std::string> input{"./main"};
+  for (std::size_t i = 0; i < 50000; i++) {
+    input.push_back(std::to_string(i));
+  }
+  input[45000] = "1e999";
+  input[30000] = "thirty";
+
+  bool exception_thrown = false;
+  try {
+    structopt::app("test").parallel_conversion(1000, 4).parse<ParallelArguments>(input);
+  } catch (structopt::exception &e) {
+    exception_thrown = true;
+    REQUIRE(e.index() == 30000);
+    REQUIRE(e.code() == structopt::error_code::invalid_value);
+  }
+  REQUIRE(exception_thrown);
+}
+
+TEST_CASE("structopt reports the first error of a later slice of a parallel conversion" * test_suite("parallel_conversion")) {
+  std::vector<std::string> input{"./main"};
+  for (std::size_t i = 0; i < 50000; i++) {
+    input.push_back(std::to_string(i));
+  }
+
+  const auto parse_error = [&input]() {
+    structopt::exception error("", structopt::details::visitor{});
+    bool exception_thrown = false;
+    try {
+      structopt::app("test").parallel_conversion(1000, 4).parse<ParallelArguments>(input);
+    } catch (structopt::exception &e) {
+      exception_thrown = true;
+      error = e;
+    }
+    REQUIRE(exception_thrown);
+    return error;
+  };
+
+  // 4 slices of 12500 values; the first slice converts
+  input[49000] = "last";
+  input[40000] = "fourth";
+  input[20000] = "second";
+  {
+    auto e = parse_error();
+    REQUIRE(e.index() == 20000);
+    REQUIRE(std::string{e.what()} == "Error: failed to correctly parse argument `values`. `second` is not a number.");
+  }
+  // only the last value of the last slice fails
+  input[40000] = "40000";
+  input[20000] = "20000";
+  input[49000] = "49000";
+  input[50000] = "end";
+  {
+    auto e = parse_error();
+    REQUIRE(e.index() == 50000);
+    REQUIRE(e.code() == structopt::error_code::invalid_value);
+  }
+}
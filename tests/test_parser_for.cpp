@@ -0,0 +1,62 @@
+#include <doctest.hpp>
+#include <structopt/app.hpp>
+
+using doctest::test_suite;
+
+struct DispatchCommand {
+  struct Run : structopt::sub_command {
+    std::optional<bool> dry = false;
+    std::vector<int> jobs;
+  };
+  Run run;
+  std::optional<bool> verbose = false;
+  std::optional<std::string> name;
+};
+STRUCTOPT(DispatchCommand::Run, dry, jobs);
+STRUCTOPT(DispatchCommand, run, verbose, name);
+
+TEST_CASE("structopt can parse many command lines with one parser" * test_suite("parser_for")) {
+  structopt::parser_for<DispatchCommand> parser("dispatch");
+  {
+    auto arguments = parser.parse(std::vector<std::string>{"./main", "-v", "--name=first", "run", "--dry", "1", "2"});
+    REQUIRE(arguments.verbose == true);
+    REQUIRE(arguments.name == "first");
+    REQUIRE(arguments.run.has_value());
+    REQUIRE(arguments.run.dry == true);
+    REQUIRE(arguments.run.jobs == std::vector<int>{1, 2});
+  }
+  {
+    // nothing is left over from the last parse
+    auto arguments = parser.parse(std::vector<std::string>{"./main", "--name", "second"});
+    REQUIRE(arguments.verbose == false);
+    REQUIRE(arguments.name == "second");
+    REQUIRE(arguments.run.has_value() == false);
+  }
+  {
+    auto result = parser.try_parse(std::vector<std::string>{"./main", "run", "three"});
+    REQUIRE(result.status() == structopt::parse_status::error);
+    REQUIRE(result.index() == 2);
+  }
+  {
+    parser.reset();
+    auto result = parser.try_parse(std::vector<std::string>{"./main", "run", "3"});
+    REQUIRE(result.has_value());
+    REQUIRE(result->run.jobs == std::vector<int>{3});
+  }
+  {
+    bool exception_thrown = false;
+    try {
+      parser.parse(std::vector<std::string>{"./main", "--name"});
+    } catch (structopt::exception &e) {
+      exception_thrown = true;
+      REQUIRE(e.code() == structopt::error_code::missing_value);
+    }
+    REQUIRE(exception_thrown);
+  }
+}
+
+TEST_CASE("structopt parsers can print the help before parsing" * test_suite("parser_for")) {
+  structopt::parser_for<DispatchCommand> parser("dispatch", "1.0.0");
+  REQUIRE(parser.help().find("USAGE: dispatch [FLAGS] [OPTIONS] [SUBCOMMANDS]") !=
+          std::string::npos);
+}
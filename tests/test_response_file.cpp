@@ -0,0 +1,96 @@
+#include <cstdio>
+#include <doctest.hpp>
+#include <fstream>
+#include <structopt/app.hpp>
+
+using doctest::test_suite;
+
+struct ResponseFileArguments {
+  std::optional<bool> verbose = false;
+  std::optional<std::string> output;
+  std::vector<std::string> files;
+};
+STRUCTOPT(ResponseFileArguments, verbose, output, files);
+
+static std::string write_response_file(const std::string &name, const std::string &contents) {
+  const auto path = "structopt_" + name + ".rsp";
+  std::ofstream file(path, std::ios::binary);
+  file << contents;
+  return path;
+}
+
+TEST_CASE("structopt can parse arguments from a response file" * test_suite("response_file")) {
+  // Whitespace separated
+  {
+    const auto path = write_response_file("plain", "--verbose\n  a.txt\tb.txt\r\n");
+    auto arguments = structopt::app("test").response_files().parse<ResponseFileArguments>(
+        std::vector<std::string>{"./main", "@" + path, "c.txt"});
+    REQUIRE(arguments.verbose == true);
+    REQUIRE(arguments.files == std::vector<std::string>{"a.txt", "b.txt", "c.txt"});
+    std::remove(path.c_str());
+  }
+  // Quoted and escaped
+  {
+    const auto path = write_response_file(
+        "quoted", "--output 'my file.txt' \"a \\\"b\\\" c\" d\\ e \"\" f'g'h \"unterminated");
+    auto arguments = structopt::app("test").response_files().parse<ResponseFileArguments>(
+        std::vector<std::string>{"./main", "@" + path});
+    REQUIRE(arguments.output == "my file.txt");
+    REQUIRE(arguments.files ==
+            std::vector<std::string>{"a \"b\" c", "d e", "", "fgh", "unterminated"});
+    std::remove(path.c_str());
+  }
+  // NUL separated, e.g., from `find -print0`
+  {
+    const auto path = write_response_file("nul", std::string("--output\0out dir\0'a'\0\0", 22));
+    auto arguments = structopt::app("test").response_files().parse<ResponseFileArguments>(
+        std::vector<std::string>{"./main", "-v", "@" + path});
+    REQUIRE(arguments.verbose == true);
+    REQUIRE(arguments.output == "out dir");
+    REQUIRE(arguments.files == std::vector<std::string>{"'a'", ""});
+    std::remove(path.c_str());
+  }
+  // Empty
+  {
+    const auto path = write_response_file("empty", "");
+    auto arguments = structopt::app("test").response_files().parse<ResponseFileArguments>(
+        std::vector<std::string>{"./main", "@" + path, "a.txt"});
+    REQUIRE(arguments.files == std::vector<std::string>{"a.txt"});
+    std::remove(path.c_str());
+  }
+}
+
+TEST_CASE("structopt leaves @ arguments that are not response files as they are" * test_suite("response_file")) {
+  const auto path = write_response_file("literal", "--verbose");
+  {
+    auto arguments = structopt::app("test").response_files().parse<ResponseFileArguments>(
+        std::vector<std::string>{"./main", "@structopt_missing.rsp", "@"});
+    REQUIRE(arguments.files == std::vector<std::string>{"@structopt_missing.rsp", "@"});
+  }
+  {
+    auto arguments = structopt::app("test").response_files().parse<ResponseFileArguments>(
+        std::vector<std::string>{"./main", "--", "@" + path});
+    REQUIRE(arguments.verbose == false);
+    REQUIRE(arguments.files == std::vector<std::string>{"@" + path});
+  }
+  std::remove(path.c_str());
+}
+
+TEST_CASE("structopt only reads response files when asked to" * test_suite("response_file")) {
+  const auto path = write_response_file("opt_in", "--verbose a.txt");
+  {
+    auto arguments = structopt::app("test").parse<ResponseFileArguments>(
+        std::vector<std::string>{"./main", "@" + path});
+    REQUIRE(arguments.verbose == false);
+    REQUIRE(arguments.files == std::vector<std::string>{"@" + path});
+  }
+  {
+    structopt::parser_for<ResponseFileArguments> parser("test");
+    REQUIRE(parser.parse(std::vector<std::string>{"./main", "@" + path}).files ==
+            std::vector<std::string>{"@" + path});
+    parser.response_files();
+    REQUIRE(parser.parse(std::vector<std::string>{"./main", "@" + path}).files ==
+            std::vector<std::string>{"a.txt"});
+  }
+  std::remove(path.c_str());
+}
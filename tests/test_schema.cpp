@@ -0,0 +1,61 @@
+#include <doctest.hpp>
+#include <structopt/app.hpp>
+
+using doctest::test_suite;
+
+struct SchemaArguments {
+  struct Run : structopt::sub_command {
+    std::string script;
+  };
+  std::string input;
+  std::optional<bool> verbose = false;
+  std::optional<int> log_level;
+  std::vector<std::string> files;
+  Run run;
+};
+STRUCTOPT(SchemaArguments::Run, script);
+STRUCTOPT(SchemaArguments, input, verbose, log_level, files, run);
+
+using schema_table = structopt::details::schema_table<SchemaArguments>;
+using structopt::details::field_kind;
+
+static_assert(schema_table::field_count == 5);
+static_assert(schema_table::fields[0].kind == field_kind::positional);
+static_assert(schema_table::fields[1].kind == field_kind::flag);
+static_assert(schema_table::fields[2].kind == field_kind::optional);
+static_assert(schema_table::fields[3].is_container);
+static_assert(schema_table::fields[4].kind == field_kind::nested_struct);
+static_assert(schema_table::positional_count == 2);
+static_assert(schema_table::positional_fields[0] == 0 && schema_table::positional_fields[1] == 3);
+
+// the help, after `USAGE: <name> `, is rendered at compile time
+static_assert(structopt::details::help_of<schema_table>::view() ==
+              "[FLAGS] [OPTIONS] [SUBCOMMANDS] input files \n\n"
+              "FLAGS:\n    -v, --verbose\n\n"
+              "OPTIONS:\n    -l, --log-level <log_level>\n    -h, --help <help>\n"
+              "    -v, --version <version>\n\n"
+              "SUBCOMMANDS:\n    run\n\n"
+              "ARGS:\n    input\n    files\n");
+
+TEST_CASE("structopt describes each struct once" * test_suite("schema")) {
+  const auto &schema = structopt::details::schema_of<SchemaArguments>();
+  REQUIRE(&schema == &structopt::details::schema_of<SchemaArguments>());
+  REQUIRE(schema.field_index.find("--log-level") == 2);
+  REQUIRE(schema.option_field_index.find("-v") == 1);
+  REQUIRE(schema.option_field_index.find("--input") == structopt::details::option_index::npos);
+  REQUIRE(schema.option_field_index.find("--help") == schema.help_field());
+  REQUIRE(schema.help.data() == structopt::details::help_of<schema_table>::text.data());
+
+  auto arguments = structopt::app("test").parse<SchemaArguments>(std::vector<std::string>{"./main", "in.txt", "-v", "a", "b", "--log-level", "3", "run", "main.py"});
+  REQUIRE(arguments.input == "in.txt");
+  REQUIRE(arguments.verbose == true);
+  REQUIRE(arguments.log_level == 3);
+  REQUIRE(arguments.files == std::vector<std::string>{"a", "b"});
+  REQUIRE(arguments.run.has_value());
+  REQUIRE(arguments.run.script == "main.py");
+}
+
+TEST_CASE("structopt prints only the usage line before a parse" * test_suite("schema")) {
+  REQUIRE(structopt::app("my_app").help() == "\nUSAGE: my_app \n");
+  REQUIRE(structopt::app("my_app", "1.0.0").help() == "\nUSAGE: my_app \n");
+}
@@ -165,4 +165,19 @@ TEST_CASE("structopt can parse single positional argument" * test_suite("single_
     auto arguments = structopt::app("test").parse<SinglePairArgument>(std::vector<std::string>{"./main", "10", "3.14"});
     REQUIRE(arguments.value == std::pair<int, float>{10, 3.14f});
   }
-}
\ No newline at end of file
+}
+
+static_assert(structopt::details::parse_bool("Yes") == true);
+static_assert(structopt::details::parse_bool("OFF") == false);
+static_assert(!structopt::details::parse_bool("maybe").has_value());
+
+TEST_CASE("structopt rejects unknown boolean spellings" * test_suite("single_positional")) {
+  std::string what;
+  try {
+    structopt::app("test").parse<SingleBoolArgument>(std::vector<std::string>{"./main", "Maybe"});
+  }
+  catch (structopt::exception& e) {
+    what = e.what();
+  }
+  REQUIRE(what == "Error: failed to parse boolean argument `value`. `Maybe` is invalid.");
+}
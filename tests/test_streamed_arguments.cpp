@@ -0,0 +1,87 @@
+#include <doctest.hpp>
+#include <iterator>
+#include <sstream>
+#include <structopt/app.hpp>
+
+using doctest::test_suite;
+
+struct StreamedArguments {
+  std::optional<bool> verbose = false;
+  std::optional<std::string> output;
+  std::vector<int> numbers;
+  std::set<std::string> names;
+};
+STRUCTOPT(StreamedArguments, verbose, output, numbers, names);
+
+TEST_CASE("structopt can parse arguments read from an input range" * test_suite("streamed_arguments")) {
+  std::istringstream input("./main -v 1 2 -0x3 --output=out.txt -- b a b");
+  auto arguments = structopt::app("test").parse<StreamedArguments>(
+      std::istream_iterator<std::string>(input), std::istream_iterator<std::string>());
+  REQUIRE(arguments.verbose == true);
+  REQUIRE(arguments.output == "out.txt");
+  REQUIRE(arguments.numbers == std::vector<int>{1, 2, -3});
+  REQUIRE(arguments.names == std::set<std::string>{"a", "b"});
+}
+
+TEST_CASE("structopt can parse arguments returned by a generator" * test_suite("streamed_arguments")) {
+  // NUL-separated, e.g., from `find -print0`
+  std::istringstream input(std::string("./main\0--output\0my file\0-5\0", 27));
+  auto arguments = structopt::app("test").parse<StreamedArguments>(
+      [&]() -> std::optional<std::string> {
+        std::string next;
+        if (std::getline(input, next, '\0')) {
+          return next;
+        }
+        return std::nullopt;
+      });
+  REQUIRE(arguments.output == "my file");
+  REQUIRE(arguments.numbers == std::vector<int>{-5});
+}
+
+TEST_CASE("structopt reads streamed arguments as it parses them" * test_suite("streamed_arguments")) {
+  constexpr int count = 100000;
+  int produced = 0;
+  std::size_t most_arguments_held = 0;
+
+  structopt::details::argument_list list;
+  list.source = [&](std::string &next) {
+    if (produced == 0) {
+      next = "./main";
+    } else if (produced <= count) {
+      next = std::to_string(produced);
+    } else if (produced == count + 1) {
+      next = "--verbose";
+    } else {
+      return false;
+    }
+    produced += 1;
+    most_arguments_held = std::max(most_arguments_held, list.arguments.size());
+    return true;
+  };
+
+  structopt::details::visitor visitor("test", "");
+  visitor.schema = &structopt::details::schema_of<StreamedArguments>();
+  structopt::details::parser parser(visitor, list);
+  StreamedArguments arguments;
+  parser.parse_fields(arguments);
+
+  REQUIRE(arguments.numbers.size() == count);
+  REQUIRE(arguments.numbers.back() == count);
+  REQUIRE(arguments.verbose == true);
+  REQUIRE(produced == count + 2);
+  // the arguments that were parsed into `numbers` were released
+  REQUIRE(most_arguments_held < 4096);
+}
+
+TEST_CASE("structopt reports missing streamed arguments" * test_suite("streamed_arguments")) {
+  std::istringstream input("./main --output");
+  bool exception_thrown = false;
+  try {
+    structopt::app("test").parse<StreamedArguments>(
+        std::istream_iterator<std::string>(input), std::istream_iterator<std::string>());
+  } catch (structopt::exception &e) {
+    exception_thrown = true;
+    REQUIRE(e.code() == structopt::error_code::missing_value);
+  }
+  REQUIRE(exception_thrown);
+}
@@ -0,0 +1,45 @@
+#include <doctest.hpp>
+#include <structopt/app.hpp>
+
+using doctest::test_suite;
+
+struct ViewCommand {
+  struct Copy : structopt::sub_command {
+    std::optional<bool> recursive = false;
+    std::vector<std::string> sources;
+    std::optional<std::string> target;
+  };
+  Copy cp;
+  std::optional<bool> verbose = false;
+};
+STRUCTOPT(ViewCommand::Copy, recursive, sources, target);
+STRUCTOPT(ViewCommand, cp, verbose);
+
+TEST_CASE("structopt can parse arguments from string views" * test_suite("string_view_arguments")) {
+  {
+    auto arguments = structopt::app("test").parse<ViewCommand>(std::vector<std::string_view>{"./main", "cp", "-r", "a.txt", "b.txt", "--target=out"});
+    REQUIRE(arguments.cp.has_value());
+    REQUIRE(arguments.cp.recursive == true);
+    REQUIRE(arguments.cp.sources == std::vector<std::string>{"a.txt", "b.txt"});
+    REQUIRE(arguments.cp.target == "out");
+    REQUIRE(arguments.verbose == false);
+  }
+  {
+    auto arguments = structopt::app("test").parse<ViewCommand>(std::vector<std::string_view>{"./main", "-v", "cp", "a.txt"});
+    REQUIRE(arguments.cp.has_value());
+    REQUIRE(arguments.cp.sources == std::vector<std::string>{"a.txt"});
+    REQUIRE(arguments.verbose == true);
+  }
+}
+
+TEST_CASE("structopt can parse arguments from argc and argv" * test_suite("string_view_arguments")) {
+  {
+    char program[] = "./main", command[] = "cp", flag[] = "-r", source[] = "a.txt", target[] = "--target:out";
+    char *argv[] = {program, command, flag, source, target};
+    auto arguments = structopt::app("test").parse<ViewCommand>(5, argv);
+    REQUIRE(arguments.cp.has_value());
+    REQUIRE(arguments.cp.recursive == true);
+    REQUIRE(arguments.cp.sources == std::vector<std::string>{"a.txt"});
+    REQUIRE(arguments.cp.target == "out");
+  }
+}
@@ -0,0 +1,102 @@
+#include <doctest.hpp>
+#include <structopt/app.hpp>
+
+using doctest::test_suite;
+
+enum class TryParseColor { red, green, blue };
+
+struct TryParseCommand {
+  struct Run : structopt::sub_command {
+    std::optional<TryParseColor> color;
+    std::optional<bool> dry = false;
+    std::vector<int> jobs;
+  };
+  struct Stop : structopt::sub_command {
+    std::optional<bool> force = false;
+  };
+  Run run;
+  Stop stop;
+  std::optional<std::int16_t> level;
+  std::optional<bool> a = false;
+  std::optional<std::string> b;
+};
+STRUCTOPT(TryParseCommand::Run, color, dry, jobs);
+STRUCTOPT(TryParseCommand::Stop, force);
+STRUCTOPT(TryParseCommand, run, stop, level, a, b);
+
+// This file is also built with -fno-exceptions, as structopt_no_exceptions_tests,
+// where an error that try_parse throws instead of returning aborts the test
+static structopt::parse_result<TryParseCommand>
+try_parse(const std::vector<std::string> &arguments) {
+  return structopt::app("test", "1.0.3").try_parse<TryParseCommand>(arguments);
+}
+
+static void require_error(const structopt::parse_result<TryParseCommand> &result,
+                          structopt::error_code code, std::size_t index) {
+  REQUIRE(result.status() == structopt::parse_status::error);
+  REQUIRE(!result.has_value());
+  REQUIRE(result.code() == code);
+  REQUIRE(result.index() == index);
+  REQUIRE(!result.message().empty());
+}
+
+TEST_CASE("structopt can parse without exceptions" * test_suite("try_parse")) {
+  auto result = try_parse({"./main", "--level", "3", "run", "--color", "green", "1", "2"});
+  REQUIRE(result.status() == structopt::parse_status::success);
+  REQUIRE(result.has_value());
+  REQUIRE(result.code() == structopt::error_code::invalid_value);
+  REQUIRE(result.index() == structopt::exception::npos);
+  REQUIRE(result.message().empty());
+  REQUIRE(result->level == 3);
+  REQUIRE(result->run.has_value());
+  REQUIRE(result->run.color == TryParseColor::green);
+  REQUIRE(result->run.jobs == std::vector<int>{1, 2});
+  REQUIRE(result.value().stop.has_value() == false);
+}
+
+TEST_CASE("structopt returns errors without throwing them" * test_suite("try_parse")) {
+  using structopt::error_code;
+  {
+    auto result = try_parse({"./main", "--level", "40000"});
+    require_error(result, error_code::out_of_range, 2);
+    REQUIRE(!result);
+    REQUIRE(result.message() == "Error: value `40000` is out of range for argument `level`.");
+  }
+  require_error(try_parse({"./main", "--level"}), error_code::missing_value,
+                structopt::exception::npos);
+  require_error(try_parse({"./main", "--level", "high"}), error_code::invalid_value, 2);
+  require_error(try_parse({"./main", "-ba", "x"}), error_code::combined_flag_value, 1);
+  // in a sub-command
+  require_error(try_parse({"./main", "run", "--color", "purple", "--dry"}),
+                error_code::invalid_value, 3);
+  // the first error is reported
+  require_error(try_parse({"./main", "run", "1", "two", "3", "x", "--color", "purple"}),
+                error_code::invalid_value, 3);
+  require_error(try_parse({"./main", "stop", "run"}), error_code::duplicate_sub_command, 2);
+}
+
+TEST_CASE("structopt returns requests for the help and the version" * test_suite("try_parse")) {
+  const auto require_request = [](const structopt::parse_result<TryParseCommand> &result,
+                                  structopt::parse_status status) {
+    REQUIRE(result.status() == status);
+    REQUIRE(!result.has_value());
+    REQUIRE(result.code() == structopt::error_code::invalid_value);
+    REQUIRE(result.index() == structopt::exception::npos);
+  };
+  {
+    auto result = try_parse({"./main", "--help"});
+    require_request(result, structopt::parse_status::help_requested);
+    REQUIRE(result.message().find("USAGE: test") != std::string::npos);
+  }
+  {
+    // the help of the sub-command
+    auto result = try_parse({"./main", "run", "-h"});
+    require_request(result, structopt::parse_status::help_requested);
+    REQUIRE(result.message().find("USAGE: run") != std::string::npos);
+  }
+  {
+    auto result = try_parse({"./main", "--version"});
+    require_request(result, structopt::parse_status::version_requested);
+    REQUIRE(result.message() == "1.0.3");
+  }
+}
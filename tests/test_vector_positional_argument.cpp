@@ -131,3 +131,30 @@ TEST_CASE("structopt can parse vector of files with an optional argument in the
     REQUIRE(arguments.files == std::vector<std::string>{});
   }
 }
+
+struct LargeVectorArguments {
+  std::vector<float> values;
+  std::optional<bool> verbose = false;
+  std::deque<int> rest;
+};
+STRUCTOPT(LargeVectorArguments, values, verbose, rest);
+
+TEST_CASE("structopt can parse large numeric vector arguments" * test_suite("vector_positional")) {
+  std::vector<std::string> input{"./main"};
+  for (std::size_t i = 0; i < 10000; i++) {
+    input.push_back(std::to_string(i) + ".5");
+  }
+  input.push_back("-1e2");
+  input.push_back("--verbose");
+  input.push_back("1");
+  input.push_back("--");
+  input.push_back("--verbose");
+
+  auto arguments = structopt::app("test").parse<LargeVectorArguments>(input);
+  REQUIRE(arguments.values.size() == 10001);
+  REQUIRE(arguments.values.capacity() == 10001);
+  REQUIRE(arguments.values[9999] == 9999.5f);
+  REQUIRE(arguments.values.back() == -100.0f);
+  REQUIRE(arguments.verbose == true);
+  REQUIRE(arguments.rest == std::deque<int>{1});
+}